@@ -0,0 +1,761 @@
+
+#define MEMO_BUCKET_COUNT 65536
+
+// Runtime that is copied into every emitted program. It is written against the System V ABI and only uses libc for
+// memory, formatting and output. The layouts of lists and strings are defined in front of it as assembler symbols.
+static const char *ASSEMBLY_RUNTIME = R"(
+    .macro NI_ENTER
+    pushq %rbp
+    movq %rsp, %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    andq $-16, %rsp
+    .endm
+
+    .macro NI_LEAVE
+    leaq -40(%rbp), %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .endm
+
+    .section .rodata
+ni_index_error_format:
+    .asciz "RUNTIME_ERROR: Index %ld is out of bounds for length %ld.\n"
+ni_out_of_memory_message:
+    .asciz "RUNTIME_ERROR: Out of memory.\n"
+ni_int_format:
+    .asciz "%ld"
+ni_float_format:
+    .asciz "%f"
+ni_true:
+    .ascii "true"
+ni_false:
+    .ascii "false"
+
+    .text
+# Writes the message (rdi) to stderr and exits
+ni_fail:
+    NI_ENTER
+    movq %rdi, %r12
+    movq stdout@GOTPCREL(%rip), %rax
+    movq (%rax), %rdi
+    call fflush@PLT
+    movq stderr@GOTPCREL(%rip), %rax
+    movq (%rax), %rsi
+    movq %r12, %rdi
+    call fputs@PLT
+    movl $1, %edi
+    call exit@PLT
+
+# The index (rdi) is out of bounds for the length (rsi)
+ni_fail_index:
+    NI_ENTER
+    movq %rdi, %r12
+    movq %rsi, %r13
+    movq stdout@GOTPCREL(%rip), %rax
+    movq (%rax), %rdi
+    call fflush@PLT
+    movq stderr@GOTPCREL(%rip), %rax
+    movq (%rax), %rdi
+    leaq ni_index_error_format(%rip), %rsi
+    movq %r12, %rdx
+    movq %r13, %rcx
+    xorl %eax, %eax
+    call fprintf@PLT
+    movl $1, %edi
+    call exit@PLT
+
+# Allocates count (rsi) objects of the given size (rdi)
+ni_allocate:
+    NI_ENTER
+    imulq %rsi, %rdi
+    movq %rdi, %r12
+    call malloc@PLT
+    testq %rax, %rax
+    jnz 1f
+    testq %r12, %r12
+    jz 1f
+    leaq ni_out_of_memory_message(%rip), %rdi
+    call ni_fail
+1:
+    NI_LEAVE
+
+# Allocates a string with a copy of the data (rdi) of the given length (rsi)
+ni_make_string:
+    NI_ENTER
+    movq %rdi, %r12
+    movq %rsi, %r13
+    movl $STRING_SIZE, %edi
+    movl $1, %esi
+    call ni_allocate
+    movq %rax, %rbx
+    movl $1, %edi
+    movq %r13, %rsi
+    call ni_allocate
+    movq %r13, STRING_LENGTH_OFFSET(%rbx)
+    movq %rax, STRING_DATA_OFFSET(%rbx)
+    movq %rax, %rdi
+    movq %r12, %rsi
+    movq %r13, %rdx
+    call memcpy@PLT
+    movq %rbx, %rax
+    NI_LEAVE
+
+ni_print:
+    NI_ENTER
+    movq STRING_LENGTH_OFFSET(%rdi), %rdx
+    movq STRING_DATA_OFFSET(%rdi), %rdi
+    movl $1, %esi
+    movq stdout@GOTPCREL(%rip), %rax
+    movq (%rax), %rcx
+    call fwrite@PLT
+    NI_LEAVE
+
+ni_println:
+    NI_ENTER
+    call ni_print
+    movl $10, %edi
+    call putchar@PLT
+    NI_LEAVE
+
+ni_int_to_string:
+    NI_ENTER
+    subq $32, %rsp
+    movq %rdi, %rcx
+    movq %rsp, %rdi
+    movl $32, %esi
+    leaq ni_int_format(%rip), %rdx
+    xorl %eax, %eax
+    call snprintf@PLT
+    movq %rsp, %rdi
+    movslq %eax, %rsi
+    call ni_make_string
+    NI_LEAVE
+
+ni_char_to_string:
+    NI_ENTER
+    subq $16, %rsp
+    movb %dil, (%rsp)
+    movq %rsp, %rdi
+    movl $1, %esi
+    call ni_make_string
+    NI_LEAVE
+
+ni_string_to_char_list:
+    NI_ENTER
+    movq STRING_LENGTH_OFFSET(%rdi), %r12
+    movq STRING_DATA_OFFSET(%rdi), %r13
+    movl $LIST_SIZE, %edi
+    movl $1, %esi
+    call ni_allocate
+    movq %rax, %rbx
+    movl $1, %edi
+    movq %r12, %rsi
+    call ni_allocate
+    movq %rax, %r14
+    movq %rax, %rdi
+    movq %r13, %rsi
+    movq %r12, %rdx
+    call memcpy@PLT
+    movq %r12, LIST_LENGTH_OFFSET(%rbx)
+    leaq (%r12,%r12), %rax
+    movq %rax, LIST_CAPACITY_OFFSET(%rbx)
+    movq %r14, LIST_DATA_OFFSET(%rbx)
+    movq %rbx, %rax
+    NI_LEAVE
+
+ni_char_list_to_string:
+    movq LIST_LENGTH_OFFSET(%rdi), %rsi
+    movq LIST_DATA_OFFSET(%rdi), %rdi
+    jmp ni_make_string
+
+# Same format as std::to_string
+ni_float_to_string:
+    NI_ENTER
+    movq %rdi, %r12
+    xorl %edi, %edi
+    xorl %esi, %esi
+    leaq ni_float_format(%rip), %rdx
+    movq %r12, %xmm0
+    movl $1, %eax
+    call snprintf@PLT
+    movslq %eax, %r13
+    movl $1, %edi
+    leaq 1(%r13), %rsi
+    call ni_allocate
+    movq %rax, %rbx
+    movq %rax, %rdi
+    leaq 1(%r13), %rsi
+    leaq ni_float_format(%rip), %rdx
+    movq %r12, %xmm0
+    movl $1, %eax
+    call snprintf@PLT
+    movq %rbx, %rdi
+    movq %r13, %rsi
+    call ni_make_string
+    movq %rax, %r12
+    movq %rbx, %rdi
+    call free@PLT
+    movq %r12, %rax
+    NI_LEAVE
+
+ni_bool_to_string:
+    testq %rdi, %rdi
+    jz 1f
+    leaq ni_true(%rip), %rdi
+    movl $4, %esi
+    jmp ni_make_string
+1:
+    leaq ni_false(%rip), %rdi
+    movl $5, %esi
+    jmp ni_make_string
+
+# Results of a memoized function are kept in a hash table of NI_MEMO_BUCKET_COUNT chained buckets, which is
+# allocated by the first store. Every entry holds the next entry, the result and the words of the arguments.
+
+# Bucket of the key (rdi) with the given number of words (rsi)
+ni_memo_hash:
+    movabsq $0xcbf29ce484222325, %rax
+    movabsq $0x100000001b3, %r8
+    xorl %ecx, %ecx
+1:
+    cmpq %rsi, %rcx
+    jae 2f
+    xorq (%rdi,%rcx,8), %rax
+    imulq %r8, %rax
+    movq %rax, %rdx
+    shrq $32, %rdx
+    xorq %rdx, %rax
+    incq %rcx
+    jmp 1b
+2:
+    andq $(NI_MEMO_BUCKET_COUNT - 1), %rax
+    ret
+
+# Entry of the cache (rdi) for the key (rsi) with the given number of words (rdx), 0 if there is none
+ni_memo_find:
+    NI_ENTER
+    movq (%rdi), %rbx
+    testq %rbx, %rbx
+    jz 3f
+    movq %rsi, %r12
+    movq %rdx, %r13
+    movq %r12, %rdi
+    movq %r13, %rsi
+    call ni_memo_hash
+    movq (%rbx,%rax,8), %rbx
+1:
+    testq %rbx, %rbx
+    jz 3f
+    leaq NI_MEMO_KEY_OFFSET(%rbx), %rdi
+    movq %r12, %rsi
+    leaq 0(,%r13,8), %rdx
+    call memcmp@PLT
+    testl %eax, %eax
+    jz 2f
+    movq NI_MEMO_NEXT_OFFSET(%rbx), %rbx
+    jmp 1b
+2:
+    movq %rbx, %rax
+    NI_LEAVE
+3:
+    xorl %eax, %eax
+    NI_LEAVE
+
+# Stores the result (rcx) for the key (rsi) with the given number of words (rdx) in the cache (rdi)
+ni_memo_store:
+    NI_ENTER
+    movq %rdi, %rbx
+    movq %rsi, %r12
+    movq %rdx, %r13
+    movq %rcx, %r15
+    call ni_memo_find
+    testq %rax, %rax
+    jz 1f
+    movq %r15, NI_MEMO_RESULT_OFFSET(%rax)
+    NI_LEAVE
+1:
+    cmpq $0, (%rbx)
+    jne 2f
+    movl $NI_MEMO_BUCKET_COUNT, %edi
+    movl $8, %esi
+    call calloc@PLT
+    testq %rax, %rax
+    jz 3f
+    movq %rax, (%rbx)
+2:
+    leaq NI_MEMO_KEY_OFFSET(,%r13,8), %rdi
+    call malloc@PLT
+    testq %rax, %rax
+    jz 3f
+    movq %rax, %r14
+    movq %r15, NI_MEMO_RESULT_OFFSET(%r14)
+    leaq NI_MEMO_KEY_OFFSET(%r14), %rdi
+    movq %r12, %rsi
+    leaq 0(,%r13,8), %rdx
+    call memcpy@PLT
+    movq %r12, %rdi
+    movq %r13, %rsi
+    call ni_memo_hash
+    movq (%rbx), %rdx
+    movq (%rdx,%rax,8), %rcx
+    movq %rcx, NI_MEMO_NEXT_OFFSET(%r14)
+    movq %r14, (%rdx,%rax,8)
+    NI_LEAVE
+3:
+    leaq ni_out_of_memory_message(%rip), %rdi
+    call ni_fail
+)";
+
+#define ASSEMBLY_STATIC_DATA_BYTES_PER_LINE 16
+
+// Emits the optimized program of a code generator as x86-64 assembly for the GNU assembler (AT&T syntax).
+// Assembling and linking it with the system C compiler (e.g. 'cc -o program program.s') gives an executable.
+//
+// Like CTranslator, the operand stack disappears: the depth of the operand stack is known before every
+// instruction, so every stack slot and every local variable gets a fixed place in the frame of the function:
+//      16(%rbp) + 8 * (argument_count - 1 - i)                                argument i (pushed by the caller)
+//      -8 * (n + 1)(%rbp)                                                      stack slot n
+//      -8 * (slot_count + n + 1)(%rbp)                                         variable n
+//      -8 * (slot_count + variable_count + argument_count - i)(%rbp)          word i of the memoization key
+// Values are moved through registers only for the duration of a single instruction. Functions keep the
+// stack pointer 16 byte aligned, so the runtime (see ASSEMBLY_RUNTIME) can call into libc.
+//
+// The labels must not be resolved yet, so the emitter has to run before CodeGenerator::finalize.
+class AssemblyEmitter {
+private:
+    CodeGenerator& code_generator;
+    std::unordered_map<size_t, size_t> function_indices;
+
+    // Offsets of the stack slots and variables of the function that is currently emitted
+    int64_t slot_count;
+    int64_t variable_count;
+
+    std::string get_slot(int64_t depth) const {
+        return std::to_string(-8 * (depth + 1)) + "(%rbp)";
+    }
+
+    std::string get_variable(int64_t id) const {
+        return std::to_string(-8 * (this->slot_count + id + 1)) + "(%rbp)";
+    }
+
+    std::string get_memo_key(const FunctionCode& function, int64_t word) const {
+        int64_t argument_count = (int64_t) function.get_argument_count();
+        return std::to_string(-8 * (this->slot_count + this->variable_count + argument_count - word)) + "(%rbp)";
+    }
+
+    static std::string get_label(int64_t label) {
+        return ".L" + std::to_string(label);
+    }
+
+    static std::string get_function_name(const FunctionCode& function) {
+        return "ni_" + function.get_name() + "_" + std::to_string(function.get_label());
+    }
+
+    static std::string get_memo_cache_name(const FunctionCode& function) {
+        return "ni_memo_cache_" + std::to_string(function.get_label());
+    }
+
+    static const char *get_native_name(int64_t native_id) {
+        switch (native_id) {
+            case NATIVE_PRINT: return "ni_print";
+            case NATIVE_PRINTLN: return "ni_println";
+            case NATIVE_INT_TO_STRING: return "ni_int_to_string";
+            case NATIVE_CHAR_TO_STRING: return "ni_char_to_string";
+            case NATIVE_STRING_TO_CHAR_LIST: return "ni_string_to_char_list";
+            case NATIVE_CHAR_LIST_TO_STRING: return "ni_char_list_to_string";
+            case NATIVE_FLOAT_TO_STRING: return "ni_float_to_string";
+            case NATIVE_BOOL_TO_STRING: return "ni_bool_to_string";
+            default: assert(false && "unknown native function");
+        }
+        return nullptr;
+    }
+
+    static void emit_line(std::ostream& output_stream, const std::string& line) {
+        output_stream << "    " << line << std::endl;
+    }
+
+    void emit_move(std::ostream& output_stream, const std::string& from, const std::string& to) const {
+        emit_line(output_stream, "movq " + from + ", %rax");
+        emit_line(output_stream, "movq %rax, " + to);
+    }
+
+    // Applies the operation to the two topmost slots, the result is stored in the lower one
+    void emit_integer_operation(std::ostream& output_stream, int64_t depth, const std::string& operation) const {
+        emit_line(output_stream, "movq " + this->get_slot(depth - 2) + ", %rax");
+        emit_line(output_stream, operation + " " + this->get_slot(depth - 1) + ", %rax");
+        emit_line(output_stream, "movq %rax, " + this->get_slot(depth - 2));
+    }
+
+    void emit_float_operation(std::ostream& output_stream, int64_t depth, const std::string& operation) const {
+        emit_line(output_stream, "movsd " + this->get_slot(depth - 2) + ", %xmm0");
+        emit_line(output_stream, operation + " " + this->get_slot(depth - 1) + ", %xmm0");
+        emit_line(output_stream, "movsd %xmm0, " + this->get_slot(depth - 2));
+    }
+
+    void emit_division(std::ostream& output_stream, int64_t depth, const char *result_register) const {
+        emit_line(output_stream, "movq " + this->get_slot(depth - 2) + ", %rax");
+        emit_line(output_stream, "cqto");
+        emit_line(output_stream, "idivq " + this->get_slot(depth - 1));
+        emit_line(output_stream, std::string("movq ") + result_register + ", " + this->get_slot(depth - 2));
+    }
+
+    void emit_shift(std::ostream& output_stream, int64_t depth, const char *operation) const {
+        emit_line(output_stream, "movq " + this->get_slot(depth - 1) + ", %rcx");
+        emit_line(output_stream, std::string(operation) + " %cl, " + this->get_slot(depth - 2));
+    }
+
+    void emit_integer_jump(std::ostream& output_stream, int64_t depth, const char *jump, int64_t label) const {
+        emit_line(output_stream, "movq " + this->get_slot(depth - 2) + ", %rax");
+        emit_line(output_stream, "cmpq " + this->get_slot(depth - 1) + ", %rax");
+        emit_line(output_stream, std::string(jump) + " " + get_label(label));
+    }
+
+    // Only 'above' conditions are used, which are false if one of the operands is NaN
+    void emit_float_jump(std::ostream& output_stream, int64_t left, int64_t right, const char *jump, int64_t label) const {
+        emit_line(output_stream, "movsd " + this->get_slot(left) + ", %xmm0");
+        emit_line(output_stream, "ucomisd " + this->get_slot(right) + ", %xmm0");
+        emit_line(output_stream, std::string(jump) + " " + get_label(label));
+    }
+
+    // Leaves the address of the element in %rax and the index in %rcx, exits if the index is out of bounds
+    void emit_element_address(std::ostream& output_stream, int64_t object_depth, int64_t operand, size_t element_size) const {
+        emit_line(output_stream, "movq " + this->get_slot(object_depth) + ", %rax");
+        emit_line(output_stream, "movq " + this->get_slot(object_depth + 1) + ", %rcx");
+        emit_line(output_stream, "movq " + std::to_string(LIST_LENGTH_OFFSET) + "(%rax), %rdx");
+        // Negative indices are out of bounds as well when they are compared unsigned
+        emit_line(output_stream, "cmpq %rdx, %rcx");
+        emit_line(output_stream, "jb 1f");
+        emit_line(output_stream, "movq %rcx, %rdi");
+        emit_line(output_stream, "movq %rdx, %rsi");
+        emit_line(output_stream, "call ni_fail_index");
+        output_stream << "1:" << std::endl;
+        emit_line(output_stream, "movq " + std::to_string(operand >> 1) + "(%rax), %rax");
+        emit_line(output_stream, "leaq (%rax,%rcx," + std::to_string(element_size) + "), %rax");
+    }
+
+    void emit_instruction(std::ostream& output_stream, const FunctionCode& function, const Instruction& instruction, int64_t depth) const {
+        int64_t operand = instruction.get_operand().as_int;
+        std::string top = depth > 0 ? this->get_slot(depth - 1) : "";
+        std::string next = this->get_slot(depth);
+
+        switch (instruction.get_type()) {
+            case InstructionType::HALT:
+                emit_line(output_stream, "leave");
+                emit_line(output_stream, "ret");
+                break;
+
+            case InstructionType::PUSH:
+                if (operand >= INT32_MIN && operand <= INT32_MAX) {
+                    emit_line(output_stream, "movq $" + std::to_string(operand) + ", " + next);
+                } else {
+                    emit_line(output_stream, "movabsq $" + std::to_string(operand) + ", %rax");
+                    emit_line(output_stream, "movq %rax, " + next);
+                }
+                break;
+            case InstructionType::DUP:
+                this->emit_move(output_stream, top, next);
+                break;
+            case InstructionType::POP:
+                break;
+
+            case InstructionType::HALLOC:
+                emit_line(output_stream, "movq $" + std::to_string(ObjectLayout::predefined_layouts[operand]->get_size()) + ", %rdi");
+                emit_line(output_stream, "movq " + top + ", %rsi");
+                emit_line(output_stream, "call ni_allocate");
+                emit_line(output_stream, "movq %rax, " + top);
+                break;
+            case InstructionType::WRITEW:
+                emit_line(output_stream, "movq " + this->get_slot(depth - 2) + ", %rax");
+                emit_line(output_stream, "movq " + top + ", %rcx");
+                emit_line(output_stream, "movq %rcx, (%rax)");
+                break;
+            case InstructionType::READW:
+                emit_line(output_stream, "movq " + top + ", %rax");
+                emit_line(output_stream, "movq (%rax), %rax");
+                emit_line(output_stream, "movq %rax, " + top);
+                break;
+            case InstructionType::WRITEB:
+                emit_line(output_stream, "movq " + this->get_slot(depth - 2) + ", %rax");
+                emit_line(output_stream, "movq " + top + ", %rcx");
+                emit_line(output_stream, "movb %cl, (%rax)");
+                break;
+            case InstructionType::READB:
+                emit_line(output_stream, "movq " + top + ", %rax");
+                emit_line(output_stream, "movsbq (%rax), %rax");
+                emit_line(output_stream, "movq %rax, " + top);
+                break;
+            case InstructionType::PADD:
+                emit_line(output_stream, "movq " + top + ", %rax");
+                emit_line(output_stream, "addq %rax, " + this->get_slot(depth - 2));
+                break;
+            case InstructionType::SPTR:
+                emit_line(output_stream, "leaq ni_static_data+" + std::to_string(operand) + "(%rip), %rax");
+                emit_line(output_stream, "movq %rax, " + next);
+                break;
+
+            case InstructionType::ELOADW:
+                this->emit_element_address(output_stream, depth - 2, operand, sizeof(Word));
+                emit_line(output_stream, "movq (%rax), %rax");
+                emit_line(output_stream, "movq %rax, " + this->get_slot(depth - 2));
+                break;
+            case InstructionType::ESTOREW:
+                this->emit_element_address(output_stream, depth - 3, operand, sizeof(Word));
+                emit_line(output_stream, "movq " + top + ", %rdx");
+                emit_line(output_stream, "movq %rdx, (%rax)");
+                emit_line(output_stream, "movq %rdx, " + this->get_slot(depth - 3));
+                break;
+            case InstructionType::ELOADB:
+                this->emit_element_address(output_stream, depth - 2, operand, sizeof(char));
+                emit_line(output_stream, "movsbq (%rax), %rax");
+                emit_line(output_stream, "movq %rax, " + this->get_slot(depth - 2));
+                break;
+            case InstructionType::ESTOREB:
+                this->emit_element_address(output_stream, depth - 3, operand, sizeof(char));
+                emit_line(output_stream, "movsbq " + top + ", %rdx");
+                emit_line(output_stream, "movb %dl, (%rax)");
+                emit_line(output_stream, "movq %rdx, " + this->get_slot(depth - 3));
+                break;
+
+            case InstructionType::VLOAD:
+                this->emit_move(output_stream, this->get_variable(operand), next);
+                break;
+            case InstructionType::VWRITE:
+                this->emit_move(output_stream, top, this->get_variable(operand));
+                break;
+
+            case InstructionType::IBNEG:
+                emit_line(output_stream, "notq " + top);
+                break;
+            case InstructionType::FNEG:
+                emit_line(output_stream, "btcq $63, " + top);
+                break;
+            case InstructionType::INEG:
+                emit_line(output_stream, "negq " + top);
+                break;
+            case InstructionType::LNEG:
+                emit_line(output_stream, "cmpq $0, " + top);
+                emit_line(output_stream, "sete %al");
+                emit_line(output_stream, "movzbq %al, %rax");
+                emit_line(output_stream, "movq %rax, " + top);
+                break;
+
+            case InstructionType::IADD: this->emit_integer_operation(output_stream, depth, "addq"); break;
+            case InstructionType::ISUB: this->emit_integer_operation(output_stream, depth, "subq"); break;
+            case InstructionType::IMUL: this->emit_integer_operation(output_stream, depth, "imulq"); break;
+            case InstructionType::IDIV: this->emit_division(output_stream, depth, "%rax"); break;
+            case InstructionType::IMOD: this->emit_division(output_stream, depth, "%rdx"); break;
+            case InstructionType::ISHL: this->emit_shift(output_stream, depth, "shlq"); break;
+            case InstructionType::ISHR: this->emit_shift(output_stream, depth, "sarq"); break;
+            case InstructionType::IAND: this->emit_integer_operation(output_stream, depth, "andq"); break;
+            case InstructionType::IOR: this->emit_integer_operation(output_stream, depth, "orq"); break;
+            case InstructionType::IXOR: this->emit_integer_operation(output_stream, depth, "xorq"); break;
+
+            case InstructionType::FADD: this->emit_float_operation(output_stream, depth, "addsd"); break;
+            case InstructionType::FSUB: this->emit_float_operation(output_stream, depth, "subsd"); break;
+            case InstructionType::FMUL: this->emit_float_operation(output_stream, depth, "mulsd"); break;
+            case InstructionType::FDIV: this->emit_float_operation(output_stream, depth, "divsd"); break;
+
+            case InstructionType::LABEL:
+                output_stream << get_label(operand) << ":" << std::endl;
+                break;
+            case InstructionType::JUMP:
+                emit_line(output_stream, "jmp " + get_label(operand));
+                break;
+            case InstructionType::JNEQ: this->emit_integer_jump(output_stream, depth, "jne", operand); break;
+            case InstructionType::JEQ: this->emit_integer_jump(output_stream, depth, "je", operand); break;
+            case InstructionType::JEQZ:
+                emit_line(output_stream, "cmpq $0, " + top);
+                emit_line(output_stream, "je " + get_label(operand));
+                break;
+
+            case InstructionType::JILT: this->emit_integer_jump(output_stream, depth, "jl", operand); break;
+            case InstructionType::JILE: this->emit_integer_jump(output_stream, depth, "jle", operand); break;
+            case InstructionType::JIGT: this->emit_integer_jump(output_stream, depth, "jg", operand); break;
+            case InstructionType::JIGE: this->emit_integer_jump(output_stream, depth, "jge", operand); break;
+
+            case InstructionType::JFLT: this->emit_float_jump(output_stream, depth - 1, depth - 2, "ja", operand); break;
+            case InstructionType::JFLE: this->emit_float_jump(output_stream, depth - 1, depth - 2, "jae", operand); break;
+            case InstructionType::JFGT: this->emit_float_jump(output_stream, depth - 2, depth - 1, "ja", operand); break;
+            case InstructionType::JFGE: this->emit_float_jump(output_stream, depth - 2, depth - 1, "jae", operand); break;
+
+            // Arguments are pushed in order, the callee aligns the stack pointer again
+            case InstructionType::CALL:
+                {
+                    const FunctionCode& callee = this->code_generator.get_functions()[this->function_indices.at((size_t) operand)];
+                    int64_t argument_count = (int64_t) callee.get_argument_count();
+                    int64_t first_argument = depth - argument_count;
+                    for (int64_t slot = first_argument; slot < depth; slot++) {
+                        emit_line(output_stream, "pushq " + this->get_slot(slot));
+                    }
+                    emit_line(output_stream, "call " + get_function_name(callee));
+                    if (argument_count > 0) {
+                        emit_line(output_stream, "addq $" + std::to_string(8 * argument_count) + ", %rsp");
+                    }
+                    if (callee.get_has_return_value()) {
+                        emit_line(output_stream, "movq %rax, " + this->get_slot(first_argument));
+                    }
+                }
+                break;
+            case InstructionType::NATIVE:
+                emit_line(output_stream, "movq " + top + ", %rdi");
+                emit_line(output_stream, std::string("call ") + get_native_name(operand));
+                if (operand != NATIVE_PRINT && operand != NATIVE_PRINTLN) {
+                    emit_line(output_stream, "movq %rax, " + top);
+                }
+                break;
+            case InstructionType::RET:
+                if (function.get_has_return_value()) {
+                    emit_line(output_stream, "movq " + top + ", %rax");
+                }
+                emit_line(output_stream, "leave");
+                emit_line(output_stream, "ret");
+                break;
+            // The arguments are still in the first slots, see FunctionCode::memoize
+            case InstructionType::MENTER:
+                for (int64_t i = 0; i < operand; i++) {
+                    this->emit_move(output_stream, this->get_slot(i), this->get_memo_key(function, i));
+                }
+                emit_line(output_stream, "leaq " + get_memo_cache_name(function) + "(%rip), %rdi");
+                emit_line(output_stream, "leaq " + this->get_memo_key(function, 0) + ", %rsi");
+                emit_line(output_stream, "movq $" + std::to_string(operand) + ", %rdx");
+                emit_line(output_stream, "call ni_memo_find");
+                emit_line(output_stream, "testq %rax, %rax");
+                emit_line(output_stream, "jz 1f");
+                emit_line(output_stream, "movq NI_MEMO_RESULT_OFFSET(%rax), %rax");
+                emit_line(output_stream, "leave");
+                emit_line(output_stream, "ret");
+                output_stream << "1:" << std::endl;
+                break;
+            case InstructionType::MSTORE:
+                emit_line(output_stream, "leaq " + get_memo_cache_name(function) + "(%rip), %rdi");
+                emit_line(output_stream, "leaq " + this->get_memo_key(function, 0) + ", %rsi");
+                emit_line(output_stream, "movq $" + std::to_string(function.get_argument_count()) + ", %rdx");
+                emit_line(output_stream, "movq " + top + ", %rcx");
+                emit_line(output_stream, "call ni_memo_store");
+                break;
+
+            case InstructionType::I2C:
+                emit_line(output_stream, "andq $255, " + top);
+                break;
+            case InstructionType::I2F:
+                emit_line(output_stream, "cvtsi2sdq " + top + ", %xmm0");
+                emit_line(output_stream, "movsd %xmm0, " + top);
+                break;
+            case InstructionType::F2I:
+                emit_line(output_stream, "cvttsd2siq " + top + ", %rax");
+                emit_line(output_stream, "movq %rax, " + top);
+                break;
+        }
+    }
+
+    void emit_function(std::ostream& output_stream, const FunctionCode& function) {
+        const auto& functions = this->code_generator.get_functions();
+        const auto& instructions = function.get_instructions();
+        std::vector<int64_t> depths = compute_operand_stack_depths(functions, this->function_indices, function);
+        int64_t argument_count = (int64_t) function.get_argument_count();
+
+        this->slot_count = get_max_operand_stack_depth(functions, this->function_indices, function, depths);
+        this->variable_count = (int64_t) function.get_frame_size();
+        int64_t word_count = this->slot_count + this->variable_count + (function.is_memoized() ? argument_count : 0);
+
+        output_stream << std::endl;
+        output_stream << get_function_name(function) << ":" << std::endl;
+        emit_line(output_stream, "pushq %rbp");
+        emit_line(output_stream, "movq %rsp, %rbp");
+        if (word_count > 0) {
+            emit_line(output_stream, "subq $" + std::to_string(8 * word_count) + ", %rsp");
+        }
+        emit_line(output_stream, "andq $-16, %rsp");
+        for (int64_t i = 0; i < argument_count; i++) {
+            this->emit_move(output_stream, std::to_string(16 + 8 * (argument_count - 1 - i)) + "(%rbp)", this->get_slot(i));
+        }
+        for (int64_t i = 0; i < this->variable_count; i++) {
+            emit_line(output_stream, "movq $0, " + this->get_variable(i));
+        }
+
+        for (size_t i = 0; i < instructions.size(); i++) {
+            if (depths[i] >= 0) {
+                this->emit_instruction(output_stream, function, instructions[i], depths[i]);
+            }
+        }
+    }
+
+    static void emit_static_data(std::ostream& output_stream, const std::vector<char>& static_data) {
+        output_stream << std::endl;
+        emit_line(output_stream, ".data");
+        emit_line(output_stream, ".balign 8");
+        output_stream << "ni_static_data:" << std::endl;
+        for (size_t i = 0; i < static_data.size(); i += ASSEMBLY_STATIC_DATA_BYTES_PER_LINE) {
+            output_stream << "    .byte ";
+            for (size_t j = i; j < std::min(i + ASSEMBLY_STATIC_DATA_BYTES_PER_LINE, static_data.size()); j++) {
+                output_stream << (j > i ? ", " : "") << (int) (uint8_t) static_data[j];
+            }
+            output_stream << std::endl;
+        }
+    }
+
+public:
+    AssemblyEmitter(CodeGenerator& code_generator)
+        : code_generator(code_generator), function_indices(collect_function_indices(code_generator.get_functions())), slot_count(0), variable_count(0)
+    {}
+
+    void emit(std::ostream& output_stream) {
+        const auto& functions = this->code_generator.get_functions();
+        assert(this->code_generator.has_main_label());
+
+        output_stream << "# Emitted from ni, do not edit" << std::endl;
+        emit_line(output_stream, ".set LIST_LENGTH_OFFSET, " + std::to_string(LIST_LENGTH_OFFSET));
+        emit_line(output_stream, ".set LIST_CAPACITY_OFFSET, " + std::to_string(LIST_CAPACITY_OFFSET));
+        emit_line(output_stream, ".set LIST_DATA_OFFSET, " + std::to_string(LIST_DATA_OFFSET));
+        emit_line(output_stream, ".set LIST_SIZE, " + std::to_string(LIST_SIZE));
+        emit_line(output_stream, ".set STRING_LENGTH_OFFSET, " + std::to_string(STRING_LENGTH_OFFSET));
+        emit_line(output_stream, ".set STRING_DATA_OFFSET, " + std::to_string(STRING_DATA_OFFSET));
+        emit_line(output_stream, ".set STRING_SIZE, " + std::to_string(STRING_SIZE));
+        emit_line(output_stream, ".set NI_MEMO_BUCKET_COUNT, " + std::to_string(MEMO_BUCKET_COUNT));
+        emit_line(output_stream, ".set NI_MEMO_NEXT_OFFSET, 0");
+        emit_line(output_stream, ".set NI_MEMO_RESULT_OFFSET, 8");
+        emit_line(output_stream, ".set NI_MEMO_KEY_OFFSET, 16");
+        output_stream << ASSEMBLY_RUNTIME;
+
+        for (const auto& function : functions) {
+            this->emit_function(output_stream, function);
+        }
+
+        const FunctionCode& main_function = functions[this->function_indices.at(this->code_generator.get_main_label())];
+        output_stream << std::endl;
+        emit_line(output_stream, ".globl main");
+        output_stream << "main:" << std::endl;
+        emit_line(output_stream, "pushq %rbp");
+        emit_line(output_stream, "movq %rsp, %rbp");
+        emit_line(output_stream, "call " + get_function_name(main_function));
+        emit_line(output_stream, "xorl %eax, %eax");
+        emit_line(output_stream, "popq %rbp");
+        emit_line(output_stream, "ret");
+
+        emit_static_data(output_stream, this->code_generator.get_static_data());
+
+        output_stream << std::endl;
+        emit_line(output_stream, ".bss");
+        emit_line(output_stream, ".balign 8");
+        for (const auto& function : functions) {
+            if (function.is_memoized()) {
+                output_stream << get_memo_cache_name(function) << ":" << std::endl;
+                emit_line(output_stream, ".zero 8");
+            }
+        }
+
+        output_stream << std::endl;
+        emit_line(output_stream, ".section .note.GNU-stack,\"\",@progbits");
+    }
+
+    ~AssemblyEmitter() {}
+};
@@ -0,0 +1,64 @@
+
+#define AST_ARENA_BLOCK_SIZE (64 * 1024)
+
+// Owns all nodes of the syntax tree of a compilation. Nodes are placed one after the other in large blocks instead
+// of being allocated one by one, and refer to their children by plain pointers. The whole tree is destroyed in one
+// step by clear() once the code is emitted: the destructors of the nodes are run in reverse order of creation
+// (so no destructor has to walk the tree) and the blocks are freed.
+class AstArena {
+private:
+    static AstArena instance;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t block_used;
+    size_t block_size;
+    std::vector<std::pair<void *, void (*)(void *)>> destructors;
+
+    AstArena() : blocks(), block_used(0), block_size(0), destructors() {}
+
+    void *allocate(size_t size, size_t alignment) {
+        size_t offset = (this->block_used + alignment - 1) & ~(alignment - 1);
+        if (this->blocks.empty() || offset + size > this->block_size) {
+            // Nodes that do not fit into a block get their own block
+            this->block_size = std::max((size_t) AST_ARENA_BLOCK_SIZE, size);
+            this->blocks.push_back(std::make_unique<char[]>(this->block_size));
+            offset = 0;
+        }
+        this->block_used = offset + size;
+        return this->blocks.back().get() + offset;
+    }
+
+public:
+    AstArena(AstArena& other) = delete;
+
+    static AstArena& get() {
+        return instance;
+    }
+
+    template<typename T, typename... Arguments>
+    T *create(Arguments&&... arguments) {
+        static_assert(alignof(T) <= alignof(max_align_t));
+        T *node = new (this->allocate(sizeof(T), alignof(T))) T(std::forward<Arguments>(arguments)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            this->destructors.push_back({ node, [](void *pointer) { static_cast<T *>(pointer)->~T(); } });
+        }
+        return node;
+    }
+
+    // Destroys all nodes, pointers to them must not be used anymore
+    void clear() {
+        for (auto destructor = this->destructors.rbegin(); destructor != this->destructors.rend(); destructor++) {
+            destructor->second(destructor->first);
+        }
+        this->destructors.clear();
+        this->blocks.clear();
+        this->block_used = 0;
+        this->block_size = 0;
+    }
+
+    ~AstArena() {
+        this->clear();
+    }
+};
+
+AstArena AstArena::instance;
@@ -0,0 +1,256 @@
+
+#define ROTATION_MIN_TRIP_COUNT 1.0
+#define ROTATION_CONDITION_LIMIT 24
+
+// Orders the code of loops and if statements by a profile (see Profile), so the frequently executed path falls
+// through its branches instead of executing an additional JUMP. Without a profile the code is not changed.
+//
+// Loops that usually jump back at least once are rotated: the loop condition is copied behind the loop body with
+// the exit branch inverted, so every further iteration executes a single conditional branch instead of the JUMP
+// back to the condition and the branch out of the loop:
+//      LABEL head                          LABEL head
+//      <condition> JIGE exit               <condition> JIGE exit
+//      <body>                      ->      LABEL body
+//      JUMP head                           <body>
+//      LABEL exit                          <copy of condition> JILT body
+//                                          LABEL exit
+// Float comparisons and JEQZ have no inverted branch, those loops are left to LoopUnroller.
+//
+// If statements whose then-branch is executed more often than their else-branch are swapped,
+// so the JUMP over the else-branch is only executed on the less frequent path.
+class BlockLayout : public OptimizationPass {
+private:
+    static bool invert_branch(InstructionType type, InstructionType& inverted) {
+        switch (type) {
+            case InstructionType::JEQ:  inverted = InstructionType::JNEQ; return true;
+            case InstructionType::JNEQ: inverted = InstructionType::JEQ;  return true;
+            case InstructionType::JILT: inverted = InstructionType::JIGE; return true;
+            case InstructionType::JIGE: inverted = InstructionType::JILT; return true;
+            case InstructionType::JILE: inverted = InstructionType::JIGT; return true;
+            case InstructionType::JIGT: inverted = InstructionType::JILE; return true;
+            default:
+                return false;
+        }
+    }
+
+    // Checks whether all branches in [begin, end] jump to one of the labels defined there or to one of the given labels
+    static bool is_closed_region(const std::vector<Instruction>& instructions, size_t begin, size_t end, const std::unordered_set<int64_t>& exits) {
+        std::unordered_set<int64_t> labels;
+        for (size_t i = begin; i <= end; i++) {
+            if (instructions[i].get_type() == InstructionType::LABEL) {
+                labels.insert(instructions[i].get_operand().as_int);
+            }
+        }
+        for (size_t i = begin; i <= end; i++) {
+            int64_t target = instructions[i].get_operand().as_int;
+            if (is_branch_instruction(instructions[i].get_type()) && !labels.contains(target) && !exits.contains(target)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Checks whether the labels defined in [begin, end) are only jumped to from inside of [begin, end)
+    static bool is_entered_only_at_begin(const std::vector<Instruction>& instructions, size_t begin, size_t end) {
+        std::unordered_set<int64_t> labels;
+        for (size_t i = begin; i < end; i++) {
+            if (instructions[i].get_type() == InstructionType::LABEL) {
+                labels.insert(instructions[i].get_operand().as_int);
+            }
+        }
+        for (size_t i = 0; i < instructions.size(); i++) {
+            bool is_inside = i >= begin && i < end;
+            if (!is_inside && is_branch_instruction(instructions[i].get_type()) && labels.contains(instructions[i].get_operand().as_int)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Rotates the loop from the label at 'header' to the JUMP back at 'back_edge', returns false if it is not rotated
+    bool rotate_loop(CodeGenerator& code_generator, std::vector<Instruction>& instructions, size_t header, size_t back_edge) const {
+        const Profile *profile = code_generator.get_profile();
+        size_t loop_label = code_generator.get_label_origin((size_t) instructions[header].get_operand().as_int);
+        if (!profile->has_loop(loop_label) || profile->get_average_trip_count(loop_label) < ROTATION_MIN_TRIP_COUNT) {
+            return false;
+        }
+        if (back_edge + 1 >= instructions.size() || instructions[back_edge + 1].get_type() != InstructionType::LABEL) {
+            return false;
+        }
+        int64_t exit_label = instructions[back_edge + 1].get_operand().as_int;
+
+        // The condition ends with the first invertible branch out of the loop that is only left through its end or the loop exit
+        size_t condition_end = 0;
+        InstructionType inverted = InstructionType::JUMP;
+        for (size_t i = header + 1; i < back_edge && i <= header + ROTATION_CONDITION_LIMIT; i++) {
+            InstructionType type = instructions[i].get_type();
+            if (type == InstructionType::RET || type == InstructionType::HALT) {
+                return false;
+            }
+            if (instructions[i].get_operand().as_int != exit_label || !invert_branch(type, inverted)) {
+                continue;
+            }
+
+            std::unordered_set<int64_t> exits { exit_label };
+            if (instructions[i+1].get_type() == InstructionType::LABEL) {
+                exits.insert(instructions[i+1].get_operand().as_int);
+            }
+            if (is_closed_region(instructions, header + 1, i, exits)) {
+                condition_end = i;
+                break;
+            }
+        }
+        if (condition_end == 0) {
+            return false;
+        }
+
+        std::vector<Instruction> output(instructions.begin(), instructions.begin() + condition_end + 1);
+        int64_t body_label;
+        if (instructions[condition_end + 1].get_type() == InstructionType::LABEL) {
+            body_label = instructions[condition_end + 1].get_operand().as_int;
+        } else {
+            body_label = (int64_t) code_generator.generate_label();
+            output.push_back(Instruction(InstructionType::LABEL, Word { .as_int = body_label }));
+        }
+        output.insert(output.end(), instructions.begin() + condition_end + 1, instructions.begin() + back_edge);
+
+        std::unordered_map<int64_t, int64_t> label_map;
+        for (size_t i = header + 1; i < condition_end; i++) {
+            if (instructions[i].get_type() == InstructionType::LABEL) {
+                int64_t label = instructions[i].get_operand().as_int;
+                label_map[label] = (int64_t) code_generator.generate_label_copy((size_t) label);
+            }
+        }
+        for (size_t i = header + 1; i < condition_end; i++) {
+            Instruction instruction = instructions[i];
+            InstructionType type = instruction.get_type();
+            auto mapped_label = label_map.find(instruction.get_operand().as_int);
+            if ((type == InstructionType::LABEL || is_branch_instruction(type)) && mapped_label != label_map.end()) {
+                instruction.set_operand(Word { .as_int = mapped_label->second });
+            }
+            output.push_back(instruction);
+        }
+        output.push_back(Instruction(inverted, Word { .as_int = body_label }));
+
+        output.insert(output.end(), instructions.begin() + back_edge + 1, instructions.end());
+        instructions = std::move(output);
+        return true;
+    }
+
+    // Swaps the branches of the if statement whose else-branch is jumped to by the branch at 'branch',
+    // returns false if they are not swapped:
+    //      Jcc else                    J!cc then
+    //      <then-branch>               <else-branch>
+    //      JUMP end            ->      JUMP end
+    //      LABEL else                  LABEL then
+    //      <else-branch>               <then-branch>
+    //      LABEL end                   LABEL end
+    bool swap_branches(CodeGenerator& code_generator, std::vector<Instruction>& instructions, size_t branch, const BranchKey& key) const {
+        const Profile *profile = code_generator.get_profile();
+        InstructionType inverted;
+        if (!profile->has_branch(key) || !invert_branch(instructions[branch].get_type(), inverted)) {
+            return false;
+        }
+        const auto& [taken, not_taken] = profile->get_branch_counts(key);
+        if (not_taken <= taken) {
+            return false;
+        }
+
+        auto label_positions = collect_label_positions(instructions);
+        int64_t else_label = instructions[branch].get_operand().as_int;
+        size_t else_position = label_positions.at(else_label);
+        if (else_position <= branch + 1 || instructions[else_position - 1].get_type() != InstructionType::JUMP) {
+            return false;
+        }
+        size_t end_position = label_positions.at(instructions[else_position - 1].get_operand().as_int);
+        if (end_position <= else_position) {
+            return false;
+        }
+
+        // Both branches have to be entered only through the branch instruction
+        for (size_t i = 0; i < instructions.size(); i++) {
+            if (i != branch && is_branch_instruction(instructions[i].get_type()) && instructions[i].get_operand().as_int == else_label) {
+                return false;
+            }
+        }
+        if (!is_entered_only_at_begin(instructions, branch + 1, else_position - 1) || !is_entered_only_at_begin(instructions, else_position + 1, end_position)) {
+            return false;
+        }
+
+        int64_t then_label = (int64_t) code_generator.generate_label();
+        std::vector<Instruction> output(instructions.begin(), instructions.begin() + branch);
+        output.push_back(Instruction(inverted, Word { .as_int = then_label }));
+        output.insert(output.end(), instructions.begin() + else_position + 1, instructions.begin() + end_position);
+        InstructionType last_type = output.back().get_type();
+        if (last_type != InstructionType::JUMP && last_type != InstructionType::RET && last_type != InstructionType::HALT) {
+            output.push_back(instructions[else_position - 1]);
+        }
+        output.push_back(Instruction(InstructionType::LABEL, Word { .as_int = then_label }));
+        output.insert(output.end(), instructions.begin() + branch + 1, instructions.begin() + else_position - 1);
+        output.insert(output.end(), instructions.begin() + end_position, instructions.end());
+        instructions = std::move(output);
+        return true;
+    }
+
+    void layout_loops(CodeGenerator& code_generator, std::vector<Instruction>& instructions) const {
+        std::unordered_set<int64_t> visited_loops;
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (const auto& [header, back_edge] : find_loops(instructions)) {
+                int64_t label = instructions[header].get_operand().as_int;
+                if (visited_loops.contains(label)) {
+                    continue;
+                }
+                visited_loops.insert(label);
+                if (this->rotate_loop(code_generator, instructions, header, back_edge)) {
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    void layout_branches(CodeGenerator& code_generator, FunctionCode& function) const {
+        auto& instructions = function.get_instructions();
+        std::unordered_set<int64_t> visited_labels;
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (const auto& [branch, key] : collect_branch_keys(code_generator, function)) {
+                int64_t label = instructions[branch].get_operand().as_int;
+                if (visited_labels.contains(label)) {
+                    continue;
+                }
+                visited_labels.insert(label);
+                if (this->swap_branches(code_generator, instructions, branch, key)) {
+                    // The inverted branch jumps to the new label of the then-branch
+                    visited_labels.insert(instructions[branch].get_operand().as_int);
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+public:
+    BlockLayout() {}
+
+    virtual const char *get_name() const override {
+        return "block-layout";
+    }
+
+    virtual void run(CodeGenerator& code_generator) override {
+        if (code_generator.get_profile() == nullptr) {
+            return;
+        }
+
+        // The branches are looked up in the profile before the loop conditions are copied
+        for (auto& function : code_generator.get_functions()) {
+            this->layout_branches(code_generator, function);
+            this->layout_loops(code_generator, function.get_instructions());
+        }
+    }
+
+    ~BlockLayout() {}
+};
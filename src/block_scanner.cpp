@@ -0,0 +1,59 @@
+// Block-wise part of the scans in source_scanner.cpp. Included once per instruction set, inside of a namespace that
+// defines ScanVector, SCAN_WIDTH, SCAN_FULL_MASK and the scan_* primitives.
+//
+// Every function skips the full blocks that only contain characters of its class and returns the position of the first
+// character outside of the class, or the position of the first block that is not full. The callers compare the
+// remaining characters one by one.
+
+// Lanes of the characters that are in [low, low + count)
+static inline ScanVector scan_in_range(ScanVector characters, char low, int count) {
+    ScanVector shifted = scan_add(characters, scan_splat((int8_t) (128 - low)));
+    return scan_less(shifted, scan_splat((int8_t) (-128 + count)));
+}
+
+static inline ScanVector scan_whitespace(ScanVector characters) {
+    return scan_or(scan_equal(characters, scan_splat(' ')), scan_in_range(characters, '\t', 5));
+}
+
+static inline ScanVector scan_name_characters(ScanVector characters) {
+    ScanVector letters = scan_in_range(scan_or(characters, scan_splat(0x20)), 'a', 26);
+    ScanVector digits = scan_in_range(characters, '0', 10);
+    return scan_or(scan_or(letters, digits), scan_equal(characters, scan_splat('_')));
+}
+
+static inline ScanVector scan_line_ends(ScanVector characters) {
+    return scan_or(scan_equal(characters, scan_splat('\n')), scan_equal(characters, scan_splat('\0')));
+}
+
+size_t skip_whitespace_blocks(std::string_view source, size_t position) {
+    while (position + SCAN_WIDTH <= source.size()) {
+        uint32_t other_characters = ~scan_mask(scan_whitespace(scan_load(source.data() + position))) & SCAN_FULL_MASK;
+        if (other_characters != 0) {
+            return position + (size_t) __builtin_ctz(other_characters);
+        }
+        position += SCAN_WIDTH;
+    }
+    return position;
+}
+
+size_t skip_name_character_blocks(std::string_view source, size_t position) {
+    while (position + SCAN_WIDTH <= source.size()) {
+        uint32_t other_characters = ~scan_mask(scan_name_characters(scan_load(source.data() + position))) & SCAN_FULL_MASK;
+        if (other_characters != 0) {
+            return position + (size_t) __builtin_ctz(other_characters);
+        }
+        position += SCAN_WIDTH;
+    }
+    return position;
+}
+
+size_t skip_line_blocks(std::string_view source, size_t position) {
+    while (position + SCAN_WIDTH <= source.size()) {
+        uint32_t line_ends = scan_mask(scan_line_ends(scan_load(source.data() + position)));
+        if (line_ends != 0) {
+            return position + (size_t) __builtin_ctz(line_ends);
+        }
+        position += SCAN_WIDTH;
+    }
+    return position;
+}
@@ -0,0 +1,212 @@
+
+#define BYTECODE_ERROR(path, message) \
+    do { \
+        std::cerr << (path) << ": BYTECODE_ERROR: " << message << std::endl; \
+        std::exit(1); \
+    } while(0)
+
+// Has to be increased whenever the layout of the file or the instruction set changes
+#define BYTECODE_VERSION 2
+#define BYTECODE_MAGIC "NIBC"
+#define BYTECODE_MAGIC_SIZE 4
+
+// Layout of a precompiled program (.nic):
+//      header
+//      key: key_size bytes, zero padded to a multiple of 8 bytes
+//      instructions: instruction_count * { uint32 type, uint32 padding, int64 operand }
+//      static data: static_data_size bytes
+//
+// The instructions are stored exactly like they are laid out in memory, so a mapped file can be executed directly.
+// The key is empty, except for entries of the compilation cache, which store the key they were found by.
+struct BytecodeHeader {
+    char magic[BYTECODE_MAGIC_SIZE];
+    uint32_t version;
+    uint64_t key_size;
+    uint64_t instruction_count;
+    uint64_t static_data_size;
+};
+
+static inline size_t get_padded_key_size(size_t key_size) {
+    return (key_size + alignof(Instruction) - 1) & ~(alignof(Instruction) - 1);
+}
+
+static_assert(sizeof(BytecodeHeader) % alignof(Instruction) == 0);
+static_assert(sizeof(Instruction) == 2 * sizeof(Word) && sizeof(InstructionType) == sizeof(uint32_t));
+static_assert(std::is_trivially_copyable_v<Instruction>);
+
+#define INSTRUCTION_ENTRY(x) + 1
+constexpr uint32_t INSTRUCTION_TYPE_COUNT = 0 INSTRUCTION_TYPE_LIST;
+#undef INSTRUCTION_ENTRY
+
+// Returns false if the file could not be written
+bool write_bytecode_file(const std::string& path, const std::vector<Instruction>& program, const std::vector<char>& static_data, std::string_view key = "") {
+    std::ofstream output_stream(path, std::ios::binary);
+    if (!output_stream) {
+        return false;
+    }
+
+    BytecodeHeader header;
+    std::memcpy(header.magic, BYTECODE_MAGIC, BYTECODE_MAGIC_SIZE);
+    header.version = BYTECODE_VERSION;
+    header.key_size = key.size();
+    header.instruction_count = program.size();
+    header.static_data_size = static_data.size();
+    output_stream.write((const char *) &header, sizeof(header));
+
+    std::string padding(get_padded_key_size(key.size()) - key.size(), '\0');
+    output_stream.write(key.data(), key.size());
+    output_stream.write(padding.data(), padding.size());
+
+    // Written field by field, so the padding is always zero
+    for (const auto& instruction : program) {
+        uint32_t type = (uint32_t) instruction.get_type();
+        uint32_t padding = 0;
+        int64_t operand = instruction.get_operand().as_int;
+        output_stream.write((const char *) &type, sizeof(type));
+        output_stream.write((const char *) &padding, sizeof(padding));
+        output_stream.write((const char *) &operand, sizeof(operand));
+    }
+
+    output_stream.write(static_data.data(), static_data.size());
+    output_stream.close();
+    return !output_stream.fail();
+}
+
+// Checks whether the file starts like a precompiled program, so it does not have to be compiled
+bool is_bytecode_file(const std::string& path) {
+    std::ifstream input_stream(path, std::ios::binary);
+    char magic[BYTECODE_MAGIC_SIZE];
+    if (!input_stream.read(magic, BYTECODE_MAGIC_SIZE)) {
+        return false;
+    }
+    return std::memcmp(magic, BYTECODE_MAGIC, BYTECODE_MAGIC_SIZE) == 0;
+}
+
+// Precompiled program that is mapped into memory, it has to outlive the virtual machine executing it
+class BytecodeFile {
+private:
+    std::string path;
+    void *mapping;
+    size_t mapping_size;
+    const Instruction *instructions;
+    size_t instruction_count;
+    char *static_data;
+
+    // The virtual machine does not check the operands, so a corrupt file could make it jump, read or write anywhere
+    bool is_operand_valid(const Instruction& instruction, size_t static_data_size) const {
+        InstructionType type = instruction.get_type();
+        uint64_t operand = (uint64_t) instruction.get_operand().as_int;
+        if (is_jump_instruction(type)) {
+            return operand < this->instruction_count;
+        }
+        switch (type) {
+            // The data of an empty string may start at the end of the static data
+            case InstructionType::SPTR:
+                return operand <= static_data_size;
+            case InstructionType::HALLOC:
+                return operand < PREDEFINED_LAYOUT_COUNT;
+            case InstructionType::NATIVE:
+                return operand < NATIVE_FUNCTION_COUNT;
+            default:
+                return true;
+        }
+    }
+public:
+    BytecodeFile(const std::string& path)
+        : path(path), mapping(MAP_FAILED), mapping_size(0), instructions(nullptr), instruction_count(0), static_data(nullptr)
+    {}
+
+    // Maps and validates the file, returns false and sets the error message if it is not a valid precompiled program.
+    // If an expected key is given, the file must have been stored with exactly this key.
+    bool map(std::string& error_message, const std::string *expected_key = nullptr) {
+        int file_descriptor = open(this->path.c_str(), O_RDONLY);
+        if (file_descriptor < 0) {
+            error_message = "Could not open file.";
+            return false;
+        }
+
+        struct stat file_status;
+        if (fstat(file_descriptor, &file_status) < 0 || (size_t) file_status.st_size < sizeof(BytecodeHeader)) {
+            close(file_descriptor);
+            error_message = "File is too small to be a precompiled program.";
+            return false;
+        }
+
+        // Mapped privately and writable, the virtual machine treats the static data like any other object memory
+        this->mapping_size = (size_t) file_status.st_size;
+        this->mapping = mmap(nullptr, this->mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file_descriptor, 0);
+        close(file_descriptor);
+        if (this->mapping == MAP_FAILED) {
+            error_message = "Could not map file into memory.";
+            return false;
+        }
+
+        const BytecodeHeader *header = (const BytecodeHeader *) this->mapping;
+        if (std::memcmp(header->magic, BYTECODE_MAGIC, BYTECODE_MAGIC_SIZE) != 0) {
+            error_message = "File is not a precompiled program.";
+            return false;
+        }
+        if (header->version != BYTECODE_VERSION) {
+            error_message = "Unsupported version " + std::to_string(header->version) + ", expected version " + std::to_string(BYTECODE_VERSION) + ".";
+            return false;
+        }
+
+        size_t available_size = this->mapping_size - sizeof(BytecodeHeader);
+        if (header->key_size > available_size || get_padded_key_size(header->key_size) > available_size) {
+            error_message = "Size of the file does not match its header.";
+            return false;
+        }
+
+        const char *key = (const char *) this->mapping + sizeof(BytecodeHeader);
+        if (expected_key != nullptr && std::string_view(key, header->key_size) != *expected_key) {
+            error_message = "File was stored for another program.";
+            return false;
+        }
+
+        available_size -= get_padded_key_size(header->key_size);
+        if (header->instruction_count > available_size / sizeof(Instruction) ||
+            header->static_data_size != available_size - header->instruction_count * sizeof(Instruction)) {
+            error_message = "Size of the file does not match its header.";
+            return false;
+        }
+
+        this->instruction_count = header->instruction_count;
+        this->instructions = (const Instruction *) (key + get_padded_key_size(header->key_size));
+        this->static_data = (char *) this->instructions + this->instruction_count * sizeof(Instruction);
+
+        for (size_t i = 0; i < this->instruction_count; i++) {
+            uint32_t type;
+            std::memcpy(&type, &this->instructions[i], sizeof(type));
+            if (type >= INSTRUCTION_TYPE_COUNT) {
+                error_message = "Unknown instruction type " + std::to_string(type) + " at instruction " + std::to_string(i) + ".";
+                return false;
+            }
+            if (!this->is_operand_valid(this->instructions[i], header->static_data_size)) {
+                error_message = "Invalid operand " + std::to_string(this->instructions[i].get_operand().as_int) + " of instruction " + std::to_string(i) + ".";
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    BytecodeFile(const BytecodeFile& other) = delete;
+
+    const Instruction *get_instructions() const {
+        return this->instructions;
+    }
+
+    size_t get_instruction_count() const {
+        return this->instruction_count;
+    }
+
+    char *get_static_data() const {
+        return this->static_data;
+    }
+
+    ~BytecodeFile() {
+        if (this->mapping != MAP_FAILED) {
+            munmap(this->mapping, this->mapping_size);
+        }
+    }
+};
@@ -0,0 +1,540 @@
+
+// Runtime that is copied into every translated program. The layouts of lists and strings are defined in front of it,
+// so objects look exactly like they do in the virtual machine. The functions are inline, so the C compiler does not
+// warn about the ones the program does not use.
+static const char *C_RUNTIME = R"(
+typedef union {
+    int64_t as_int;
+    double as_float;
+    void *as_pointer;
+} Word;
+
+#define WORD_AT_OFFSET(pointer, offset) (*(Word *) ((char *) (pointer) + (offset)))
+
+static inline void *ni_allocate(size_t size, int64_t count) {
+    void *data = malloc(size * (size_t) count);
+    if (data == NULL && size * (size_t) count > 0) {
+        fflush(stdout);
+        fprintf(stderr, "RUNTIME_ERROR: Out of memory.\n");
+        exit(1);
+    }
+    return data;
+}
+
+static inline void *ni_element_address(void *object, int64_t index, size_t data_offset, size_t element_size) {
+    int64_t length = WORD_AT_OFFSET(object, LIST_LENGTH_OFFSET).as_int;
+    if (index < 0 || index >= length) {
+        fflush(stdout);
+        fprintf(stderr, "RUNTIME_ERROR: Index %" PRId64 " is out of bounds for length %" PRId64 ".\n", index, length);
+        exit(1);
+    }
+    return (char *) WORD_AT_OFFSET(object, data_offset).as_pointer + index * (int64_t) element_size;
+}
+
+static inline Word ni_make_string(const char *data, size_t length) {
+    void *string_object = ni_allocate(STRING_SIZE, 1);
+    char *string_data = ni_allocate(1, (int64_t) length);
+    memcpy(string_data, data, length);
+    WORD_AT_OFFSET(string_object, STRING_LENGTH_OFFSET).as_int = (int64_t) length;
+    WORD_AT_OFFSET(string_object, STRING_DATA_OFFSET).as_pointer = string_data;
+    return (Word) { .as_pointer = string_object };
+}
+
+static inline void ni_print(Word string) {
+    size_t length = (size_t) WORD_AT_OFFSET(string.as_pointer, STRING_LENGTH_OFFSET).as_int;
+    fwrite(WORD_AT_OFFSET(string.as_pointer, STRING_DATA_OFFSET).as_pointer, 1, length, stdout);
+}
+
+static inline void ni_println(Word string) {
+    ni_print(string);
+    putchar('\n');
+}
+
+static inline Word ni_int_to_string(Word value) {
+    char buffer[32];
+    int length = snprintf(buffer, sizeof(buffer), "%" PRId64, value.as_int);
+    return ni_make_string(buffer, (size_t) length);
+}
+
+static inline Word ni_char_to_string(Word value) {
+    char character = (char) value.as_int;
+    return ni_make_string(&character, 1);
+}
+
+static inline Word ni_string_to_char_list(Word string) {
+    int64_t length = WORD_AT_OFFSET(string.as_pointer, STRING_LENGTH_OFFSET).as_int;
+    void *char_list = ni_allocate(LIST_SIZE, 1);
+    char *char_list_data = ni_allocate(1, length);
+    memcpy(char_list_data, WORD_AT_OFFSET(string.as_pointer, STRING_DATA_OFFSET).as_pointer, (size_t) length);
+    WORD_AT_OFFSET(char_list, LIST_LENGTH_OFFSET).as_int = length;
+    WORD_AT_OFFSET(char_list, LIST_CAPACITY_OFFSET).as_int = length * 2;
+    WORD_AT_OFFSET(char_list, LIST_DATA_OFFSET).as_pointer = char_list_data;
+    return (Word) { .as_pointer = char_list };
+}
+
+static inline Word ni_char_list_to_string(Word char_list) {
+    int64_t length = WORD_AT_OFFSET(char_list.as_pointer, LIST_LENGTH_OFFSET).as_int;
+    return ni_make_string(WORD_AT_OFFSET(char_list.as_pointer, LIST_DATA_OFFSET).as_pointer, (size_t) length);
+}
+
+/* Same format as std::to_string */
+static inline Word ni_float_to_string(Word value) {
+    int length = snprintf(NULL, 0, "%f", value.as_float);
+    char *buffer = ni_allocate(1, (int64_t) length + 1);
+    snprintf(buffer, (size_t) length + 1, "%f", value.as_float);
+    Word string = ni_make_string(buffer, (size_t) length);
+    free(buffer);
+    return string;
+}
+
+static inline Word ni_bool_to_string(Word value) {
+    return value.as_int == 0 ? ni_make_string("false", 5) : ni_make_string("true", 4);
+}
+
+/* Results of a memoized function keyed by the words of its arguments */
+typedef struct NiMemoEntry {
+    struct NiMemoEntry *next;
+    Word result;
+    int64_t key[];
+} NiMemoEntry;
+
+typedef struct {
+    NiMemoEntry **buckets;
+    size_t bucket_count;
+    size_t entry_count;
+} NiMemoCache;
+
+static inline size_t ni_memo_hash(const int64_t *key, size_t argument_count) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < argument_count; i++) {
+        hash = (hash ^ (uint64_t) key[i]) * 1099511628211ull;
+        hash ^= hash >> 32;
+    }
+    return (size_t) hash;
+}
+
+static inline int ni_memo_lookup(const NiMemoCache *cache, const int64_t *key, size_t argument_count, Word *result) {
+    if (cache->bucket_count == 0) {
+        return 0;
+    }
+    NiMemoEntry *entry = cache->buckets[ni_memo_hash(key, argument_count) % cache->bucket_count];
+    for (; entry != NULL; entry = entry->next) {
+        if (memcmp(entry->key, key, argument_count * sizeof(int64_t)) == 0) {
+            *result = entry->result;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static inline void ni_memo_store(NiMemoCache *cache, const int64_t *key, size_t argument_count, Word result) {
+    if (cache->entry_count >= cache->bucket_count) {
+        size_t bucket_count = cache->bucket_count == 0 ? 64 : cache->bucket_count * 2;
+        NiMemoEntry **buckets = calloc(bucket_count, sizeof(NiMemoEntry *));
+        if (buckets == NULL) {
+            return;
+        }
+        for (size_t i = 0; i < cache->bucket_count; i++) {
+            NiMemoEntry *entry = cache->buckets[i];
+            while (entry != NULL) {
+                NiMemoEntry *next = entry->next;
+                size_t bucket = ni_memo_hash(entry->key, argument_count) % bucket_count;
+                entry->next = buckets[bucket];
+                buckets[bucket] = entry;
+                entry = next;
+            }
+        }
+        free(cache->buckets);
+        cache->buckets = buckets;
+        cache->bucket_count = bucket_count;
+    }
+
+    size_t bucket = ni_memo_hash(key, argument_count) % cache->bucket_count;
+    for (NiMemoEntry *entry = cache->buckets[bucket]; entry != NULL; entry = entry->next) {
+        if (memcmp(entry->key, key, argument_count * sizeof(int64_t)) == 0) {
+            entry->result = result;
+            return;
+        }
+    }
+
+    NiMemoEntry *entry = malloc(sizeof(NiMemoEntry) + argument_count * sizeof(int64_t));
+    if (entry == NULL) {
+        return;
+    }
+    memcpy(entry->key, key, argument_count * sizeof(int64_t));
+    entry->result = result;
+    entry->next = cache->buckets[bucket];
+    cache->buckets[bucket] = entry;
+    cache->entry_count += 1;
+}
+)";
+
+#define C_STATIC_DATA_BYTES_PER_LINE 16
+
+// Translates the optimized program of a code generator into a self-contained C source file.
+//
+// Every function becomes a C function and the operand stack disappears: the depth of the operand stack is known
+// before every instruction, so the stack slot at depth n becomes the C variable 's<n>' and the local variable n
+// the C variable 'v<n>'. Arguments are passed as C arguments and the return value is returned. Objects have the
+// same layouts as in the virtual machine, allocation, bounds checks, memoization and the natives are done by a
+// small runtime (see C_RUNTIME), so the program prints exactly what it prints when it is interpreted.
+//
+// The labels must not be resolved yet, so the translator has to run before CodeGenerator::finalize.
+class CTranslator {
+private:
+    CodeGenerator& code_generator;
+    std::unordered_map<size_t, size_t> function_indices;
+
+    static std::string get_slot(int64_t depth) {
+        return "s" + std::to_string(depth);
+    }
+
+    static std::string get_variable(int64_t id) {
+        return "v" + std::to_string(id);
+    }
+
+    static std::string get_label(int64_t label) {
+        return "L" + std::to_string(label);
+    }
+
+    static std::string get_function_name(const FunctionCode& function) {
+        return "ni_" + function.get_name() + "_" + std::to_string(function.get_label());
+    }
+
+    static std::string get_integer_literal(int64_t value) {
+        if (value == INT64_MIN) {
+            return "INT64_MIN";
+        }
+        return "INT64_C(" + std::to_string(value) + ")";
+    }
+
+    static bool is_native_with_result(int64_t native_id) {
+        return native_id != NATIVE_PRINT && native_id != NATIVE_PRINTLN;
+    }
+
+    static const char *get_native_name(int64_t native_id) {
+        switch (native_id) {
+            case NATIVE_PRINT: return "ni_print";
+            case NATIVE_PRINTLN: return "ni_println";
+            case NATIVE_INT_TO_STRING: return "ni_int_to_string";
+            case NATIVE_CHAR_TO_STRING: return "ni_char_to_string";
+            case NATIVE_STRING_TO_CHAR_LIST: return "ni_string_to_char_list";
+            case NATIVE_CHAR_LIST_TO_STRING: return "ni_char_list_to_string";
+            case NATIVE_FLOAT_TO_STRING: return "ni_float_to_string";
+            case NATIVE_BOOL_TO_STRING: return "ni_bool_to_string";
+            default: assert(false && "unknown native function");
+        }
+        return nullptr;
+    }
+
+    const FunctionCode& get_callee(const Instruction& call) const {
+        return this->code_generator.get_functions()[this->function_indices.at((size_t) call.get_operand().as_int)];
+    }
+
+    void translate_binary(std::ostream& output_stream, int64_t depth, const char *field, const char *operation) const {
+        output_stream << get_slot(depth - 2) << "." << field << " = " << get_slot(depth - 2) << "." << field << " " << operation << " " << get_slot(depth - 1) << "." << field << ";";
+    }
+
+    // Signed overflow wraps around like in the virtual machine
+    void translate_wrapping(std::ostream& output_stream, int64_t depth, const char *operation) const {
+        output_stream << get_slot(depth - 2) << ".as_int = (int64_t) ((uint64_t) " << get_slot(depth - 2) << ".as_int " << operation << " (uint64_t) " << get_slot(depth - 1) << ".as_int);";
+    }
+
+    void translate_jump(std::ostream& output_stream, int64_t depth, const char *field, const char *comparison, int64_t label) const {
+        output_stream << "if (" << get_slot(depth - 2) << "." << field << " " << comparison << " " << get_slot(depth - 1) << "." << field << ") goto " << get_label(label) << ";";
+    }
+
+    void translate_instruction(std::ostream& output_stream, const FunctionCode& function, const Instruction& instruction, int64_t depth) const {
+        int64_t operand = instruction.get_operand().as_int;
+        std::string top = depth > 0 ? get_slot(depth - 1) : "";
+        std::string next = get_slot(depth);
+
+        switch (instruction.get_type()) {
+            case InstructionType::HALT:
+                output_stream << "return;";
+                break;
+
+            case InstructionType::PUSH:
+                output_stream << next << ".as_int = " << get_integer_literal(operand) << ";";
+                break;
+            case InstructionType::DUP:
+                output_stream << next << " = " << top << ";";
+                break;
+            case InstructionType::POP:
+                break;
+
+            case InstructionType::HALLOC:
+                output_stream << top << ".as_pointer = ni_allocate(" << ObjectLayout::predefined_layouts[operand]->get_size() << ", " << top << ".as_int);";
+                break;
+            case InstructionType::WRITEW:
+                output_stream << "*(Word *) " << get_slot(depth - 2) << ".as_pointer = " << top << ";";
+                break;
+            case InstructionType::READW:
+                output_stream << top << " = *(Word *) " << top << ".as_pointer;";
+                break;
+            case InstructionType::WRITEB:
+                output_stream << "*(char *) " << get_slot(depth - 2) << ".as_pointer = (char) (" << top << ".as_int & 0xFF);";
+                break;
+            case InstructionType::READB:
+                output_stream << top << ".as_int = *(char *) " << top << ".as_pointer;";
+                break;
+            case InstructionType::PADD:
+                output_stream << get_slot(depth - 2) << ".as_pointer = (char *) " << get_slot(depth - 2) << ".as_pointer + " << top << ".as_int;";
+                break;
+            case InstructionType::SPTR:
+                output_stream << next << ".as_pointer = ni_static_data + " << operand << ";";
+                break;
+
+            case InstructionType::ELOADW:
+                output_stream << get_slot(depth - 2) << " = *(Word *) ni_element_address(" << get_slot(depth - 2) << ".as_pointer, " << top << ".as_int, " << (operand >> 1) << ", sizeof(Word));";
+                break;
+            case InstructionType::ESTOREW:
+                output_stream << "*(Word *) ni_element_address(" << get_slot(depth - 3) << ".as_pointer, " << get_slot(depth - 2) << ".as_int, " << (operand >> 1) << ", sizeof(Word)) = " << top << "; "
+                    << get_slot(depth - 3) << " = " << top << ";";
+                break;
+            case InstructionType::ELOADB:
+                output_stream << get_slot(depth - 2) << ".as_int = *(char *) ni_element_address(" << get_slot(depth - 2) << ".as_pointer, " << top << ".as_int, " << (operand >> 1) << ", 1);";
+                break;
+            case InstructionType::ESTOREB:
+                output_stream << top << ".as_int = (char) (" << top << ".as_int & 0xFF); "
+                    << "*(char *) ni_element_address(" << get_slot(depth - 3) << ".as_pointer, " << get_slot(depth - 2) << ".as_int, " << (operand >> 1) << ", 1) = (char) " << top << ".as_int; "
+                    << get_slot(depth - 3) << " = " << top << ";";
+                break;
+
+            case InstructionType::VLOAD:
+                output_stream << next << " = " << get_variable(operand) << ";";
+                break;
+            case InstructionType::VWRITE:
+                output_stream << get_variable(operand) << " = " << top << ";";
+                break;
+
+            case InstructionType::IBNEG:
+                output_stream << top << ".as_int = ~" << top << ".as_int;";
+                break;
+            case InstructionType::FNEG:
+                output_stream << top << ".as_float = -" << top << ".as_float;";
+                break;
+            case InstructionType::INEG:
+                output_stream << top << ".as_int = (int64_t) (0 - (uint64_t) " << top << ".as_int);";
+                break;
+            case InstructionType::LNEG:
+                output_stream << top << ".as_int = " << top << ".as_int == 0;";
+                break;
+
+            case InstructionType::IADD: this->translate_wrapping(output_stream, depth, "+"); break;
+            case InstructionType::ISUB: this->translate_wrapping(output_stream, depth, "-"); break;
+            case InstructionType::IMUL: this->translate_wrapping(output_stream, depth, "*"); break;
+            case InstructionType::IDIV: this->translate_binary(output_stream, depth, "as_int", "/"); break;
+            case InstructionType::IMOD: this->translate_binary(output_stream, depth, "as_int", "%"); break;
+            case InstructionType::ISHL: this->translate_wrapping(output_stream, depth, "<<"); break;
+            case InstructionType::ISHR: this->translate_binary(output_stream, depth, "as_int", ">>"); break;
+            case InstructionType::IAND: this->translate_binary(output_stream, depth, "as_int", "&"); break;
+            case InstructionType::IOR: this->translate_binary(output_stream, depth, "as_int", "|"); break;
+            case InstructionType::IXOR: this->translate_binary(output_stream, depth, "as_int", "^"); break;
+
+            case InstructionType::FADD: this->translate_binary(output_stream, depth, "as_float", "+"); break;
+            case InstructionType::FSUB: this->translate_binary(output_stream, depth, "as_float", "-"); break;
+            case InstructionType::FMUL: this->translate_binary(output_stream, depth, "as_float", "*"); break;
+            case InstructionType::FDIV: this->translate_binary(output_stream, depth, "as_float", "/"); break;
+
+            case InstructionType::LABEL:
+                output_stream << get_label(operand) << ":;";
+                break;
+            case InstructionType::JUMP:
+                output_stream << "goto " << get_label(operand) << ";";
+                break;
+            case InstructionType::JNEQ: this->translate_jump(output_stream, depth, "as_int", "!=", operand); break;
+            case InstructionType::JEQ: this->translate_jump(output_stream, depth, "as_int", "==", operand); break;
+            case InstructionType::JEQZ:
+                output_stream << "if (" << top << ".as_int == 0) goto " << get_label(operand) << ";";
+                break;
+
+            case InstructionType::JILT: this->translate_jump(output_stream, depth, "as_int", "<", operand); break;
+            case InstructionType::JILE: this->translate_jump(output_stream, depth, "as_int", "<=", operand); break;
+            case InstructionType::JIGT: this->translate_jump(output_stream, depth, "as_int", ">", operand); break;
+            case InstructionType::JIGE: this->translate_jump(output_stream, depth, "as_int", ">=", operand); break;
+
+            case InstructionType::JFLT: this->translate_jump(output_stream, depth, "as_float", "<", operand); break;
+            case InstructionType::JFLE: this->translate_jump(output_stream, depth, "as_float", "<=", operand); break;
+            case InstructionType::JFGT: this->translate_jump(output_stream, depth, "as_float", ">", operand); break;
+            case InstructionType::JFGE: this->translate_jump(output_stream, depth, "as_float", ">=", operand); break;
+
+            case InstructionType::CALL:
+                {
+                    const FunctionCode& callee = this->get_callee(instruction);
+                    int64_t first_argument = depth - (int64_t) callee.get_argument_count();
+                    if (callee.get_has_return_value()) {
+                        output_stream << get_slot(first_argument) << " = ";
+                    }
+                    output_stream << get_function_name(callee) << "(";
+                    for (int64_t slot = first_argument; slot < depth; slot++) {
+                        output_stream << (slot > first_argument ? ", " : "") << get_slot(slot);
+                    }
+                    output_stream << ");";
+                }
+                break;
+            case InstructionType::NATIVE:
+                if (is_native_with_result(operand)) {
+                    output_stream << top << " = ";
+                }
+                output_stream << get_native_name(operand) << "(" << top << ");";
+                break;
+            case InstructionType::RET:
+                if (function.get_has_return_value()) {
+                    output_stream << "return " << top << ";";
+                } else {
+                    output_stream << "return;";
+                }
+                break;
+            // The arguments are still on the operand stack, see FunctionCode::memoize
+            case InstructionType::MENTER:
+                for (int64_t i = 0; i < operand; i++) {
+                    output_stream << "memo_key[" << i << "] = " << get_slot(i) << ".as_int; ";
+                }
+                output_stream << "{ Word cached; if (ni_memo_lookup(&memo_cache, memo_key, " << operand << ", &cached)) return cached; }";
+                break;
+            case InstructionType::MSTORE:
+                output_stream << "ni_memo_store(&memo_cache, memo_key, " << function.get_argument_count() << ", " << top << ");";
+                break;
+
+            case InstructionType::I2C:
+                output_stream << top << ".as_int = " << top << ".as_int & 0xFF;";
+                break;
+            case InstructionType::I2F:
+                output_stream << top << ".as_float = (double) " << top << ".as_int;";
+                break;
+            case InstructionType::F2I:
+                output_stream << top << ".as_int = (int64_t) " << top << ".as_float;";
+                break;
+        }
+    }
+
+    void translate_signature(std::ostream& output_stream, const FunctionCode& function) const {
+        output_stream << "static " << (function.get_has_return_value() ? "Word " : "void ") << get_function_name(function) << "(";
+        for (size_t i = 0; i < function.get_argument_count(); i++) {
+            output_stream << (i > 0 ? ", " : "") << "Word a" << i;
+        }
+        if (function.get_argument_count() == 0) {
+            output_stream << "void";
+        }
+        output_stream << ")";
+    }
+
+    void translate_function(std::ostream& output_stream, const FunctionCode& function) const {
+        const auto& instructions = function.get_instructions();
+        std::unordered_set<int64_t> jump_targets;
+        for (const auto& instruction : instructions) {
+            if (is_branch_instruction(instruction.get_type())) {
+                jump_targets.insert(instruction.get_operand().as_int);
+            }
+        }
+
+        const auto& functions = this->code_generator.get_functions();
+        std::vector<int64_t> depths = compute_operand_stack_depths(functions, this->function_indices, function);
+        int64_t slot_count = get_max_operand_stack_depth(functions, this->function_indices, function, depths);
+
+        this->translate_signature(output_stream, function);
+        output_stream << " {" << std::endl;
+        // Variables whose accesses were all removed by the optimizations are not declared
+        std::set<int64_t> variables;
+        for (const auto& instruction : instructions) {
+            if (instruction.get_type() == InstructionType::VLOAD || instruction.get_type() == InstructionType::VWRITE) {
+                variables.insert(instruction.get_operand().as_int);
+            }
+        }
+        for (int64_t variable : variables) {
+            output_stream << "    Word " << get_variable(variable) << " = { 0 };" << std::endl;
+        }
+        for (int64_t i = 0; i < slot_count; i++) {
+            output_stream << "    Word " << get_slot(i) << " = { 0 };" << std::endl;
+        }
+        for (size_t i = 0; i < function.get_argument_count(); i++) {
+            output_stream << "    " << get_slot(i) << " = a" << i << ";" << std::endl;
+        }
+        if (function.is_memoized()) {
+            output_stream << "    static NiMemoCache memo_cache;" << std::endl;
+            output_stream << "    int64_t memo_key[" << std::max(function.get_argument_count(), (size_t) 1) << "];" << std::endl;
+        }
+
+        for (size_t i = 0; i < instructions.size(); i++) {
+            const Instruction& instruction = instructions[i];
+            if (depths[i] < 0) {
+                continue;
+            }
+            if (instruction.get_type() == InstructionType::LABEL && !jump_targets.contains(instruction.get_operand().as_int)) {
+                continue;
+            }
+            if (instruction.get_type() == InstructionType::POP) {
+                continue;
+            }
+
+            std::stringstream line;
+            this->translate_instruction(line, function, instruction, depths[i]);
+            output_stream << "    " << line.str() << std::endl;
+        }
+        output_stream << "}" << std::endl;
+    }
+
+    static void translate_static_data(std::ostream& output_stream, const std::vector<char>& static_data) {
+        if (static_data.size() == 0) {
+            return;
+        }
+
+        // Static objects are addressed like heap objects, so the data is aligned like a word. It is not static,
+        // because the strings using it might have been removed by the optimizations.
+        output_stream << "_Alignas(Word) char ni_static_data[" << static_data.size() << "] = {";
+        for (size_t i = 0; i < static_data.size(); i++) {
+            if (i % C_STATIC_DATA_BYTES_PER_LINE == 0) {
+                output_stream << std::endl << "    ";
+            }
+            output_stream << (int) static_data[i] << ",";
+        }
+        output_stream << std::endl << "};" << std::endl << std::endl;
+    }
+
+public:
+    CTranslator(CodeGenerator& code_generator)
+        : code_generator(code_generator), function_indices(collect_function_indices(code_generator.get_functions()))
+    {}
+
+    void translate(std::ostream& output_stream) const {
+        const auto& functions = this->code_generator.get_functions();
+        assert(this->code_generator.has_main_label());
+
+        output_stream << "/* Translated from ni, do not edit */" << std::endl;
+        output_stream << "#include <inttypes.h>" << std::endl;
+        output_stream << "#include <stdint.h>" << std::endl;
+        output_stream << "#include <stdio.h>" << std::endl;
+        output_stream << "#include <stdlib.h>" << std::endl;
+        output_stream << "#include <string.h>" << std::endl;
+        output_stream << std::endl;
+        output_stream << "#define LIST_LENGTH_OFFSET " << LIST_LENGTH_OFFSET << std::endl;
+        output_stream << "#define LIST_CAPACITY_OFFSET " << LIST_CAPACITY_OFFSET << std::endl;
+        output_stream << "#define LIST_DATA_OFFSET " << LIST_DATA_OFFSET << std::endl;
+        output_stream << "#define LIST_SIZE " << LIST_SIZE << std::endl;
+        output_stream << "#define STRING_LENGTH_OFFSET " << STRING_LENGTH_OFFSET << std::endl;
+        output_stream << "#define STRING_DATA_OFFSET " << STRING_DATA_OFFSET << std::endl;
+        output_stream << "#define STRING_SIZE " << STRING_SIZE << std::endl;
+        output_stream << C_RUNTIME << std::endl;
+
+        translate_static_data(output_stream, this->code_generator.get_static_data());
+
+        for (const auto& function : functions) {
+            this->translate_signature(output_stream, function);
+            output_stream << ";" << std::endl;
+        }
+        for (const auto& function : functions) {
+            output_stream << std::endl;
+            this->translate_function(output_stream, function);
+        }
+
+        const FunctionCode& main_function = functions[this->function_indices.at(this->code_generator.get_main_label())];
+        output_stream << std::endl;
+        output_stream << "int main(void) {" << std::endl;
+        output_stream << "    " << get_function_name(main_function) << "();" << std::endl;
+        output_stream << "    return 0;" << std::endl;
+        output_stream << "}" << std::endl;
+    }
+
+    ~CTranslator() {}
+};
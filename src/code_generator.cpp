@@ -1,21 +1,302 @@
 
+class Expression;
+class Profile;
+
+class FunctionCode {
+private:
+    std::string name;
+    size_t label;
+    size_t argument_count;
+    bool has_return_value;
+    bool has_primitive_signature;
+    std::vector<Instruction> instructions;
+public:
+    FunctionCode(const std::string& name, size_t label, size_t argument_count, bool has_return_value, bool has_primitive_signature)
+        : name(name), label(label), argument_count(argument_count), has_return_value(has_return_value), has_primitive_signature(has_primitive_signature), instructions()
+    {}
+
+    const std::string& get_name() const {
+        return this->name;
+    }
+
+    size_t get_label() const {
+        return this->label;
+    }
+
+    size_t get_argument_count() const {
+        return this->argument_count;
+    }
+
+    // Whether RET leaves a value on the operand stack
+    bool get_has_return_value() const {
+        return this->has_return_value;
+    }
+
+    std::vector<Instruction>& get_instructions() {
+        return this->instructions;
+    }
+
+    const std::vector<Instruction>& get_instructions() const {
+        return this->instructions;
+    }
+
+    // Results can only be cached for primitive arguments, which are compared by value, and a primitive return value
+    bool is_memoizable() const {
+        return this->has_return_value && this->has_primitive_signature;
+    }
+
+    // Makes the virtual machine cache the results of the function per arguments: MENTER looks the arguments up
+    // on entry and MSTORE stores the result before every return
+    void memoize() {
+        assert(this->instructions.size() > 0 && this->instructions[0].get_type() == InstructionType::LABEL);
+        assert(this->is_memoizable());
+        std::vector<Instruction> output { this->instructions[0], Instruction(InstructionType::MENTER, Word { .as_int = (int64_t) this->argument_count }) };
+        for (size_t i = 1; i < this->instructions.size(); i++) {
+            if (this->instructions[i].get_type() == InstructionType::RET) {
+                output.push_back(Instruction(InstructionType::MSTORE));
+            }
+            output.push_back(this->instructions[i]);
+        }
+        this->instructions = std::move(output);
+    }
+
+    bool is_memoized() const {
+        return this->instructions.size() > 1 && this->instructions[1].get_type() == InstructionType::MENTER;
+    }
+
+    // Number of local variable slots used by the function
+    size_t get_frame_size() const {
+        size_t frame_size = 0;
+        for (const auto& instruction : this->instructions) {
+            if (instruction.get_type() == InstructionType::VLOAD || instruction.get_type() == InstructionType::VWRITE) {
+                frame_size = std::max(frame_size, (size_t)instruction.get_operand().as_int + 1);
+            }
+        }
+        return frame_size;
+    }
+
+    ~FunctionCode() {}
+};
+
 class CodeGenerator {
 private:
+    std::vector<FunctionCode> functions;
     std::vector<Instruction> program;
     std::vector<char> static_data;
+    // Labels below the initial label count are the labels of the functions
+    size_t initial_label_count;
     size_t label_count;
 
     size_t break_label;
     size_t continue_label;
     size_t main_label;
     bool main_label_found;
+
+    size_t variable_count;
+    std::unordered_map<const Expression *, size_t> hoisted_expressions;
+    std::unordered_map<size_t, size_t> hoisted_data_pointers;
+    std::map<std::pair<size_t, size_t>, size_t> induction_pointers;
+    std::unordered_map<size_t, std::vector<std::pair<size_t, size_t>>> induction_pointer_updates;
+    std::unordered_set<size_t> non_negative_variables;
+    std::unordered_set<size_t> counting_variables;
+    std::set<std::pair<size_t, size_t>> index_bounds;
+    std::unordered_set<std::string> enabled_optimizations;
+    std::unordered_map<size_t, size_t> label_origins;
+    std::vector<size_t> function_locations;
+    const Profile *profile;
+    bool keeps_uncalled_functions;
 public:
     CodeGenerator(size_t initial_label_count) :
-        program(), static_data(), label_count(initial_label_count), break_label(0), continue_label(0), main_label(0), main_label_found(false)
+        functions(),
+        program(),
+        static_data(),
+        initial_label_count(initial_label_count),
+        label_count(initial_label_count),
+        break_label(0),
+        continue_label(0),
+        main_label(0),
+        main_label_found(false),
+        variable_count(0),
+        hoisted_expressions(),
+        hoisted_data_pointers(),
+        induction_pointers(),
+        induction_pointer_updates(),
+        non_negative_variables(),
+        counting_variables(),
+        index_bounds(),
+        enabled_optimizations(),
+        label_origins(),
+        function_locations(),
+        profile(nullptr),
+        keeps_uncalled_functions(false)
     {}
 
+    // Optimizations that are done while emitting the code, see PassManager for their names
+    void enable_optimization(const std::string& name) {
+        this->enabled_optimizations.insert(name);
+    }
+
+    bool is_optimization_enabled(const std::string& name) const {
+        return this->enabled_optimizations.contains(name);
+    }
+
+    // Profile of a previous run that guides the optimization passes, nullptr if there is none
+    void set_profile(const Profile *profile) {
+        this->profile = profile;
+    }
+
+    const Profile *get_profile() const {
+        return this->profile;
+    }
+
+    // Functions that are optimized while the program runs (see TieringManager) may still be called by unoptimized code,
+    // so the passes must not remove functions that are not called by optimized code
+    void set_keeps_uncalled_functions(bool keeps_uncalled_functions) {
+        this->keeps_uncalled_functions = keeps_uncalled_functions;
+    }
+
+    bool get_keeps_uncalled_functions() const {
+        return this->keeps_uncalled_functions;
+    }
+
+    // frame_size is the number of variables used by the type checked function, has_primitive_signature tells
+    // whether the arguments and the return value (if there is one) are primitive
+    void begin_function(const std::string& name, size_t label, size_t argument_count, bool has_return_value, bool has_primitive_signature, size_t frame_size) {
+        this->functions.push_back(FunctionCode(name, label, argument_count, has_return_value, has_primitive_signature));
+        this->variable_count = frame_size;
+        this->index_bounds.clear();
+    }
+
+    // Allocates a variable of the current function that is not used by the source code
+    size_t allocate_variable() {
+        size_t variable = this->variable_count;
+        this->variable_count += 1;
+        return variable;
+    }
+
+    void add_hoisted_expression(const Expression *expression, size_t variable) {
+        this->hoisted_expressions[expression] = variable;
+    }
+
+    void remove_hoisted_expression(const Expression *expression) {
+        this->hoisted_expressions.erase(expression);
+    }
+
+    bool is_hoisted(const Expression *expression) const {
+        return this->hoisted_expressions.contains(expression);
+    }
+
+    size_t get_hoisted_variable(const Expression *expression) const {
+        return this->hoisted_expressions.at(expression);
+    }
+
+    // Data pointers of lists or strings stored in variables, keyed by the id of the variable holding the object
+    void add_hoisted_data_pointer(size_t object_variable, size_t variable) {
+        this->hoisted_data_pointers[object_variable] = variable;
+    }
+
+    void remove_hoisted_data_pointer(size_t object_variable) {
+        this->hoisted_data_pointers.erase(object_variable);
+    }
+
+    bool has_hoisted_data_pointer(size_t object_variable) const {
+        return this->hoisted_data_pointers.contains(object_variable);
+    }
+
+    size_t get_hoisted_data_pointer(size_t object_variable) const {
+        return this->hoisted_data_pointers.at(object_variable);
+    }
+
+    // Pointers to the element 'object_variable[index_variable]' that are advanced together with the index variable
+    void add_induction_pointer(size_t object_variable, size_t index_variable, size_t variable, size_t element_size) {
+        this->induction_pointers[{ object_variable, index_variable }] = variable;
+        this->induction_pointer_updates[index_variable].push_back({ variable, element_size });
+    }
+
+    void remove_induction_pointer(size_t object_variable, size_t index_variable) {
+        size_t variable = this->induction_pointers.at({ object_variable, index_variable });
+        this->induction_pointers.erase({ object_variable, index_variable });
+
+        auto& updates = this->induction_pointer_updates.at(index_variable);
+        updates.erase(std::remove_if(updates.begin(), updates.end(), [variable](const auto& update) { return update.first == variable; }), updates.end());
+        if (updates.size() == 0) {
+            this->induction_pointer_updates.erase(index_variable);
+        }
+    }
+
+    bool has_induction_pointer(size_t object_variable, size_t index_variable) const {
+        return this->induction_pointers.contains({ object_variable, index_variable });
+    }
+
+    size_t get_induction_pointer(size_t object_variable, size_t index_variable) const {
+        return this->induction_pointers.at({ object_variable, index_variable });
+    }
+
+    bool has_induction_pointers(size_t index_variable) const {
+        return this->induction_pointer_updates.contains(index_variable);
+    }
+
+    // Pairs of pointer variable and element size
+    const std::vector<std::pair<size_t, size_t>>& get_induction_pointers(size_t index_variable) const {
+        return this->induction_pointer_updates.at(index_variable);
+    }
+
+    // Variables of the current function that never hold a negative integer (see ValueRangeAnalysis)
+    void set_non_negative_variables(std::unordered_set<size_t> variables) {
+        this->non_negative_variables = std::move(variables);
+    }
+
+    const std::unordered_set<size_t>& get_non_negative_variables() const {
+        return this->non_negative_variables;
+    }
+
+    // Variables of the current function that count up from a non negative literal (see ValueRangeAnalysis)
+    void set_counting_variables(std::unordered_set<size_t> variables) {
+        this->counting_variables = std::move(variables);
+    }
+
+    const std::unordered_set<size_t>& get_counting_variables() const {
+        return this->counting_variables;
+    }
+
+    // Records that '0 <= index_variable < object_variable.length' holds for the code that is emitted next,
+    // so indexing 'object_variable[index_variable]' does not need to be bounds checked
+    void add_index_bound(size_t object_variable, size_t index_variable) {
+        if (!this->is_optimization_enabled("bounds-check-elimination")) {
+            return;
+        }
+        this->index_bounds.insert({ object_variable, index_variable });
+    }
+
+    bool is_index_in_bounds(size_t object_variable, size_t index_variable) const {
+        return this->index_bounds.contains({ object_variable, index_variable });
+    }
+
+    // Called whenever a variable is assigned, since the bounds involving it might not hold anymore
+    void invalidate_index_bounds(size_t variable) {
+        std::erase_if(this->index_bounds, [variable](const auto& bound) {
+            return bound.first == variable || bound.second == variable;
+        });
+    }
+
+    std::set<std::pair<size_t, size_t>> get_index_bounds() const {
+        return this->index_bounds;
+    }
+
+    // Drops the bounds that are not part of the given bounds, used when leaving the code that is guarded by a condition
+    void restrict_index_bounds(const std::set<std::pair<size_t, size_t>>& bounds) {
+        std::erase_if(this->index_bounds, [&bounds](const auto& bound) {
+            return !bounds.contains(bound);
+        });
+    }
+
     void push_instruction(Instruction instruction) {
-        this->program.push_back(instruction);
+        assert(this->functions.size() > 0 && "Instructions must be emitted inside of a function");
+        this->functions.back().get_instructions().push_back(instruction);
+    }
+
+    std::vector<FunctionCode>& get_functions() {
+        return this->functions;
     }
 
     std::vector<Instruction> get_program() {
@@ -25,11 +306,11 @@ public:
     std::vector<char> get_static_data() {
         return std::move(this->static_data);
     }
-    
+
     void set_break_label(size_t break_label) {
         this->break_label = break_label;
     }
-    
+
     void set_continue_label(size_t continue_label) {
         this->continue_label = continue_label;
     }
@@ -37,7 +318,7 @@ public:
     size_t get_break_label() const {
         return this->break_label;
     }
-    
+
     size_t get_continue_label() const {
         return this->continue_label;
     }
@@ -47,6 +328,14 @@ public:
         this->main_label_found = true;
     }
 
+    bool has_main_label() const {
+        return this->main_label_found;
+    }
+
+    size_t get_main_label() const {
+        return this->main_label;
+    }
+
     size_t allocate_static_objects(std::shared_ptr<ObjectLayout> layout, size_t count) {
         size_t allocated_bytes = layout->get_size() * count;
         size_t offset = this->static_data.size();
@@ -64,26 +353,52 @@ public:
         return new_label;
     }
 
-    bool is_jump_instruction(InstructionType type) {
-        switch(type)  {
-            case InstructionType::JUMP:
-            case InstructionType::JNEQ:
-            case InstructionType::JEQ:
-            
-            case InstructionType::JILT:
-            case InstructionType::JILE:
-            case InstructionType::JIGT:
-            case InstructionType::JIGE:
-            
-            case InstructionType::JFLT:
-            case InstructionType::JFLE:
-            case InstructionType::JFGT:
-            case InstructionType::JFGE:
-
-            case InstructionType::CALL:
-                return true;
-            default:
-                return false;
+    // Generates a label for a copy of the code at the given label (e.g. an inlined function body),
+    // copies share the profile entries of the original label, see get_label_origin
+    size_t generate_label_copy(size_t label) {
+        size_t new_label = this->generate_label();
+        this->label_origins[new_label] = this->get_label_origin(label);
+        return new_label;
+    }
+
+    // Label that was emitted for the source code the label belongs to
+    size_t get_label_origin(size_t label) const {
+        auto origin = this->label_origins.find(label);
+        return origin != this->label_origins.end() ? origin->second : label;
+    }
+
+    size_t get_label_count() const {
+        return this->label_count;
+    }
+
+    // Appends the code and static data emitted by a generator for the definitions that follow the ones emitted by
+    // this generator. Both generators started with the same label count: the labels generated by the other generator
+    // are moved behind the ones generated by this generator and its static data behind this static data, so the
+    // result is the same as if all definitions were emitted by this generator.
+    void append(CodeGenerator& other) {
+        assert(other.initial_label_count == this->initial_label_count && other.label_origins.empty());
+        int64_t label_offset = (int64_t) (this->label_count - this->initial_label_count);
+        int64_t static_offset = (int64_t) this->static_data.size();
+
+        for (auto& function : other.functions) {
+            for (auto& instruction : function.get_instructions()) {
+                InstructionType type = instruction.get_type();
+                int64_t operand = instruction.get_operand().as_int;
+                bool is_label_operand = type == InstructionType::LABEL || is_branch_instruction(type);
+                if (is_label_operand && operand >= (int64_t) this->initial_label_count) {
+                    instruction.set_operand(Word { .as_int = operand + label_offset });
+                } else if (type == InstructionType::SPTR) {
+                    instruction.set_operand(Word { .as_int = operand + static_offset });
+                }
+            }
+            this->functions.push_back(std::move(function));
+        }
+        other.functions.clear();
+
+        this->static_data.insert(this->static_data.end(), other.static_data.begin(), other.static_data.end());
+        this->label_count += other.label_count - other.initial_label_count;
+        if (other.main_label_found) {
+            this->set_main_label(other.main_label);
         }
     }
 
@@ -94,27 +409,40 @@ public:
             std::exit(1);
         }
 
-        this->program.insert(this->program.begin(), Instruction(InstructionType::JUMP, Word { .as_int = (int64_t) this->main_label }));
+        this->program.push_back(Instruction(InstructionType::JUMP, Word { .as_int = (int64_t) this->main_label }));
+        for (const auto& function : this->functions) {
+            const auto& instructions = function.get_instructions();
+            this->function_locations.push_back(this->program.size());
+            this->program.insert(this->program.end(), instructions.begin(), instructions.end());
+        }
         //for (const auto& instruction : this->program) {
         //    std::cout << instruction << std::endl;
         //}
 
+        resolve_labels(this->program, this->label_count);
+    }
+
+    // Location of the first instruction of the function at 'index' in the finalized program
+    size_t get_function_location(size_t index) const {
+        return this->function_locations.at(index);
+    }
+
+    // Replaces the labels in the operands of jumps and calls by the location of the label in the program
+    static void resolve_labels(std::vector<Instruction>& program, size_t label_count) {
         std::vector<size_t> label_locations;
-        label_locations.resize(this->label_count);
-        for (size_t i = 0; i < this->program.size(); i++) {
+        label_locations.resize(label_count);
+        for (size_t i = 0; i < program.size(); i++) {
             const Instruction& instruction = program[i];
             if (instruction.get_type() == InstructionType::LABEL) {
                 label_locations[(size_t)instruction.get_operand().as_int] = i;
             }
         }
 
-        for (auto& instruction : this->program) {
-            if (this->is_jump_instruction(instruction.get_type())) {
+        for (auto& instruction : program) {
+            if (is_jump_instruction(instruction.get_type())) {
                 size_t label_index = (size_t)instruction.get_operand().as_int;
                 instruction.set_operand(Word { .as_int = (int64_t) label_locations[label_index] });
             }
         }
     }
 };
-
-
@@ -0,0 +1,133 @@
+
+// Changes whenever the compiler is rebuilt, so programs compiled by another build of the compiler are not reused
+#define COMPILER_BUILD_ID __DATE__ " " __TIME__
+
+// Once the entries take up more space than this, the least recently used ones are removed
+#define CACHE_SIZE_LIMIT (64 * 1024 * 1024)
+
+#define FNV_OFFSET_BASIS 14695981039346656037ull
+#define FNV_PRIME 1099511628211ull
+
+// 64 bit FNV-1a
+uint64_t hash_fnv1a(std::string_view data, uint64_t value = FNV_OFFSET_BASIS) {
+    for (char character : data) {
+        value ^= (uint8_t) character;
+        value *= FNV_PRIME;
+    }
+    return value;
+}
+
+// On-disk cache of compiled programs in '$XDG_CACHE_HOME/ni' (or '~/.cache/ni').
+//
+// Entries are precompiled programs (see BytecodeFile) named after a hash of their key: the source, the compiler build
+// and the enabled optimizations. The entry stores its whole key, which is compared when the entry is loaded, so a
+// changed source or compiler never hits an outdated entry, not even if hashes collide. Entries are written to
+// a temporary file first and then renamed, so processes running the same script at the same time never see a
+// partially written entry.
+//
+// Since the key contains the whole source, an entry is about as large as its source plus the compiled program.
+// Entries of changed sources and of earlier compiler builds are never hit again, so storing an entry removes the least
+// recently used entries (by modification time, which is updated on every hit) while the cache is over
+// CACHE_SIZE_LIMIT.
+class CompilationCache {
+private:
+    std::filesystem::path directory;
+    bool is_available;
+
+    // Entries that are removed by another process at the same time are skipped, errors are ignored
+    void remove_least_recently_used(const std::string& kept_entry_path) const {
+        std::error_code error;
+        std::vector<std::tuple<std::filesystem::file_time_type, uintmax_t, std::filesystem::path>> entries;
+        uintmax_t total_size = 0;
+        std::filesystem::directory_iterator directory_iterator(this->directory, error);
+        for (; !error && directory_iterator != std::filesystem::directory_iterator(); directory_iterator.increment(error)) {
+            const auto& directory_entry = *directory_iterator;
+            const auto& path = directory_entry.path();
+            if (path.extension() != ".nic" || path == kept_entry_path) {
+                continue;
+            }
+            std::error_code entry_error;
+            uintmax_t size = directory_entry.file_size(entry_error);
+            auto modification_time = directory_entry.last_write_time(entry_error);
+            if (entry_error) {
+                continue;
+            }
+            entries.push_back({ modification_time, size, path });
+            total_size += size;
+        }
+
+        std::error_code kept_error;
+        uintmax_t kept_size = std::filesystem::file_size(kept_entry_path, kept_error);
+        total_size += kept_error ? 0 : kept_size;
+
+        std::sort(entries.begin(), entries.end());
+        for (const auto& [modification_time, size, path] : entries) {
+            if (total_size <= CACHE_SIZE_LIMIT) {
+                break;
+            }
+            if (std::filesystem::remove(path, error)) {
+                total_size -= size;
+            }
+        }
+    }
+
+public:
+    CompilationCache() : directory(), is_available(true) {
+        const char *cache_home = std::getenv("XDG_CACHE_HOME");
+        const char *home = std::getenv("HOME");
+        if (cache_home != nullptr && cache_home[0] != '\0') {
+            this->directory = std::filesystem::path(cache_home) / "ni";
+        } else if (home != nullptr && home[0] != '\0') {
+            this->directory = std::filesystem::path(home) / ".cache" / "ni";
+        } else {
+            this->is_available = false;
+        }
+    }
+
+    bool get_is_available() const {
+        return this->is_available;
+    }
+
+    // configuration describes everything besides the source that changes the compiled program
+    static std::string get_key(std::string_view source, const std::string& configuration) {
+        std::string key(source);
+        key += std::string(1, '\0') + COMPILER_BUILD_ID;
+        key += std::string(1, '\0') + configuration;
+        return key;
+    }
+
+    std::string get_entry_path(const std::string& key) const {
+        std::stringstream file_name;
+        file_name << std::hex << std::setw(16) << std::setfill('0') << hash_fnv1a(key) << ".nic";
+        return (this->directory / file_name.str()).string();
+    }
+
+    // Failing to store an entry only makes the next run slower, so errors are ignored
+    void store(const std::string& entry_path, const std::string& key, const std::vector<Instruction>& program, const std::vector<char>& static_data) const {
+        std::error_code error;
+        std::filesystem::create_directories(this->directory, error);
+        if (error) {
+            return;
+        }
+
+        std::string temporary_path = entry_path + "." + std::to_string(getpid()) + ".tmp";
+        if (!write_bytecode_file(temporary_path, program, static_data, key)) {
+            std::filesystem::remove(temporary_path, error);
+            return;
+        }
+        std::filesystem::rename(temporary_path, entry_path, error);
+        if (error) {
+            std::filesystem::remove(temporary_path, error);
+            return;
+        }
+        this->remove_least_recently_used(entry_path);
+    }
+
+    // Keeps the entry from being removed as one of the least recently used ones
+    void mark_used(const std::string& entry_path) const {
+        std::error_code error;
+        std::filesystem::last_write_time(entry_path, std::filesystem::file_time_type::clock::now(), error);
+    }
+
+    ~CompilationCache() {}
+};
@@ -0,0 +1,198 @@
+
+#define CONSTANT_EVALUATION_STEP_LIMIT 100000
+
+// Evaluates calls of pure functions with constant arguments at compile time.
+//
+// A call of a pure function (see find_pure_functions) whose arguments are all pushed as constants right before it is
+// executed by a virtual machine that only contains the called function and its callees. If it returns within
+// CONSTANT_EVALUATION_STEP_LIMIT instructions, the call is replaced by a push of the returned value
+// (or removed for functions without a return value).
+//
+// Arithmetic on constants is evaluated by the virtual machine as well, so arguments like 'fac(5 + 5)' are constant.
+class ConstantCallEvaluator : public OptimizationPass {
+private:
+    size_t step_limit;
+
+    // Number of operands of the arithmetic instructions that can be evaluated at compile time (-1 for all others)
+    static int foldable_operand_count(InstructionType type) {
+        switch (type) {
+            case InstructionType::IBNEG:
+            case InstructionType::FNEG:
+            case InstructionType::INEG:
+            case InstructionType::LNEG:
+            case InstructionType::I2C:
+            case InstructionType::I2F:
+            case InstructionType::F2I:
+                return 1;
+
+            case InstructionType::IADD:
+            case InstructionType::ISUB:
+            case InstructionType::IMUL:
+            case InstructionType::IDIV:
+            case InstructionType::IMOD:
+            case InstructionType::ISHL:
+            case InstructionType::ISHR:
+            case InstructionType::IAND:
+            case InstructionType::IOR:
+            case InstructionType::IXOR:
+            case InstructionType::FADD:
+            case InstructionType::FSUB:
+            case InstructionType::FMUL:
+            case InstructionType::FDIV:
+                return 2;
+
+            default:
+                return -1;
+        }
+    }
+
+    // Runs the instructions, which have to push exactly one value
+    static Word evaluate(std::vector<Instruction> program) {
+        program.push_back(Instruction(InstructionType::HALT));
+        size_t step_count = program.size();
+        VirtualMachine virtual_machine(std::move(program), std::vector<char>());
+        virtual_machine.execute_steps(step_count);
+        assert(virtual_machine.get_stack_size() == 1);
+        return virtual_machine.get_stack_top().get_content();
+    }
+
+    bool fold_constant_operations(std::vector<Instruction>& instructions) const {
+        std::vector<Instruction> output;
+        output.reserve(instructions.size());
+        bool changed = false;
+
+        for (const auto& instruction : instructions) {
+            output.push_back(instruction);
+
+            InstructionType type = instruction.get_type();
+            int operand_count = foldable_operand_count(type);
+            if (operand_count < 0 || output.size() < (size_t) operand_count + 1) {
+                continue;
+            }
+
+            std::vector<Instruction> operation(output.end() - (operand_count + 1), output.end());
+            bool are_operands_constant = std::all_of(operation.begin(), operation.end() - 1, [](const Instruction& operand) {
+                return operand.get_type() == InstructionType::PUSH;
+            });
+            if (!are_operands_constant) {
+                continue;
+            }
+
+            // Leave traps and undefined shifts to the runtime
+            int64_t right = operation[operation.size() - 2].get_operand().as_int;
+            if ((type == InstructionType::IDIV || type == InstructionType::IMOD) && (right == 0 || right == -1)) {
+                continue;
+            }
+            if ((type == InstructionType::ISHL || type == InstructionType::ISHR) && (right < 0 || right >= 64)) {
+                continue;
+            }
+
+            Word result = evaluate(operation);
+            output.erase(output.end() - (operand_count + 1), output.end());
+            output.push_back(Instruction(InstructionType::PUSH, result));
+            changed = true;
+        }
+
+        instructions = std::move(output);
+        return changed;
+    }
+
+    // Executes the call, returns false if it does not return in time
+    bool evaluate_call(CodeGenerator& code_generator, const std::unordered_map<size_t, size_t>& function_indices, const std::vector<Instruction>& call, std::vector<Word>& result) const {
+        const auto& functions = code_generator.get_functions();
+        size_t label = (size_t) call.back().get_operand().as_int;
+
+        std::vector<Instruction> program = call;
+        program.push_back(Instruction(InstructionType::HALT));
+
+        std::vector<bool> visited(functions.size(), false);
+        std::vector<size_t> order;
+        collect_post_order(functions, function_indices, function_indices.at(label), visited, order);
+        for (size_t index : order) {
+            const auto& instructions = functions[index].get_instructions();
+            program.insert(program.end(), instructions.begin(), instructions.end());
+        }
+        CodeGenerator::resolve_labels(program, code_generator.get_label_count());
+
+        VirtualMachine virtual_machine(std::move(program), std::vector<char>());
+        if (!virtual_machine.execute_steps(this->step_limit) || virtual_machine.get_stack_size() > 1) {
+            return false;
+        }
+
+        if (virtual_machine.get_stack_size() == 1) {
+            StackElement value = virtual_machine.get_stack_top();
+            if (value.get_type() != StackElementType::PRIMITIVE) {
+                return false;
+            }
+            result.push_back(value.get_content());
+        }
+        return true;
+    }
+
+    bool evaluate_calls(CodeGenerator& code_generator, const std::unordered_set<size_t>& pure_functions, size_t function_index) const {
+        auto& functions = code_generator.get_functions();
+        auto function_indices = collect_function_indices(functions);
+        const auto& instructions = functions[function_index].get_instructions();
+
+        std::vector<Instruction> output;
+        output.reserve(instructions.size());
+        bool changed = false;
+
+        for (const auto& instruction : instructions) {
+            output.push_back(instruction);
+            if (instruction.get_type() != InstructionType::CALL) {
+                continue;
+            }
+
+            size_t label = (size_t) instruction.get_operand().as_int;
+            size_t argument_count = functions[function_indices.at(label)].get_argument_count();
+            if (!pure_functions.contains(label) || output.size() < argument_count + 1) {
+                continue;
+            }
+
+            std::vector<Instruction> call(output.end() - (argument_count + 1), output.end());
+            bool are_arguments_constant = std::all_of(call.begin(), call.end() - 1, [](const Instruction& argument) {
+                return argument.get_type() == InstructionType::PUSH;
+            });
+
+            std::vector<Word> result;
+            if (are_arguments_constant && this->evaluate_call(code_generator, function_indices, call, result)) {
+                output.erase(output.end() - (argument_count + 1), output.end());
+                for (Word value : result) {
+                    output.push_back(Instruction(InstructionType::PUSH, value));
+                }
+                changed = true;
+            }
+        }
+
+        if (changed) {
+            functions[function_index].get_instructions() = std::move(output);
+        }
+        return changed;
+    }
+
+public:
+    ConstantCallEvaluator(size_t step_limit = CONSTANT_EVALUATION_STEP_LIMIT)
+        : step_limit(step_limit)
+    {}
+
+    virtual const char *get_name() const override {
+        return "const-eval";
+    }
+
+    virtual void run(CodeGenerator& code_generator) override {
+        auto pure_functions = find_pure_functions(code_generator);
+
+        bool changed = false;
+        for (size_t i = 0; i < code_generator.get_functions().size(); i++) {
+            this->fold_constant_operations(code_generator.get_functions()[i].get_instructions());
+            changed = this->evaluate_calls(code_generator, pure_functions, i) || changed;
+        }
+
+        if (changed && code_generator.has_main_label()) {
+            remove_uncalled_functions(code_generator);
+        }
+    }
+
+    ~ConstantCallEvaluator() {}
+};
@@ -0,0 +1,200 @@
+
+// Removes code that can not be reached or whose result is never used:
+//      - basic blocks that can not be reached from the entry of the function (e.g. code after a return)
+//      - writes to variables that are not read afterwards (dead stores), which become POPs
+//      - pure instructions whose result is immediately popped, e.g. the value of an expression statement
+class DeadCodeEliminator : public OptimizationPass {
+private:
+    // Number of operands popped by an instruction that pushes a single value without any other effect,
+    // or -1 if the instruction is not of that kind. Integer division may trap, so it is never removed.
+    static int pure_operand_count(InstructionType type) {
+        switch (type) {
+            case InstructionType::PUSH:
+            case InstructionType::VLOAD:
+            case InstructionType::SPTR:
+            case InstructionType::DUP:
+                return 0;
+
+            case InstructionType::READW:
+            case InstructionType::READB:
+            case InstructionType::IBNEG:
+            case InstructionType::FNEG:
+            case InstructionType::INEG:
+            case InstructionType::LNEG:
+            case InstructionType::I2C:
+            case InstructionType::I2F:
+            case InstructionType::F2I:
+                return 1;
+
+            case InstructionType::PADD:
+            case InstructionType::IADD:
+            case InstructionType::ISUB:
+            case InstructionType::IMUL:
+            case InstructionType::ISHL:
+            case InstructionType::ISHR:
+            case InstructionType::IAND:
+            case InstructionType::IOR:
+            case InstructionType::IXOR:
+            case InstructionType::FADD:
+            case InstructionType::FSUB:
+            case InstructionType::FMUL:
+            case InstructionType::FDIV:
+                return 2;
+
+            default:
+                return -1;
+        }
+    }
+
+    bool remove_unreachable_blocks(std::vector<Instruction>& instructions) const {
+        auto blocks = build_basic_blocks(instructions);
+        if (blocks.size() == 0) {
+            return false;
+        }
+
+        std::vector<bool> reachable(blocks.size(), false);
+        std::vector<size_t> work_list { 0 };
+        reachable[0] = true;
+        while (work_list.size() > 0) {
+            size_t block = work_list.back();
+            work_list.pop_back();
+            for (size_t successor : blocks[block].get_successors()) {
+                if (!reachable[successor]) {
+                    reachable[successor] = true;
+                    work_list.push_back(successor);
+                }
+            }
+        }
+
+        std::vector<Instruction> output;
+        output.reserve(instructions.size());
+        for (size_t i = 0; i < blocks.size(); i++) {
+            if (reachable[i]) {
+                output.insert(output.end(), instructions.begin() + blocks[i].get_begin(), instructions.begin() + blocks[i].get_end());
+            }
+        }
+
+        bool changed = output.size() != instructions.size();
+        instructions = std::move(output);
+        return changed;
+    }
+
+    bool remove_dead_stores(std::vector<Instruction>& instructions) const {
+        auto blocks = build_basic_blocks(instructions);
+
+        // Variables that are read in a block before being written (use) and variables written in a block (def)
+        std::vector<std::unordered_set<int64_t>> uses(blocks.size());
+        std::vector<std::unordered_set<int64_t>> definitions(blocks.size());
+        for (size_t i = 0; i < blocks.size(); i++) {
+            for (size_t j = blocks[i].get_begin(); j < blocks[i].get_end(); j++) {
+                int64_t variable = instructions[j].get_operand().as_int;
+                if (instructions[j].get_type() == InstructionType::VLOAD && !definitions[i].contains(variable)) {
+                    uses[i].insert(variable);
+                } else if (instructions[j].get_type() == InstructionType::VWRITE) {
+                    definitions[i].insert(variable);
+                }
+            }
+        }
+
+        std::vector<std::unordered_set<int64_t>> live_in(blocks.size());
+        std::vector<std::unordered_set<int64_t>> live_out(blocks.size());
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t i = blocks.size(); i-- > 0;) {
+                for (size_t successor : blocks[i].get_successors()) {
+                    for (int64_t variable : live_in[successor]) {
+                        live_out[i].insert(variable);
+                    }
+                }
+
+                std::unordered_set<int64_t> new_live_in = uses[i];
+                for (int64_t variable : live_out[i]) {
+                    if (!definitions[i].contains(variable)) {
+                        new_live_in.insert(variable);
+                    }
+                }
+                if (new_live_in.size() != live_in[i].size()) {
+                    live_in[i] = std::move(new_live_in);
+                    changed = true;
+                }
+            }
+        }
+
+        bool removed = false;
+        for (size_t i = 0; i < blocks.size(); i++) {
+            std::unordered_set<int64_t> live = live_out[i];
+            for (size_t j = blocks[i].get_end(); j-- > blocks[i].get_begin();) {
+                Instruction& instruction = instructions[j];
+                int64_t variable = instruction.get_operand().as_int;
+                if (instruction.get_type() == InstructionType::VWRITE) {
+                    if (!live.contains(variable)) {
+                        instruction = Instruction(InstructionType::POP);
+                        removed = true;
+                    }
+                    live.erase(variable);
+                } else if (instruction.get_type() == InstructionType::VLOAD) {
+                    live.insert(variable);
+                }
+            }
+        }
+        return removed;
+    }
+
+    bool remove_unused_values(std::vector<Instruction>& instructions) const {
+        std::vector<Instruction> output;
+        output.reserve(instructions.size());
+        bool changed = false;
+
+        for (const auto& instruction : instructions) {
+            // Popping the result of a pure instruction is the same as popping its operands
+            if (instruction.get_type() == InstructionType::POP && output.size() > 0) {
+                int operand_count = pure_operand_count(output.back().get_type());
+                if (operand_count >= 0) {
+                    output.pop_back();
+                    for (int i = 0; i < operand_count; i++) {
+                        output.push_back(Instruction(InstructionType::POP));
+                    }
+                    changed = true;
+                    continue;
+                }
+            }
+
+            // 'DUP; VWRITE x; POP' is the same as 'VWRITE x'
+            size_t size = output.size();
+            if (instruction.get_type() == InstructionType::POP && size >= 2 &&
+                output[size-1].get_type() == InstructionType::VWRITE && output[size-2].get_type() == InstructionType::DUP) {
+                output.erase(output.end() - 2);
+                changed = true;
+                continue;
+            }
+
+            output.push_back(instruction);
+        }
+
+        instructions = std::move(output);
+        return changed;
+    }
+
+public:
+    DeadCodeEliminator() {}
+
+    virtual const char *get_name() const override {
+        return "dce";
+    }
+
+    virtual void run(CodeGenerator& code_generator) override {
+        for (auto& function : code_generator.get_functions()) {
+            auto& instructions = function.get_instructions();
+            bool changed = true;
+            while (changed) {
+                changed = this->remove_unreachable_blocks(instructions);
+                changed = this->remove_dead_stores(instructions) || changed;
+                changed = this->remove_unused_values(instructions) || changed;
+            }
+            remove_redundant_jumps(instructions);
+        }
+    }
+
+    ~DeadCodeEliminator() {}
+};
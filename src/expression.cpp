@@ -1,4 +1,35 @@
 
+// Effects of executing an expression or a statement that decide whether code can be moved out of a loop
+class SideEffects {
+private:
+    std::unordered_set<size_t> assigned_variables;
+    bool writes_memory;
+public:
+    SideEffects() : assigned_variables(), writes_memory(false) {}
+
+    void add_assigned_variable(size_t id) {
+        this->assigned_variables.insert(id);
+    }
+
+    bool is_variable_assigned(size_t id) const {
+        return this->assigned_variables.contains(id);
+    }
+
+    const std::unordered_set<size_t>& get_assigned_variables() const {
+        return this->assigned_variables;
+    }
+
+    void set_writes_memory() {
+        this->writes_memory = true;
+    }
+
+    bool get_writes_memory() const {
+        return this->writes_memory;
+    }
+
+    ~SideEffects() {}
+};
+
 class Expression {
 private:
     Location location;
@@ -16,8 +47,48 @@ public:
     virtual bool is_lvalue() const = 0;
     virtual void emit(CodeGenerator&) const = 0;
     virtual void emit_condition(CodeGenerator& code_generator, size_t jump_if_false, size_t jump_if_true) const = 0 ;
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>& callback) const = 0;
+
+    // Loop invariant expressions evaluate to the same value in every iteration and can be evaluated
+    // before the loop without trapping or allocating (see WhileStatement::emit)
+    virtual bool is_loop_invariant(const SideEffects& loop_effects) const = 0;
+
+    virtual void collect_side_effects(SideEffects& effects) const {
+        this->for_each_sub_expression([&](const Expression& sub_expression) {
+            sub_expression.collect_side_effects(effects);
+        });
+    }
+
+    // Collects the largest loop invariant sub expressions that are worth to be hoisted
+    void collect_invariant_expressions(const SideEffects& loop_effects, std::vector<const Expression *>& output) const {
+        if (this->is_loop_invariant(loop_effects)) {
+            bool is_leaf = true;
+            this->for_each_sub_expression([&](const Expression&) { is_leaf = false; });
+            if (!is_leaf) {
+                output.push_back(this);
+            }
+            return;
+        }
+
+        this->for_each_sub_expression([&](const Expression& sub_expression) {
+            sub_expression.collect_invariant_expressions(loop_effects, output);
+        });
+    }
 
-    std::shared_ptr<Type> get_type() const {
+    // Loads the value of the expression from a variable if it was hoisted out of the current loop
+    bool emit_hoisted(CodeGenerator& code_generator) const;
+
+    // Checks whether the expression is an integer that is known to be >= 0, given the variables that
+    // are never assigned a negative value (see ValueRangeAnalysis)
+    virtual bool is_non_negative(const std::unordered_set<size_t>&) const {
+        return false;
+    }
+
+    // Collects what is known about indices if this expression is a condition that evaluated to true:
+    // pairs of index and object variable with 'index < object.length' and index variables with 'index >= 0'
+    virtual void collect_index_facts(std::vector<std::pair<size_t, size_t>>&, std::unordered_set<size_t>&) const {}
+
+    const std::shared_ptr<Type>& get_type() const {
         return this->type;
     }
     
@@ -37,17 +108,29 @@ std::ostream& operator<<(std::ostream& output_stream, const Expression& expressi
     return output_stream;
 }
 
+std::vector<std::pair<size_t, size_t>> find_index_bounds(const Expression& condition, const std::unordered_set<size_t>& counting_variables);
+void add_index_bounds(CodeGenerator& code_generator, const Expression& condition);
+
 #define INST(t) code_generator.push_instruction(Instruction(InstructionType:: t))  
 #define INT_INST(t, op) code_generator.push_instruction(Instruction(InstructionType:: t, Word { .as_int = (int64_t) (op) }))  
 #define FLOAT_INST(t, op) code_generator.push_instruction(Instruction(InstructionType:: t, Word { .as_float = (double) (op) }))  
 
+bool Expression::emit_hoisted(CodeGenerator& code_generator) const {
+    if (!code_generator.is_hoisted(this)) {
+        return false;
+    }
+    INT_INST(VLOAD, code_generator.get_hoisted_variable(this));
+    return true;
+}
+
 class VariableExpression : public Expression {
 private:
     Token variable_name;
+    size_t name_id;
     size_t id;
 public:
     VariableExpression(const Token& variable_name)
-        : Expression(variable_name.get_location()), variable_name(variable_name), id(0)
+        : Expression(variable_name.get_location()), variable_name(variable_name), name_id(TypeChecker::get().get_name_id(variable_name.get_text())), id(0)
     {}
     
     virtual void append_to_output_stream(std::ostream& output_stream, size_t layer = 0) const override {
@@ -56,12 +139,12 @@ public:
     }
     
     virtual void type_check() override {
-        const std::string& name_string = this->variable_name.get_text();
-        if (!TypeChecker::get().symbol_exists(name_string)) {
+        std::string_view name_string(this->variable_name.get_text());
+        if (!TypeChecker::get().symbol_exists(this->name_id)) {
             TYPE_ERROR("Undefined reference to variable '" << name_string << "'.");
         }
 
-        const auto& symbol = TypeChecker::get().get_symbol(name_string);
+        const auto& symbol = TypeChecker::get().get_symbol(this->name_id);
         if (symbol->get_symbol_type() != SymbolType::VARIABLE) {
             TYPE_ERROR("Symbol '" << name_string << "' is not a variable.");
         }
@@ -75,6 +158,10 @@ public:
         return this->variable_name;
     }
 
+    size_t get_name_id() const {
+        return this->name_id;
+    }
+
     size_t get_id() const {
         return this->id;
     }
@@ -88,6 +175,16 @@ public:
         INT_INST(JEQZ, jump_if_false);
         INT_INST(JUMP, jump_if_true);
     }
+
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>&) const override {}
+
+    virtual bool is_loop_invariant(const SideEffects& loop_effects) const override {
+        return !loop_effects.is_variable_assigned(this->id);
+    }
+
+    virtual bool is_non_negative(const std::unordered_set<size_t>& non_negative_variables) const override {
+        return non_negative_variables.contains(this->id);
+    }
     
     virtual bool is_lvalue() const override {
         return true;
@@ -99,12 +196,13 @@ public:
 class IndexingExpression : public Expression {
 friend class BinaryExpression;
 private:
-    std::unique_ptr<Expression> operand;
-    std::unique_ptr<Expression> index;
+    Expression *operand;
+    Expression *index;
     bool is_writable;
+    size_t index_field_slot;
 public:
-    IndexingExpression(std::unique_ptr<Expression> operand, std::unique_ptr<Expression> index)
-        : Expression(operand->get_location()), operand(std::move(operand)), index(std::move(index)), is_writable(false)
+    IndexingExpression(Expression *operand, Expression *index)
+        : Expression(operand->get_location()), operand(operand), index(index), is_writable(false), index_field_slot(0)
     {}
 
     virtual void append_to_output_stream(std::ostream& output_stream, size_t layer = 0) const override {
@@ -119,11 +217,11 @@ public:
 
         auto operand_type = this->operand->get_type();
 
-        if (!operand_type->has_field("@index")) {
+        if (!operand_type->find_field_slot("@index", this->index_field_slot)) {
             TYPE_ERROR("Type <" << operand_type->to_string() << "> is not indexable");
         }
 
-        const auto& field = operand_type->get_field("@index");
+        const auto& field = operand_type->get_field(this->index_field_slot);
         auto inner_type = field->get_type();
         this->is_writable = field->get_access() == FieldAccess::READ_WRITE;
         
@@ -138,29 +236,95 @@ public:
         }
     }
     
-    virtual void emit(CodeGenerator& code_generator) const override {
+    size_t get_element_size() const {
+        if (this->get_type()->is_object()) {
+            return sizeof(Word);
+        } else {
+            return this->get_type()->get_size();
+        }
+    }
+
+    size_t get_data_pointer_offset() const {
+        return this->operand->get_type()->get_field(this->index_field_slot)->get_alignment();
+    }
+
+    // Checks whether the index is known to be inside of the bounds of the indexed list or string, in
+    // which case the element can be accessed without a bounds check
+    bool is_in_bounds(const CodeGenerator& code_generator) const {
+        auto as_variable_expression = dynamic_cast<VariableExpression *>(this->operand);
+        auto index_as_variable_expression = dynamic_cast<VariableExpression *>(this->index);
+        if (as_variable_expression == nullptr || index_as_variable_expression == nullptr) {
+            return false;
+        }
+        return code_generator.is_index_in_bounds(as_variable_expression->get_id(), index_as_variable_expression->get_id());
+    }
+
+    // Pushes the pointer to the first element of the indexed list or string
+    void emit_data_pointer(CodeGenerator& code_generator) const {
         assert(this->operand->get_type()->is_object());
-        
+
+        auto as_variable_expression = dynamic_cast<VariableExpression *>(this->operand);
+        if (as_variable_expression != nullptr && code_generator.has_hoisted_data_pointer(as_variable_expression->get_id())) {
+            INT_INST(VLOAD, code_generator.get_hoisted_data_pointer(as_variable_expression->get_id()));
+            return;
+        }
+
         this->operand->emit(code_generator);
-        auto operand_type = this->operand->get_type();
-        // TODO: Add boundary checks
-        size_t data_pointer_offset = operand_type->get_field("@index")->get_alignment();
-        INT_INST(PUSH, data_pointer_offset);
+        INT_INST(PUSH, this->get_data_pointer_offset());
         INST(PADD);
-        INST(READW);
-        this->index->emit(code_generator);
+        INT_INST(READW, true);
+    }
 
-        size_t element_size;
-        bool are_elements_objects = this->get_type()->is_object();
-        if (are_elements_objects) {
-            element_size = sizeof(Word);
-        } else {
-            element_size = this->get_type()->get_size();
+    // Pushes the pointer to the indexed element without checking the index
+    void emit_element_pointer(CodeGenerator& code_generator) const {
+        auto as_variable_expression = dynamic_cast<VariableExpression *>(this->operand);
+        auto index_as_variable_expression = dynamic_cast<VariableExpression *>(this->index);
+        if (as_variable_expression != nullptr && index_as_variable_expression != nullptr) {
+            size_t object_variable = as_variable_expression->get_id();
+            size_t index_variable = index_as_variable_expression->get_id();
+            if (code_generator.has_induction_pointer(object_variable, index_variable)) {
+                INT_INST(VLOAD, code_generator.get_induction_pointer(object_variable, index_variable));
+                return;
+            }
         }
 
-        INT_INST(PUSH, element_size);
+        this->emit_data_pointer(code_generator);
+        this->index->emit(code_generator);
+        INT_INST(PUSH, this->get_element_size());
         INST(IMUL);
         INST(PADD);
+    }
+
+    Expression *get_operand() const {
+        return this->operand;
+    }
+
+    Expression *get_index() const {
+        return this->index;
+    }
+
+    virtual void emit(CodeGenerator& code_generator) const override {
+        size_t element_size = this->get_element_size();
+        bool are_elements_objects = this->get_type()->is_object();
+
+        if (!this->is_in_bounds(code_generator)) {
+            this->operand->emit(code_generator);
+            this->index->emit(code_generator);
+            int64_t operand = ELEMENT_ACCESS_OPERAND(this->get_data_pointer_offset(), are_elements_objects);
+            switch (element_size) {
+                case sizeof(char): // bytes
+                    INT_INST(ELOADB, operand);
+                    break;
+                case sizeof(Word):
+                    INT_INST(ELOADW, operand);
+                    break;
+                default:
+                    assert(false && "not implemented");
+            }
+            return;
+        }
+
+        this->emit_element_pointer(code_generator);
 
         switch (element_size) {
             case sizeof(char): // bytes
@@ -180,6 +344,16 @@ public:
         INT_INST(JUMP, jump_if_true); 
     }
 
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>& callback) const override {
+        callback(*this->operand);
+        callback(*this->index);
+    }
+
+    // Elements may be changed by stores and the index is not guaranteed to be in bounds before the loop
+    virtual bool is_loop_invariant(const SideEffects&) const override {
+        return false;
+    }
+
     // TODO: Make this more general (strings are immutable; this should probably be handled like fields)
     virtual bool is_lvalue() const override {
         return this->is_writable;
@@ -190,8 +364,10 @@ public:
 
 class BinaryExpression : public Expression {
 private:
-    std::unique_ptr<Expression> left, right;
+    Expression *left, *right;
     Token operator_token;
+    // Resolved by the type check, nullptr for assignments
+    const BinaryOperator *binary_operator;
 
     //bool is_comparison_operator() const {
     //    switch (this->operator_token->get_type()) {
@@ -208,11 +384,12 @@ private:
     //}
 
 public:
-    BinaryExpression(std::unique_ptr<Expression> left, std::unique_ptr<Expression> right, const Token& operator_token) :
+    BinaryExpression(Expression *left, Expression *right, const Token& operator_token) :
         Expression(left->get_location()),
-        left(std::move(left)),
-        right(std::move(right)),
-        operator_token(operator_token)
+        left(left),
+        right(right),
+        operator_token(operator_token),
+        binary_operator(nullptr)
     {}
     
     virtual void append_to_output_stream(std::ostream& output_stream, size_t layer = 0) const override {
@@ -241,52 +418,69 @@ public:
             // This is questionable
             this->set_type(left_type);
         } else { // Regular Operator
-            for (size_t i = 0; i < BINARY_OPERATOR_COUNT; i++) {
-                const BinaryOperator& binary_operator = BinaryOperator::OPERATORS[i];
-                if (binary_operator.fits_criteria(this->operator_token.get_type(), left_type, right_type)) {
-                    this->set_type(binary_operator.get_return_type());
-                    return;
-                }
+            this->binary_operator = BinaryOperator::resolve(this->operator_token.get_type(), left_type, right_type);
+            if (this->binary_operator != nullptr) {
+                this->set_type(this->binary_operator->get_return_type());
+                return;
             }
-            
+
             TYPE_ERROR("Operator '" << this->operator_token.get_text() << "' is not defined for types <" << left_type->to_string() << "> and <" << right_type->to_string() << ">.");
         }
     }
 
     virtual void emit(CodeGenerator& code_generator) const override {
+        if (this->emit_hoisted(code_generator)) {
+            return;
+        }
+
         if (this->operator_token.get_type() == TokenType::EQUAL) {
-            auto as_variable_expression = dynamic_cast<VariableExpression *>(this->left.get());
-            auto as_index_expression = dynamic_cast<IndexingExpression *>(this->left.get());
+            auto as_variable_expression = dynamic_cast<VariableExpression *>(this->left);
+            auto as_index_expression = dynamic_cast<IndexingExpression *>(this->left);
 
             if (as_variable_expression != nullptr) {
                 size_t id = as_variable_expression->get_id();
                 assert(!this->right->get_type()->fits(Type::VOID));
 
                 this->right->emit(code_generator);
+
+                // Keep the element pointers derived from an induction variable in sync (see WhileStatement::emit)
+                int64_t step;
+                if (code_generator.has_induction_pointers(id) && this->get_induction_step(id, step)) {
+                    for (const auto& [pointer, element_size] : code_generator.get_induction_pointers(id)) {
+                        INT_INST(VLOAD, pointer);
+                        INT_INST(PUSH, step * (int64_t) element_size);
+                        INST(PADD);
+                        INT_INST(VWRITE, pointer);
+                    }
+                }
+
                 INST(DUP);
                 INT_INST(VWRITE, id);
+                code_generator.invalidate_index_bounds(id);
             } else if (as_index_expression != nullptr) {
                 assert(!this->right->get_type()->fits(Type::VOID));
-                as_index_expression->operand->emit(code_generator);
-
-                size_t data_offset = as_index_expression->operand->get_type()->get_field("@index")->get_alignment();
-                INT_INST(PUSH, data_offset);
-                INST(PADD);
-                INT_INST(READW, true);
-
-                // TODO: This is dublicate code
-                size_t element_size;
+                size_t element_size = as_index_expression->get_element_size();
                 bool is_element_object = as_index_expression->get_type()->is_object();
-                if (is_element_object) {
-                    element_size = sizeof(Word);
-                } else {
-                    element_size = this->left->get_type()->get_size();
+
+                if (!as_index_expression->is_in_bounds(code_generator)) {
+                    as_index_expression->operand->emit(code_generator);
+                    as_index_expression->index->emit(code_generator);
+                    this->right->emit(code_generator);
+                    int64_t operand = ELEMENT_ACCESS_OPERAND(as_index_expression->get_data_pointer_offset(), is_element_object);
+                    switch (element_size) {
+                        case sizeof(char):
+                            INT_INST(ESTOREB, operand);
+                            break;
+                        case sizeof(Word):
+                            INT_INST(ESTOREW, operand);
+                            break;
+                        default:
+                            assert(false && "unreachable");
+                    }
+                    return;
                 }
 
-                as_index_expression->index->emit(code_generator);
-                INT_INST(PUSH, element_size);
-                INST(IMUL);
-                INST(PADD);
+                as_index_expression->emit_element_pointer(code_generator);
                 INST(DUP);
                 this->right->emit(code_generator);
                 switch (element_size) {
@@ -317,75 +511,31 @@ public:
             INT_INST(PUSH, 0);
             INT_INST(LABEL, end_label);
         } else {
-            this->left->emit(code_generator);
-            this->right->emit(code_generator);
-            auto left_type = this->left->get_type();
-
-            if (left_type->fits(Type::INT)) {
-                switch (this->operator_token.get_type()) {
-                    case TokenType::PLUS:
-                        INST(IADD);
-                        break;
-                    case TokenType::MINUS:
-                        INST(ISUB);
-                        break;
-                    case TokenType::STAR:
-                        INST(IMUL);
-                        break;
-                    case TokenType::SLASH:
-                        INST(IDIV);
-                        break;
-
-                    case TokenType::LESS_LESS:
-                        INST(ISHL);
-                        break;
-                    case TokenType::GREATER_GREATER:
-                        INST(ISHR);
-                        break;
-                    case TokenType::AND:
-                        INST(IAND);
-                        break;
-                    case TokenType::PIPE:
-                        INST(IOR);
-                        break;
-                    case TokenType::HAT:
-                        INST(IXOR);
-                        break;
-
-                    case TokenType::PERCENT:
-                        INST(IMOD);
-                        break;
-
-                    default:
-                        assert(false && "not implemented");
-                }
-            } else if (left_type->fits(Type::FLOAT)) {
-                switch (this->operator_token.get_type()) {
-                    case TokenType::PLUS:
-                        INST(FADD);
-                        break;
-                    case TokenType::MINUS:
-                        INST(FSUB);
-                        break;
-                    case TokenType::STAR:
-                        INST(FMUL);
-                        break;
-                    case TokenType::SLASH:
-                        INST(FDIV);
-                        break;
-                    default:
-                        assert(false && "not implemented");
+            // Division of a non negative integer by a power of two can be done by shifting and masking
+            int64_t exponent;
+            TokenType operator_type = this->operator_token.get_type();
+            bool is_division = operator_type == TokenType::SLASH || operator_type == TokenType::PERCENT;
+            if (is_division && code_generator.is_optimization_enabled("shift-division") && this->get_power_of_two_divisor(exponent) && this->left->is_non_negative(code_generator.get_non_negative_variables())) {
+                this->left->emit(code_generator);
+                if (operator_type == TokenType::SLASH) {
+                    INT_INST(PUSH, exponent);
+                    INST(ISHR);
+                } else {
+                    INT_INST(PUSH, (((int64_t) 1) << exponent) - 1);
+                    INST(IAND);
                 }
+                return;
             }
 
+            this->left->emit(code_generator);
+            this->right->emit(code_generator);
+            code_generator.push_instruction(Instruction(this->binary_operator->get_instruction()));
         }
     }
     
     virtual void emit_condition(CodeGenerator& code_generator, size_t jump_if_false, size_t jump_if_true) const {
         assert(this->get_type()->fits(Type::BOOL));
 
-        bool is_float = this->get_type()->fits(Type::FLOAT);
-
         switch (this->operator_token.get_type()) {
             case TokenType::EQUAL_EQUAL: 
                 this->left->emit(code_generator); 
@@ -394,7 +544,7 @@ public:
                 if (!this->right->get_type()->fits(this->left->get_type())) {
                     TYPE_ERROR("Both sides of '==' operator must have the same type, instead got <" << this->left->get_type()->to_string() << "> and <" << this->right->get_type() << ">.");
                 }
-                INT_INST(JNEQ, jump_if_false);
+                code_generator.push_instruction(Instruction(this->binary_operator->get_instruction(), Word { .as_int = (int64_t) jump_if_false }));
                 INT_INST(JUMP, jump_if_true); 
                 break;
             
@@ -405,29 +555,31 @@ public:
                 if (!this->right->get_type()->fits(this->left->get_type())) {
                     TYPE_ERROR("Both sides of '!=' operator must have the same type, instead got <" << this->left->get_type()->to_string() << "> and <" << this->right->get_type() << ">.");
                 }
-                INT_INST(JEQ, jump_if_false);
+                code_generator.push_instruction(Instruction(this->binary_operator->get_instruction(), Word { .as_int = (int64_t) jump_if_false }));
                 INT_INST(JUMP, jump_if_true); 
                 break;
 
-#define COMPARISON_INSTRUCTIONS(TOKEN_TYPE, INSTRUCTION_TYPE) \
-            case TokenType:: TOKEN_TYPE : \
-                this->left->emit(code_generator); \
-                this->right->emit(code_generator); \
-                code_generator.push_instruction(Instruction((INSTRUCTION_TYPE), Word { .as_int = (int64_t) jump_if_false })); \
-                INT_INST(JUMP, jump_if_true); \
+            case TokenType::LESS:
+            case TokenType::LESS_EQUAL:
+            case TokenType::GREATER:
+            case TokenType::GREATER_EQUAL:
+                this->left->emit(code_generator);
+                this->right->emit(code_generator);
+                code_generator.push_instruction(Instruction(this->binary_operator->get_instruction(), Word { .as_int = (int64_t) jump_if_false }));
+                INT_INST(JUMP, jump_if_true);
                 break;
 
-            COMPARISON_INSTRUCTIONS(LESS, is_float ? InstructionType::JFGE : InstructionType::JIGE)
-            COMPARISON_INSTRUCTIONS(LESS_EQUAL, is_float ? InstructionType::JFGT : InstructionType::JIGT)
-            COMPARISON_INSTRUCTIONS(GREATER, is_float ? InstructionType::JFLE : InstructionType::JILE)
-            COMPARISON_INSTRUCTIONS(GREATER_EQUAL, is_float ? InstructionType::JFLT : InstructionType::JILT)
-
             case TokenType::AND_AND:
                 {
                     size_t mid_label = code_generator.generate_label();
                     this->left->emit_condition(code_generator, jump_if_false, mid_label);
                     INT_INST(LABEL, mid_label);
+
+                    // The right side is only evaluated if the left side is true
+                    auto index_bounds = code_generator.get_index_bounds();
+                    add_index_bounds(code_generator, *this->left);
                     this->right->emit_condition(code_generator, jump_if_false, jump_if_true);
+                    code_generator.restrict_index_bounds(index_bounds);
                     break;
                 }
             case TokenType::PIPE_PIPE:
@@ -443,6 +595,74 @@ public:
         }
 
     }
+
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>& callback) const override {
+        callback(*this->left);
+        callback(*this->right);
+    }
+
+    Expression *get_left() const {
+        return this->left;
+    }
+
+    Expression *get_right() const {
+        return this->right;
+    }
+
+    const Token& get_operator_token() const {
+        return this->operator_token;
+    }
+
+    // Checks whether this is an assignment of the form 'variable = variable + c' or 'variable = variable - c'
+    bool get_induction_step(size_t variable, int64_t& step) const;
+
+    // Checks whether the right operand is an integer literal 2^exponent
+    bool get_power_of_two_divisor(int64_t& exponent) const;
+
+    virtual void collect_index_facts(std::vector<std::pair<size_t, size_t>>& upper_bounds, std::unordered_set<size_t>& lower_bounds) const override;
+
+    virtual bool is_non_negative(const std::unordered_set<size_t>& non_negative_variables) const override {
+        switch (this->operator_token.get_type()) {
+            // Sums and products of non negative integers can wrap around, the results of these operators can not
+            case TokenType::SLASH:
+            case TokenType::PERCENT:
+            case TokenType::GREATER_GREATER:
+            case TokenType::AND:
+                return this->get_type()->fits(Type::INT) &&
+                    this->left->is_non_negative(non_negative_variables) &&
+                    this->right->is_non_negative(non_negative_variables);
+            default:
+                return false;
+        }
+    }
+
+    virtual void collect_side_effects(SideEffects& effects) const override {
+        if (this->operator_token.get_type() == TokenType::EQUAL) {
+            auto as_variable_expression = dynamic_cast<VariableExpression *>(this->left);
+            if (as_variable_expression != nullptr) {
+                effects.add_assigned_variable(as_variable_expression->get_id());
+            } else {
+                effects.set_writes_memory();
+            }
+        }
+        this->left->collect_side_effects(effects);
+        this->right->collect_side_effects(effects);
+    }
+
+    virtual bool is_loop_invariant(const SideEffects& loop_effects) const override {
+        TokenType operator_type = this->operator_token.get_type();
+        if (operator_type == TokenType::EQUAL || this->get_type()->fits(Type::BOOL)) {
+            return false;
+        }
+
+        // Integer division traps on zero, so it must not be executed speculatively
+        bool is_integer_division = operator_type == TokenType::SLASH || operator_type == TokenType::PERCENT;
+        if (is_integer_division && this->get_type()->fits(Type::INT)) {
+            return false;
+        }
+
+        return this->left->is_loop_invariant(loop_effects) && this->right->is_loop_invariant(loop_effects);
+    }
     
     virtual bool is_lvalue() const override {
         return false;
@@ -506,9 +726,12 @@ bool parse_escaped_string(const std::string& input_string, std::string& output)
 class LiteralExpression : public Expression {
 private:
     Token literal_token;
+    // Parsed while type checking, so emitting the literal can not fail
+    Word value;
+    std::string string_value;
 public:
     LiteralExpression(const Token& literal_token)
-        : Expression(literal_token.get_location()), literal_token(literal_token)
+        : Expression(literal_token.get_location()), literal_token(literal_token), value(Word { .as_int = 0 }), string_value()
     {}
     
     virtual void append_to_output_stream(std::ostream& output_stream, size_t layer = 0) const override {
@@ -517,25 +740,55 @@ public:
     }
     
     virtual void type_check() override {
+        std::string literal_string(this->literal_token.get_text());
         switch (this->literal_token.get_type()) {
             case TokenType::INT_LITERAL:
+                try {
+                    this->value.as_int = std::stol(literal_string);
+                } catch(std::exception& e) {
+                    TYPE_ERROR("Could not parse integer literal '" << literal_string << "'.");
+                }
                 this->set_type(Type::INT);
                 break;
             
             case TokenType::STRING_LITERAL:
+                assert(literal_string.size() >= 2);
+                if (!parse_escaped_string(literal_string.substr(1,literal_string.size()-2), this->string_value)) {
+                    TYPE_ERROR("Char literal contains invalid escape characters: " << literal_string << ".");
+                }
                 this->set_type(Type::STRING);
                 break;
 
             case TokenType::CHAR_LITERAL:
+                {
+                    std::string parsed_string;
+                    assert(literal_string.size() >= 2);
+                    
+                    if (!parse_escaped_string(literal_string.substr(1,literal_string.size()-2), parsed_string)) {
+                        TYPE_ERROR("Char literal contains invalid escape characters: " << literal_string << ".");
+                    }
+
+                    if (parsed_string.size() != 1) {
+                        TYPE_ERROR("Char literal must have exactly one character, instead got " << parsed_string.size() << ".");
+                    }
+
+                    this->value.as_int = parsed_string[0];
+                }
                 this->set_type(Type::CHAR);
                 break;
             
             case TokenType::FLOAT_LITERAL:
+                try {
+                    this->value.as_float = std::stod(literal_string);
+                } catch(std::exception& e) {
+                    TYPE_ERROR("Could not parse float literal '" << literal_string << "'.");
+                }
                 this->set_type(Type::FLOAT);
                 break;
             
             case TokenType::FALSE_KEYWORD:
             case TokenType::TRUE_KEYWORD:
+                this->value.as_int = this->literal_token.get_type() == TokenType::TRUE_KEYWORD;
                 this->set_type(Type::BOOL);
                 break;
 
@@ -544,35 +797,25 @@ public:
         }
     }
     
+    bool get_int_value(int64_t& value) const {
+        if (this->literal_token.get_type() != TokenType::INT_LITERAL) {
+            return false;
+        }
+        try {
+            value = std::stol(std::string(this->literal_token.get_text()));
+        } catch(std::exception& e) {
+            return false;
+        }
+        return true;
+    }
+
     virtual void emit(CodeGenerator& code_generator) const override {
-        const std::string& literal_string = this->literal_token.get_text();
         switch (this->literal_token.get_type()) {
-            case TokenType::INT_LITERAL:
-                {
-                    int64_t parsed;
-                    try {
-                        parsed = std::stol(literal_string);
-                    } catch(std::exception& e) {
-                        std::cout << this->get_location() << ": GENERATION_ERROR: Could not parse integer literal '" << literal_string << "'." << std::endl;
-                        std::exit(1);
-                    }
-                    INT_INST(PUSH, parsed);
-                }
-                break;
-            
             case TokenType::STRING_LITERAL:
                 {
-                    std::string parsed_string;
-                    assert(literal_string.size() >= 2);
-                    
-                    if (!parse_escaped_string(literal_string.substr(1,literal_string.size()-2), parsed_string)) {
-                        std::cerr << this->get_location() << ": Char literal contains invalid escape characters: " << literal_string << "." << std::endl;
-                        std::exit(1);
-                    }
-
                     // allocate string data as static memory
-                    size_t static_offset = code_generator.allocate_static_objects(ObjectLayout::predefined_layouts[BYTE_LAYOUT], parsed_string.size());
-                    std::memcpy(code_generator.get_static_data_pointer(static_offset), parsed_string.data(), sizeof(char) * parsed_string.size());
+                    size_t static_offset = code_generator.allocate_static_objects(ObjectLayout::predefined_layouts[BYTE_LAYOUT], this->string_value.size());
+                    std::memcpy(code_generator.get_static_data_pointer(static_offset), this->string_value.data(), sizeof(char) * this->string_value.size());
 
                     // allocate string object on the heap
                     // - first push 1 on the stack (1 string object will be allocated)
@@ -583,14 +826,14 @@ public:
                     INST(DUP);
 
                     // write string size into first field of string object
-                    INT_INST(PUSH, parsed_string.size());
+                    INT_INST(PUSH, this->string_value.size());
                     INST(WRITEW);
                     
                     // duplicate pointer value because it was consumed by WRITEW
                     INST(DUP);
                     // offset pointer to the data field of the string object
                     // - push offset (in this case there is one word before the data pointer)
-                    size_t data_offset = Type::STRING->get_field("data")->get_alignment();
+                    size_t data_offset = STRING_DATA_OFFSET;
                     INT_INST(PUSH, data_offset);
                     // - use pointer add instruction to offset the pointer
                     INST(PADD);
@@ -602,44 +845,12 @@ public:
                 }
                 break;
 
+            case TokenType::INT_LITERAL:
             case TokenType::CHAR_LITERAL:
-                {
-                    std::string parsed_string;
-                    assert(literal_string.size() >= 2);
-                    
-                    if (!parse_escaped_string(literal_string.substr(1,literal_string.size()-2), parsed_string)) {
-                        std::cerr << this->get_location() << ": Char literal contains invalid escape characters: " << literal_string << "." << std::endl;
-                        std::exit(1);
-                    }
-
-                    if (parsed_string.size() != 1) {
-                        std::cerr << this->get_location() << ": Char literal must have exactly one character, instead got " << parsed_string.size() << "." << std::endl;
-                        std::exit(1);
-                    }
-
-                    INT_INST(PUSH, parsed_string[0]);
-                }
-                break;
-            
             case TokenType::FLOAT_LITERAL:
-                {
-                    double parsed;
-                    try {
-                        parsed = std::stod(literal_string);
-                    } catch(std::exception& e) {
-                        std::cout << this->get_location() << ": GENERATION_ERROR: Could not parse float literal '" << literal_string << "'." << std::endl;
-                        std::exit(1);
-                    }
-                    FLOAT_INST(PUSH, parsed);
-                }
-                break;
-            
             case TokenType::FALSE_KEYWORD:
-                INT_INST(PUSH, 0);
-                break;
-
             case TokenType::TRUE_KEYWORD:
-                INT_INST(PUSH, 1);
+                code_generator.push_instruction(Instruction(InstructionType::PUSH, this->value));
                 break;
 
             default:
@@ -661,6 +872,17 @@ public:
 
         INT_INST(JUMP, jump_address);
     }
+
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>&) const override {}
+
+    // String literals allocate a new string object on every evaluation
+    virtual bool is_loop_invariant(const SideEffects&) const override {
+        return this->literal_token.get_type() != TokenType::STRING_LITERAL;
+    }
+
+    virtual bool is_non_negative(const std::unordered_set<size_t>&) const override {
+        return this->literal_token.get_type() == TokenType::INT_LITERAL;
+    }
     
     virtual bool is_lvalue() const override {
         return false;
@@ -669,16 +891,62 @@ public:
     ~LiteralExpression() {}
 };
 
+bool BinaryExpression::get_induction_step(size_t variable, int64_t& step) const {
+    auto as_variable_expression = dynamic_cast<VariableExpression *>(this->left);
+    if (this->operator_token.get_type() != TokenType::EQUAL || as_variable_expression == nullptr || as_variable_expression->get_id() != variable) {
+        return false;
+    }
+
+    auto right_as_binary_expression = dynamic_cast<BinaryExpression *>(this->right);
+    if (right_as_binary_expression == nullptr) {
+        return false;
+    }
+
+    TokenType operator_type = right_as_binary_expression->operator_token.get_type();
+    auto incremented = dynamic_cast<VariableExpression *>(right_as_binary_expression->left);
+    auto increment = dynamic_cast<LiteralExpression *>(right_as_binary_expression->right);
+    if ((operator_type != TokenType::PLUS && operator_type != TokenType::MINUS) || incremented == nullptr || increment == nullptr) {
+        return false;
+    }
+
+    if (incremented->get_id() != variable || !increment->get_int_value(step)) {
+        return false;
+    }
+
+    if (operator_type == TokenType::MINUS) {
+        step = -step;
+    }
+    return true;
+}
+
+bool BinaryExpression::get_power_of_two_divisor(int64_t& exponent) const {
+    auto divisor = dynamic_cast<LiteralExpression *>(this->right);
+    int64_t value;
+    if (divisor == nullptr || !divisor->get_int_value(value) || value <= 0 || (value & (value - 1)) != 0) {
+        return false;
+    }
+
+    exponent = 0;
+    while (value > 1) {
+        value >>= 1;
+        exponent += 1;
+    }
+    return true;
+}
+
 
 class MemberAccessExpression : public Expression {
 friend class CallExpression;
 private:
-    std::unique_ptr<Expression> accessed;
+    Expression *accessed;
     Token member_name;
+    // Methods are functions with the member name
+    size_t member_name_id;
     bool is_writable;
+    size_t field_slot;
 public:
-    MemberAccessExpression(std::unique_ptr<Expression> accessed, const Token& member_name)
-        : Expression(accessed->get_location()), accessed(std::move(accessed)), member_name(member_name)
+    MemberAccessExpression(Expression *accessed, const Token& member_name)
+        : Expression(accessed->get_location()), accessed(accessed), member_name(member_name), member_name_id(TypeChecker::get().get_name_id(member_name.get_text())), is_writable(false), field_slot(0)
     {}
 
     virtual void append_to_output_stream(std::ostream& output_stream, size_t layer = 0) const override {
@@ -690,47 +958,42 @@ public:
     const Token& get_member_name() const {
         return this->member_name;
     }
+
+    size_t get_member_name_id() const {
+        return this->member_name_id;
+    }
+
+    Expression *get_accessed() const {
+        return this->accessed;
+    }
     
     virtual void type_check() override {
         this->accessed->type_check();
         const auto& accessed_type = this->accessed->get_type();
-        const std::string& field_name = this->member_name.get_text();
+        std::string_view field_name = this->member_name.get_text();
         
-        if (!accessed_type->has_field(field_name)) {
-            std::cerr <<
-                this->get_location() <<
-                ": TYPE_ERROR: Type <" <<
-                accessed_type->to_string() <<
-                "> does not have a field '" <<
-                field_name <<
-                "'." <<
-                std::endl;
-            std::exit(1);
+        if (!accessed_type->find_field_slot(field_name, this->field_slot)) {
+            TYPE_ERROR("Type <" << accessed_type->to_string() << "> does not have a field '" << field_name << "'.");
         }
 
-        const auto& field = accessed_type->get_field(field_name);
+        const auto& field = accessed_type->get_field(this->field_slot);
         this->is_writable = field->get_access() == FieldAccess::READ_WRITE;
         if (field->get_access() == FieldAccess::READ || this->is_writable) {
             this->set_type(field->get_type());
         } else {
-            std::cerr <<
-                this->get_location() <<
-                ": TYPE_ERROR: Type <" <<
-                accessed_type->to_string() <<
-                "> does not have a field '" <<
-                field_name <<
-                "'." <<
-                std::endl;
-            std::exit(1);
+            TYPE_ERROR("Type <" << accessed_type->to_string() << "> does not have a field '" << field_name << "'.");
         }
     }
     
     virtual void emit(CodeGenerator& code_generator) const override {
+        if (this->emit_hoisted(code_generator)) {
+            return;
+        }
+
         auto accessed_type = this->accessed->get_type();
-        const std::string& field_name = this->member_name.get_text();
         assert(accessed_type->is_object());
 
-        size_t offset = this->accessed->get_type()->get_field(field_name)->get_alignment();
+        size_t offset = accessed_type->get_field(this->field_slot)->get_alignment();
         this->accessed->emit(code_generator);
         INT_INST(PUSH, offset);
         INST(PADD);
@@ -760,6 +1023,19 @@ public:
         INT_INST(JEQZ, jump_if_false); 
         INT_INST(JUMP, jump_if_true); 
     }
+
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>& callback) const override {
+        callback(*this->accessed);
+    }
+
+    // Fields are only written when an object is created, so they cannot change while the object stays the same
+    virtual bool is_loop_invariant(const SideEffects& loop_effects) const override {
+        return this->accessed->is_loop_invariant(loop_effects);
+    }
+
+    virtual bool is_non_negative(const std::unordered_set<size_t>&) const override {
+        return this->member_name.get_text() == "length";
+    }
     
     // TODO: Maybe add notion of a constant/mutable field
     virtual bool is_lvalue() const override {
@@ -769,15 +1045,74 @@ public:
     ~MemberAccessExpression() {}
 };
 
+// Checks whether the expression is 'object.length' with a variable 'object'
+static bool is_length_of_variable(const Expression& expression, size_t& object_variable) {
+    auto as_member_access_expression = dynamic_cast<const MemberAccessExpression *>(&expression);
+    if (as_member_access_expression == nullptr || as_member_access_expression->get_member_name().get_text() != "length") {
+        return false;
+    }
+    auto as_variable_expression = dynamic_cast<const VariableExpression *>(as_member_access_expression->get_accessed());
+    if (as_variable_expression == nullptr) {
+        return false;
+    }
+    object_variable = as_variable_expression->get_id();
+    return true;
+}
+
+void BinaryExpression::collect_index_facts(std::vector<std::pair<size_t, size_t>>& upper_bounds, std::unordered_set<size_t>& lower_bounds) const {
+    TokenType operator_type = this->operator_token.get_type();
+    if (operator_type == TokenType::AND_AND) {
+        this->left->collect_index_facts(upper_bounds, lower_bounds);
+        this->right->collect_index_facts(upper_bounds, lower_bounds);
+        return;
+    }
+
+    // Normalize 'b > a' to 'a < b' and '0 <= a' to 'a >= 0'
+    const Expression *left = this->left;
+    const Expression *right = this->right;
+    if (operator_type == TokenType::GREATER || operator_type == TokenType::LESS_EQUAL) {
+        std::swap(left, right);
+    }
+
+    auto left_as_variable = dynamic_cast<const VariableExpression *>(left);
+    if (left_as_variable == nullptr) {
+        return;
+    }
+
+    switch (operator_type) {
+        case TokenType::LESS:
+        case TokenType::GREATER:
+            {
+                size_t object_variable;
+                if (is_length_of_variable(*right, object_variable)) {
+                    upper_bounds.push_back({ left_as_variable->get_id(), object_variable });
+                }
+            }
+            break;
+        case TokenType::GREATER_EQUAL:
+        case TokenType::LESS_EQUAL:
+            {
+                auto right_as_literal = dynamic_cast<const LiteralExpression *>(right);
+                int64_t value;
+                if (right_as_literal != nullptr && right_as_literal->get_int_value(value) && value >= 0) {
+                    lower_bounds.insert(left_as_variable->get_id());
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
 class CallExpression : public Expression {
 private:
-    std::unique_ptr<Expression> called;
-    std::vector<std::unique_ptr<Expression>> arguments;
+    Expression *called;
+    std::vector<Expression *> arguments;
     size_t id;
     bool is_native;
 public:
-    CallExpression(std::unique_ptr<Expression> called, std::vector<std::unique_ptr<Expression>> arguments)
-        : Expression(called->get_location()), called(std::move(called)), arguments(std::move(arguments)) 
+    CallExpression(Expression *called, std::vector<Expression *> arguments)
+        : Expression(called->get_location()), called(called), arguments(std::move(arguments)) 
     {}
 
     virtual void append_to_output_stream(std::ostream& output_stream, size_t layer = 0) const override {
@@ -791,47 +1126,63 @@ public:
     
     virtual void type_check() override {
         // We are 'abusing' the fact that dynamic_cast returns nullptr if the pointer types don't match
-        auto as_regular_function_call = dynamic_cast<VariableExpression *>(this->called.get());
-        auto as_method_call = dynamic_cast<MemberAccessExpression *>(this->called.get());
+        auto as_regular_function_call = dynamic_cast<VariableExpression *>(this->called);
+        auto as_method_call = dynamic_cast<MemberAccessExpression *>(this->called);
 
-        auto get_function_symbol = [&](const std::string& function_name) -> const FunctionSymbol& {
-            if (!TypeChecker::get().symbol_exists(function_name)) {
+        auto resolve_call = [&](std::string_view function_name, size_t name_id, const std::vector<std::shared_ptr<Type>>& argument_types) {
+            if (!TypeChecker::get().symbol_exists(name_id)) {
                 TYPE_ERROR("Undefined ('" << function_name << "') is not a function.");
             }
             
-            const auto& symbol = TypeChecker::get().get_symbol(function_name);
+            const auto& symbol = TypeChecker::get().get_symbol(name_id);
+            if (symbol->get_symbol_type() == SymbolType::GENERIC_FUNCTION) {
+                const auto& generic_function_symbol = *dynamic_cast<GenericFunctionSymbol *>(symbol.get());
+
+                std::vector<std::shared_ptr<Type>> type_arguments;
+                if (!generic_function_symbol.infer_type_arguments(argument_types, type_arguments)) {
+                    TYPE_ERROR("Arguments for function '" << function_name << "' do not fit.");
+                }
+                for (size_t i = 0; i < type_arguments.size(); i++) {
+                    if (type_arguments[i] == nullptr || type_arguments[i]->is_generic()) {
+                        TYPE_ERROR("Type parameter '" << generic_function_symbol.get_type_parameters()[i] << "' of function '" << function_name << "' can not be inferred.");
+                    }
+                }
+
+                this->is_native = false;
+                this->set_type(generic_function_symbol.get_return_type(type_arguments));
+                TypeChecker::get().request_instance(&generic_function_symbol, std::move(type_arguments), &this->id);
+                return;
+            }
+
             if (symbol->get_symbol_type() != SymbolType::FUNCTION) {
                 TYPE_ERROR("Defined ('" << function_name << "') is not a function.");
             }
 
-            return *dynamic_cast<FunctionSymbol *>(symbol.get());
+            const auto& function_symbol = *dynamic_cast<FunctionSymbol *>(symbol.get());
+            if (!function_symbol.do_args_fit(argument_types)) {
+                TYPE_ERROR("Arguments for function '" << function_name << "' do not fit.");
+            }
+
+            this->id = function_symbol.get_id();
+            this->is_native = function_symbol.get_is_native();
+
+            this->set_type(function_symbol.get_return_type());
         };
 
         if (as_regular_function_call != nullptr) {
-            const std::string& function_name = as_regular_function_call->get_variable_name().get_text();
-
-            const auto& function_symbol = get_function_symbol(function_name);
+            std::string_view function_name(as_regular_function_call->get_variable_name().get_text());
 
             std::vector<std::shared_ptr<Type>> argument_types;
             for (auto& argument : this->arguments) {
                 argument->type_check();
                 argument_types.push_back(argument->get_type());
             }
-            
-            if (!function_symbol.do_args_fit(argument_types)) {
-                TYPE_ERROR("Arguments for function '" << function_name << "' do not fit.");
-            }
-
-            this->id = function_symbol.get_id();
-            this->is_native = function_symbol.get_is_native();
 
-            this->set_type(function_symbol.get_return_type());
+            resolve_call(function_name, as_regular_function_call->get_name_id(), argument_types);
         } else if (as_method_call != nullptr) {
             as_method_call->accessed->type_check();
-            const std::string& function_name = as_method_call->get_member_name().get_text();
+            std::string_view function_name(as_method_call->get_member_name().get_text());
 
-            const auto& function_symbol = get_function_symbol(function_name);
-            
             std::vector<std::shared_ptr<Type>> argument_types;
             argument_types.push_back(as_method_call->accessed->get_type());
 
@@ -839,23 +1190,15 @@ public:
                 argument->type_check();
                 argument_types.push_back(argument->get_type());
             }
-            
-            if (!function_symbol.do_args_fit(argument_types)) {
-                TYPE_ERROR("Arguments for function '" << function_name << "' do not fit.");
-            }
-            
-            this->id = function_symbol.get_id();
-            this->is_native = function_symbol.get_is_native();
-
-            this->set_type(function_symbol.get_return_type());
 
+            resolve_call(function_name, as_method_call->get_member_name_id(), argument_types);
         } else {
             TYPE_ERROR("The given expression is not callable.");
         }
     }
     
     virtual void emit(CodeGenerator& code_generator) const override {
-        auto as_method_call = dynamic_cast<MemberAccessExpression *>(this->called.get());
+        auto as_method_call = dynamic_cast<MemberAccessExpression *>(this->called);
 
         if (as_method_call != nullptr) {
             as_method_call->accessed->emit(code_generator);
@@ -877,6 +1220,29 @@ public:
         INT_INST(JEQZ, jump_if_false);
         INT_INST(JUMP, jump_if_true);
     }
+
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>& callback) const override {
+        auto as_method_call = dynamic_cast<MemberAccessExpression *>(this->called);
+        if (as_method_call != nullptr) {
+            callback(*as_method_call->accessed);
+        }
+
+        for (const auto& argument : this->arguments) {
+            callback(*argument);
+        }
+    }
+
+    virtual void collect_side_effects(SideEffects& effects) const override {
+        // Native functions only print or allocate new objects
+        if (!this->is_native) {
+            effects.set_writes_memory();
+        }
+        Expression::collect_side_effects(effects);
+    }
+
+    virtual bool is_loop_invariant(const SideEffects&) const override {
+        return false;
+    }
     
     virtual bool is_lvalue() const override {
         return false;
@@ -888,10 +1254,12 @@ public:
 class UnaryExpression : public Expression {
 private:
     Token operator_token;
-    std::unique_ptr<Expression> operand;
+    Expression *operand;
+    // Resolved by the type check
+    const UnaryOperator *unary_operator;
 public:
-    UnaryExpression(const Token& operator_token, std::unique_ptr<Expression> operand)
-        : Expression(operator_token.get_location()), operator_token(operator_token), operand(std::move(operand))
+    UnaryExpression(const Token& operator_token, Expression *operand)
+        : Expression(operator_token.get_location()), operator_token(operator_token), operand(operand), unary_operator(nullptr)
     {}
 
     virtual void append_to_output_stream(std::ostream& output_stream, size_t layer = 0) const override {
@@ -904,19 +1272,20 @@ public:
         this->operand->type_check();
         auto operand_type = this->operand->get_type();
         
-        for (size_t i = 0; i < UNARY_OPERATOR_COUNT; i++) {
-            const auto& unary_operator = UnaryOperator::OPERATORS[i];
-            if (unary_operator.fits_criteria(this->operator_token.get_type(), operand_type)) {
-                this->set_type(unary_operator.get_return_type());
-                return;
-            }
+        this->unary_operator = UnaryOperator::resolve(this->operator_token.get_type(), operand_type);
+        if (this->unary_operator != nullptr) {
+            this->set_type(this->unary_operator->get_return_type());
+            return;
         }
 
         TYPE_ERROR("Unary operator '" << this->operator_token.get_text() << "' is not defined for type <" << operand_type->to_string() << ">.");
     }
     
     virtual void emit(CodeGenerator& code_generator) const override {
-        
+        if (this->emit_hoisted(code_generator)) {
+            return;
+        }
+
         if (this->get_type()->fits(Type::BOOL)) {
             size_t false_label = code_generator.generate_label();
             size_t true_label = code_generator.generate_label();
@@ -931,26 +1300,8 @@ public:
             INT_INST(LABEL, end_label);
         } else {
             this->operand->emit(code_generator); 
-            switch (this->operator_token.get_type()) {
-                case TokenType::TILDE:
-                    INST(IBNEG);
-                    break;
-                case TokenType::PLUS:
-                    break;
-                case TokenType::MINUS:
-                    if (this->operand->get_type()->fits(Type::FLOAT)) {
-                        INST(FNEG);
-                    } else if (this->operand->get_type()->fits(Type::INT)) {
-                        INST(INEG);
-                    } else {
-                        assert(false && "unreachable");
-                    }
-                    break;
-                //case TokenType::BANG:
-                //    INST(LNEG);
-                //    break;
-                default:
-                    assert(false && "unreachable");
+            if (this->unary_operator->has_instruction()) {
+                code_generator.push_instruction(Instruction(this->unary_operator->get_instruction()));
             }
         }
     }
@@ -963,6 +1314,18 @@ public:
             assert(false && "unreachable");
         }
     }
+
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>& callback) const override {
+        callback(*this->operand);
+    }
+
+    virtual bool is_loop_invariant(const SideEffects& loop_effects) const override {
+        return !this->get_type()->fits(Type::BOOL) && this->operand->is_loop_invariant(loop_effects);
+    }
+
+    virtual bool is_non_negative(const std::unordered_set<size_t>& non_negative_variables) const override {
+        return this->operator_token.get_type() == TokenType::PLUS && this->operand->is_non_negative(non_negative_variables);
+    }
     
     virtual bool is_lvalue() const override {
         return false;
@@ -973,10 +1336,9 @@ public:
 
 class ListLiteralExpression : public Expression {
 private:
-    std::vector<std::unique_ptr<Expression>> element_initializers;
-    std::shared_ptr<Type> inner_type;
+    std::vector<Expression *> element_initializers;
 public:
-    ListLiteralExpression(const Location& start_location, std::vector<std::unique_ptr<Expression>> element_initializers)
+    ListLiteralExpression(const Location& start_location, std::vector<Expression *> element_initializers)
         : Expression(start_location), element_initializers(std::move(element_initializers))
     {}
 
@@ -990,7 +1352,7 @@ public:
     
     virtual void type_check() override {
         if (this->element_initializers.size() == 0) {
-            this->set_type(std::make_shared<ListType>(Type::GENERIC));
+            this->set_type(ListType::get(Type::GENERIC));
         } else {
             for (auto& element : this->element_initializers) {
                 element->type_check();
@@ -1009,24 +1371,29 @@ public:
                 }
             }
 
-            this->set_type(std::make_shared<ListType>(element_type));
-            this->inner_type = element_type;
+            this->set_type(ListType::get(element_type));
         }
-    }
-    
-    virtual void emit(CodeGenerator& code_generator) const override {
+
         if (this->get_type()->is_generic()) {
-            std::cerr << this->get_location() << ": GENERERATION_ERROR: Inner type of list is not known at compile time (try type casting the list initializer)." << std::endl;
-            std::exit(1);
+            TypeChecker::get().add_generic_list_literal(this);
         }
+    }
 
+    // Called once the function containing the list literal is type checked, so emitting it can not fail
+    void check_element_type() const {
+        if (this->get_type()->is_generic()) {
+            TYPE_ERROR("Inner type of list is not known at compile time (try type casting the list initializer).");
+        }
+    }
+    
+    virtual void emit(CodeGenerator& code_generator) const override {
         INT_INST(PUSH, 1);
         INT_INST(HALLOC, LIST_LAYOUT);
 
         auto list_type = this->get_type();
-        size_t length_offset = list_type->get_field("length")->get_alignment();
-        size_t capacity_offset = list_type->get_field("capacity")->get_alignment();
-        size_t data_offset = list_type->get_field("data")->get_alignment();
+        size_t length_offset = LIST_LENGTH_OFFSET;
+        size_t capacity_offset = LIST_CAPACITY_OFFSET;
+        size_t data_offset = LIST_DATA_OFFSET;
 
         // Write initial length, current stack: LIST_POINTER
         size_t init_length = this->element_initializers.size();
@@ -1049,12 +1416,14 @@ public:
         INT_INST(PUSH, data_offset);       // LIST_POINTER LIST_POINTER DATA_OFFSET
         INST(PADD);                        // LIST_POINTER DATA_FIELD_POINTER
         
+        // The type of an empty list literal is set by a type cast or annotation
+        auto inner_type = dynamic_cast<ListType *>(list_type.get())->get_inner_type();
         size_t element_layout;
         
-        if (this->inner_type->is_object()) {
+        if (inner_type->is_object()) {
             element_layout = POINTER_LAYOUT;
         } else {
-            element_layout = this->inner_type->get_layout_index();
+            element_layout = inner_type->get_layout_index();
         }
         
         size_t element_size = ObjectLayout::predefined_layouts[element_layout]->get_size();
@@ -1085,6 +1454,16 @@ public:
     virtual void emit_condition(CodeGenerator&, size_t, size_t) const {
         assert(false && "unreachable");
     }
+
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>& callback) const override {
+        for (const auto& element_initializer : this->element_initializers) {
+            callback(*element_initializer);
+        }
+    }
+
+    virtual bool is_loop_invariant(const SideEffects&) const override {
+        return false;
+    }
     
     virtual bool is_lvalue() const override {
         return false;
@@ -1096,11 +1475,11 @@ public:
 
 class CastExpression : public Expression {
 private:
-    std::unique_ptr<TypeAnnotation> type_annotation;
-    std::unique_ptr<Expression> casted;
+    TypeAnnotation *type_annotation;
+    Expression *casted;
 public:
-    CastExpression(const Location& start_location, std::unique_ptr<TypeAnnotation> type_annotation, std::unique_ptr<Expression> casted)
-        : Expression(start_location), type_annotation(std::move(type_annotation)), casted(std::move(casted))
+    CastExpression(const Location& start_location, TypeAnnotation *type_annotation, Expression *casted)
+        : Expression(start_location), type_annotation(type_annotation), casted(casted)
     {}
 
     virtual void append_to_output_stream(std::ostream& output_stream, size_t layer = 0) const override {
@@ -1138,6 +1517,10 @@ public:
     }
     
     virtual void emit(CodeGenerator& code_generator) const override {
+        if (this->emit_hoisted(code_generator)) {
+            return;
+        }
+
         this->casted->emit(code_generator);
 
         auto source_type = this->casted->get_type();
@@ -1147,7 +1530,7 @@ public:
             return;
         }
 
-        auto char_list_type = std::make_shared<ListType>(Type::CHAR);
+        auto char_list_type = ListType::get(Type::CHAR);
 
         if (source_type->fits(Type::INT)) {
             if (dest_type->fits(Type::CHAR)) {
@@ -1204,6 +1587,23 @@ public:
         INT_INST(JEQZ, jump_if_false);
         INT_INST(JUMP, jump_if_true);
     }
+
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>& callback) const override {
+        callback(*this->casted);
+    }
+
+    // Casts to strings and lists allocate new objects
+    virtual bool is_loop_invariant(const SideEffects& loop_effects) const override {
+        return !this->get_type()->is_object() && this->casted->is_loop_invariant(loop_effects);
+    }
+
+    virtual bool is_non_negative(const std::unordered_set<size_t>& non_negative_variables) const override {
+        auto source_type = this->casted->get_type();
+        if (source_type->fits(Type::BOOL)) {
+            return this->get_type()->fits(Type::INT);
+        }
+        return source_type->fits(Type::INT) && this->get_type()->fits(Type::INT) && this->casted->is_non_negative(non_negative_variables);
+    }
     
     virtual bool is_lvalue() const override {
         return false;
@@ -1211,3 +1611,26 @@ public:
 
     ~CastExpression() {}
 };
+
+// Index variables without a lower bound in the condition must be counting variables, see ValueRangeAnalysis
+std::vector<std::pair<size_t, size_t>> find_index_bounds(const Expression& condition, const std::unordered_set<size_t>& counting_variables) {
+    std::vector<std::pair<size_t, size_t>> upper_bounds;
+    std::unordered_set<size_t> lower_bounds;
+    condition.collect_index_facts(upper_bounds, lower_bounds);
+
+    // Pairs of object and index variable
+    std::vector<std::pair<size_t, size_t>> index_bounds;
+    for (const auto& [index_variable, object_variable] : upper_bounds) {
+        if (lower_bounds.contains(index_variable) || counting_variables.contains(index_variable)) {
+            index_bounds.push_back({ object_variable, index_variable });
+        }
+    }
+    return index_bounds;
+}
+
+// Records the index bounds that hold while the condition is true
+void add_index_bounds(CodeGenerator& code_generator, const Expression& condition) {
+    for (const auto& [object_variable, index_variable] : find_index_bounds(condition, code_generator.get_counting_variables())) {
+        code_generator.add_index_bound(object_variable, index_variable);
+    }
+}
@@ -0,0 +1,138 @@
+
+#define INLINE_INSTRUCTION_LIMIT 40
+#define INLINE_HOT_INSTRUCTION_LIMIT_FACTOR 4
+#define INLINE_HOT_CALL_COUNT 1000
+
+// Replaces calls to small non recursive functions with a copy of their body.
+//
+// A function body starts with its label followed by VWRITEs that pop the arguments from the
+// operand stack, so the copied body can consume the arguments exactly like the called function would.
+// The variables of the inlined body are moved behind the variables of the calling function and
+// every RET becomes a jump behind the inlined body, leaving the return value on the operand stack.
+//
+// With a profile, functions that were never called are not inlined and frequently called functions
+// may be larger than the instruction limit.
+class FunctionInliner : public OptimizationPass {
+private:
+    size_t instruction_limit;
+
+    bool is_inlinable(CodeGenerator& code_generator, const std::unordered_map<size_t, size_t>& function_indices, size_t caller_label, size_t callee_label) const {
+        const auto& functions = code_generator.get_functions();
+        if (callee_label == caller_label || callee_label == code_generator.get_main_label()) {
+            return false;
+        }
+
+        // Memoized functions have to be called to use their cache
+        size_t instruction_limit = this->instruction_limit;
+        const Profile *profile = code_generator.get_profile();
+        if (profile != nullptr && profile->has_function(callee_label)) {
+            uint64_t calls = profile->get_function_calls(callee_label);
+            if (calls == 0) {
+                return false;
+            }
+            if (calls >= INLINE_HOT_CALL_COUNT) {
+                instruction_limit *= INLINE_HOT_INSTRUCTION_LIMIT_FACTOR;
+            }
+        }
+
+        const auto& callee = functions[function_indices.at(callee_label)];
+        if (callee.is_memoized() || count_instructions(callee.get_instructions()) > instruction_limit) {
+            return false;
+        }
+
+        return !can_reach_function(functions, function_indices, callee_label, callee_label);
+    }
+
+    void append_inlined_body(CodeGenerator& code_generator, const FunctionCode& callee, size_t variable_offset, std::vector<Instruction>& output) const {
+        const auto& instructions = callee.get_instructions();
+        assert(instructions.size() > 0 && instructions[0].get_type() == InstructionType::LABEL);
+
+        std::unordered_map<int64_t, size_t> label_map;
+        for (size_t i = 1; i < instructions.size(); i++) {
+            if (instructions[i].get_type() == InstructionType::LABEL) {
+                label_map[instructions[i].get_operand().as_int] = code_generator.generate_label_copy((size_t) instructions[i].get_operand().as_int);
+            }
+        }
+        size_t end_label = code_generator.generate_label();
+
+        for (size_t i = 1; i < instructions.size(); i++) {
+            const Instruction& instruction = instructions[i];
+            InstructionType type = instruction.get_type();
+            int64_t operand = instruction.get_operand().as_int;
+
+            if (type == InstructionType::LABEL || is_branch_instruction(type)) {
+                output.push_back(Instruction(type, Word { .as_int = (int64_t) label_map.at(operand) }));
+            } else if (type == InstructionType::VLOAD || type == InstructionType::VWRITE) {
+                output.push_back(Instruction(type, Word { .as_int = operand + (int64_t) variable_offset }));
+            } else if (type == InstructionType::RET) {
+                if (i + 1 < instructions.size()) {
+                    output.push_back(Instruction(InstructionType::JUMP, Word { .as_int = (int64_t) end_label }));
+                }
+            } else {
+                assert(type != InstructionType::HALT);
+                output.push_back(instruction);
+            }
+        }
+
+        output.push_back(Instruction(InstructionType::LABEL, Word { .as_int = (int64_t) end_label }));
+    }
+
+    void inline_calls(CodeGenerator& code_generator, const std::unordered_map<size_t, size_t>& function_indices, size_t caller_index) const {
+        auto& functions = code_generator.get_functions();
+        FunctionCode& caller = functions[caller_index];
+        size_t variable_offset = caller.get_frame_size();
+
+        std::vector<Instruction> output;
+        bool changed = false;
+
+        for (const auto& instruction : caller.get_instructions()) {
+            if (instruction.get_type() == InstructionType::CALL) {
+                size_t callee_label = (size_t)instruction.get_operand().as_int;
+                if (this->is_inlinable(code_generator, function_indices, caller.get_label(), callee_label)) {
+                    this->append_inlined_body(code_generator, functions[function_indices.at(callee_label)], variable_offset, output);
+                    changed = true;
+                    continue;
+                }
+            }
+            output.push_back(instruction);
+        }
+
+        if (changed) {
+            remove_redundant_jumps(output);
+            caller.get_instructions() = std::move(output);
+        }
+    }
+
+public:
+    FunctionInliner(size_t instruction_limit = INLINE_INSTRUCTION_LIMIT)
+        : instruction_limit(instruction_limit)
+    {}
+
+    virtual const char *get_name() const override {
+        return "inline";
+    }
+
+    virtual void run(CodeGenerator& code_generator) override {
+        auto& functions = code_generator.get_functions();
+        auto function_indices = collect_function_indices(functions);
+
+        // Callees are processed before their callers, so calls inside of inlined bodies are already inlined
+        std::vector<bool> visited(functions.size(), false);
+        std::vector<size_t> order;
+        for (size_t i = 0; i < functions.size(); i++) {
+            if (!visited[i]) {
+                collect_post_order(functions, function_indices, i, visited, order);
+            }
+        }
+
+        for (size_t index : order) {
+            this->inline_calls(code_generator, function_indices, index);
+        }
+
+        if (code_generator.has_main_label()) {
+            remove_uncalled_functions(code_generator);
+        }
+    }
+
+    ~FunctionInliner() {}
+};
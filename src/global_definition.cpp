@@ -25,14 +25,15 @@ std::ostream& operator<<(std::ostream& output_stream, const GlobalDefinition& gl
 class ArgumentDefinition {
 private:
     Token name;
-    std::unique_ptr<TypeAnnotation> type;
+    size_t name_id;
+    TypeAnnotation *type;
     Location location;
 public:
-    ArgumentDefinition(const Token& name, std::unique_ptr<TypeAnnotation> type)
-        : name(name), type(std::move(type)), location(name.get_location())
+    ArgumentDefinition(const Token& name, TypeAnnotation *type)
+        : name(name), name_id(TypeChecker::get().get_name_id(name.get_text())), type(type), location(name.get_location())
     {}
     
-    const std::unique_ptr<TypeAnnotation>& get_type() const {
+    TypeAnnotation *get_type() const {
         return this->type;
     }
 
@@ -40,6 +41,10 @@ public:
         return this->name;
     }
 
+    size_t get_name_id() const {
+        return this->name_id;
+    }
+
     const Location& get_location() const {
         return this->location;
     }
@@ -54,18 +59,29 @@ std::ostream& operator<<(std::ostream& output_stream, const ArgumentDefinition&
 class FunctionDefinition : public GlobalDefinition {
 private:
     Token name;
-    std::vector<std::unique_ptr<ArgumentDefinition>> arguments;
-    std::unique_ptr<TypeAnnotation> return_type;
-    std::unique_ptr<Statement> body;
+    size_t name_id;
+    std::vector<ArgumentDefinition *> arguments;
+    TypeAnnotation *return_type;
+    Statement *body;
     size_t id;
+    size_t frame_size;
+    bool is_memoized;
 public:
-    FunctionDefinition(const Location& start_location, const Token& name, std::vector<std::unique_ptr<ArgumentDefinition>> arguments, std::unique_ptr<TypeAnnotation> return_type, std::unique_ptr<Statement> body)
-        : GlobalDefinition(start_location), name(name), arguments(std::move(arguments)), return_type(std::move(return_type)), body(std::move(body)), id(0)
+    FunctionDefinition(const Location& start_location, const Token& name, std::vector<ArgumentDefinition *> arguments, TypeAnnotation *return_type, Statement *body, bool is_memoized)
+        : GlobalDefinition(start_location),
+          name(name),
+          name_id(TypeChecker::get().get_name_id(name.get_text())),
+          arguments(std::move(arguments)),
+          return_type(return_type),
+          body(body),
+          id(0),
+          frame_size(0),
+          is_memoized(is_memoized)
     {}
 
     virtual void append_to_output_stream(std::ostream& output_stream, size_t layer = 0) const override {
         indent_layer(output_stream, layer);
-        output_stream << "FunctionDefinition(" << this->name.get_text() << ")" << std::endl;
+        output_stream << (this->is_memoized ? "@memo " : "") << "FunctionDefinition(" << this->name.get_text() << ")" << std::endl;
         for (auto& argument : this->arguments) {
             indent_layer(output_stream, layer + 1);
             output_stream << *argument << std::endl;
@@ -75,41 +91,75 @@ public:
         this->body->append_to_output_stream(output_stream, layer + 1);
     }
 
-    virtual void first_pass() override {
-        const std::string& function_name = this->name.get_text();
+    const Token& get_name() const {
+        return this->name;
+    }
 
-        if (TypeChecker::get().symbol_exists(function_name)) {
-            TYPE_ERROR("Symbol '" << function_name << "' already exists.");
-        }
+    size_t get_name_id() const {
+        return this->name_id;
+    }
 
-        auto parsed_return_type = this->return_type->to_type();
+    size_t get_id() const {
+        return this->id;
+    }
+
+    std::shared_ptr<Type> get_parsed_return_type() const {
+        return this->return_type->to_type();
+    }
+
+    std::vector<std::shared_ptr<Type>> get_parsed_argument_types() const {
         std::vector<std::shared_ptr<Type>> argument_types;
-        
         for (const auto& argument : this->arguments) {
-            auto argument_type = argument->get_type()->to_type();
-            argument_types.push_back(argument_type);
+            argument_types.push_back(argument->get_type()->to_type());
         }
-        
-        this->id = TypeChecker::get().add_function_symbol(function_name, parsed_return_type, std::move(argument_types));
+        return argument_types;
+    }
+
+    virtual void first_pass() override {
+        std::string_view function_name(this->name.get_text());
+
+        if (TypeChecker::get().symbol_exists(this->name_id)) {
+            TYPE_ERROR("Symbol '" << function_name << "' already exists.");
+        }
+
+        this->id = TypeChecker::get().add_function_symbol(this->name_id, this->get_parsed_return_type(), this->get_parsed_argument_types());
+    }
+
+    // Instances of generic functions are called through the symbol of the generic function
+    void first_pass_instance() {
+        this->id = TypeChecker::get().add_function_without_symbol();
     }
 
     virtual void type_check() override {
         // TODO: somehow save the result from the first pass
         auto parsed_return_type = this->return_type->to_type();
-        const std::string& function_name = this->name.get_text();
+        std::string_view function_name(this->name.get_text());
         TypeChecker::get().set_current_return_type(parsed_return_type);
 
+        // Cached results are only valid if they can not be told apart from freshly computed ones
+        if (this->is_memoized) {
+            if (parsed_return_type->fits(Type::VOID) || parsed_return_type->is_object()) {
+                TYPE_ERROR("Memoized function '" << function_name << "' must return a primitive value.");
+            }
+            for (const auto& argument : this->arguments) {
+                if (argument->get_type()->to_type()->is_object()) {
+                    TYPE_ERROR("Arguments of memoized function '" << function_name << "' must be primitive.");
+                }
+            }
+        }
+
         TypeChecker::get().push_scope();
+        TypeChecker::get().reset_max_variable_count();
 
         for (const auto& argument : this->arguments) {
             auto argument_type = argument->get_type()->to_type();
-            auto argument_name = argument->get_name().get_text();
+            std::string_view argument_name(argument->get_name().get_text());
 
-            if (TypeChecker::get().symbol_exists(argument_name)) {
+            if (TypeChecker::get().symbol_exists(argument->get_name_id())) {
                 TYPE_ERROR("Symbol '" << argument_name << "' already exists.");
             }
 
-            TypeChecker::get().add_variable_symbol(argument_name, argument_type);
+            TypeChecker::get().add_variable_symbol(argument->get_name_id(), argument_type);
         }
 
         this->body->type_check();
@@ -118,6 +168,11 @@ public:
             TYPE_ERROR("Function '" << function_name << "' does not definitely return a value.");
         }
 
+        for (const auto& list_literal : TypeChecker::get().take_generic_list_literals()) {
+            list_literal->check_element_type();
+        }
+
+        this->frame_size = TypeChecker::get().get_max_variable_count();
         TypeChecker::get().pop_scope();
     }
 
@@ -126,11 +181,33 @@ public:
         if (is_main) {
             code_generator.set_main_label(this->id);
         }
+        auto return_type = this->get_parsed_return_type();
+        bool has_return_value = !return_type->fits(Type::VOID);
+        bool has_primitive_signature = !has_return_value || !return_type->is_object();
+        for (const auto& argument_type : this->get_parsed_argument_types()) {
+            has_primitive_signature = has_primitive_signature && !argument_type->is_object();
+        }
+        code_generator.begin_function(std::string(this->name.get_text()), this->id, this->arguments.size(), has_return_value, has_primitive_signature, this->frame_size);
         INT_INST(LABEL, this->id);
         for (size_t i = 0; i < this->arguments.size(); i++) {
             size_t id = this->arguments.size() - (i+1);
             INT_INST(VWRITE, id);
         }
+
+        if (code_generator.is_optimization_enabled("range-analysis")) {
+            ValueRangeAnalysis range_analysis(this->arguments.size());
+            code_generator.set_non_negative_variables(range_analysis.find_non_negative_variables(*this->body));
+        } else {
+            code_generator.set_non_negative_variables({});
+        }
+
+        if (code_generator.is_optimization_enabled("bounds-check-elimination")) {
+            ValueRangeAnalysis range_analysis(this->arguments.size());
+            code_generator.set_counting_variables(range_analysis.find_counting_variables(*this->body));
+        } else {
+            code_generator.set_counting_variables({});
+        }
+
         this->body->emit(code_generator);
         // TODO: do this only if necessary
         if (is_main) {
@@ -138,7 +215,115 @@ public:
         } else {
             INST(RET);
         }
+
+        if (this->is_memoized) {
+            code_generator.get_functions().back().memoize();
+        }
     }
 
     ~FunctionDefinition() {}
 };
+
+#define GENERIC_INSTANCE_LIMIT 64
+
+// Generic function like 'fun swap<T>(xs: [T], i: int, j: int): void'.
+//
+// Generic functions are monomorphized: every call with new type arguments parses the definition again with the
+// type parameters bound to the concrete types. The instance is then type checked and emitted like any other
+// function, so e.g. the elements of '[char]' are accessed with byte instructions and those of '[int]' with word
+// instructions. Like the body of a template, the body is only type checked for the type arguments it is used with.
+class GenericFunctionDefinition : public GlobalDefinition {
+private:
+    FunctionDefinition *definition;
+    std::vector<Token> type_parameters;
+    std::function<FunctionDefinition *(const std::vector<std::shared_ptr<Type>>&)> parse_instance;
+    std::map<std::vector<std::string>, size_t> instance_ids;
+    std::vector<FunctionDefinition *> instances;
+
+    size_t instantiate(const std::vector<std::shared_ptr<Type>>& type_arguments) {
+        std::vector<std::string> key;
+        for (const auto& type_argument : type_arguments) {
+            key.push_back(type_argument->to_string());
+        }
+        if (this->instance_ids.contains(key)) {
+            return this->instance_ids.at(key);
+        }
+
+        // Calls with growing type arguments, like 'f<T>(x: T)' calling 'f([x])', would never stop instantiating
+        if (this->instances.size() >= GENERIC_INSTANCE_LIMIT) {
+            TYPE_ERROR("Generic function '" << this->definition->get_name().get_text() << "' has more than " << GENERIC_INSTANCE_LIMIT << " instances.");
+        }
+
+        auto instance = this->parse_instance(type_arguments);
+        instance->first_pass_instance();
+        size_t id = instance->get_id();
+
+        TypeChecker::get().defer_type_check([instance]() {
+            instance->type_check();
+        });
+
+        this->instance_ids[key] = id;
+        this->instances.push_back(instance);
+        return id;
+    }
+
+public:
+    GenericFunctionDefinition(
+            const Location& start_location,
+            FunctionDefinition *definition,
+            std::vector<Token> type_parameters,
+            std::function<FunctionDefinition *(const std::vector<std::shared_ptr<Type>>&)> parse_instance)
+        :
+            GlobalDefinition(start_location),
+            definition(definition),
+            type_parameters(std::move(type_parameters)),
+            parse_instance(std::move(parse_instance)),
+            instance_ids(),
+            instances()
+    {}
+
+    virtual void append_to_output_stream(std::ostream& output_stream, size_t layer = 0) const override {
+        indent_layer(output_stream, layer);
+        output_stream << "GenericFunctionDefinition<";
+        for (size_t i = 0; i < this->type_parameters.size(); i++) {
+            output_stream << (i > 0 ? ", " : "") << this->type_parameters[i].get_text();
+        }
+        output_stream << ">" << std::endl;
+        this->definition->append_to_output_stream(output_stream, layer + 1);
+    }
+
+    virtual void first_pass() override {
+        std::string_view function_name(this->definition->get_name().get_text());
+
+        if (TypeChecker::get().symbol_exists(this->definition->get_name_id())) {
+            TYPE_ERROR("Symbol '" << function_name << "' already exists.");
+        }
+        if (function_name == "main") {
+            TYPE_ERROR("Function 'main' can not be generic.");
+        }
+
+        std::vector<std::string> type_parameter_names;
+        for (const auto& type_parameter : this->type_parameters) {
+            type_parameter_names.emplace_back(type_parameter.get_text());
+        }
+
+        TypeChecker::get().add_generic_function_symbol(
+            this->definition->get_name_id(),
+            std::move(type_parameter_names),
+            this->definition->get_parsed_return_type(),
+            this->definition->get_parsed_argument_types(),
+            [this](const std::vector<std::shared_ptr<Type>>& type_arguments) { return this->instantiate(type_arguments); }
+        );
+    }
+
+    // Instances are type checked when they are created, see TypeChecker::run_type_checks
+    virtual void type_check() override {}
+
+    virtual void emit(CodeGenerator& code_generator) const override {
+        for (const auto& instance : this->instances) {
+            instance->emit(code_generator);
+        }
+    }
+
+    ~GenericFunctionDefinition() {}
+};
@@ -0,0 +1,118 @@
+
+#define UNROLL_TRIP_COUNT_PER_COPY 2.0
+#define UNROLL_MAX_FACTOR 4
+#define UNROLL_INSTRUCTION_LIMIT 64
+
+// Unrolls innermost loops that usually run many iterations according to a profile (see Profile), so the JUMP back
+// to the loop header is executed once for several iterations. A loop is copied 'factor' times if it runs at least
+// UNROLL_TRIP_COUNT_PER_COPY * factor iterations per entry. Without a profile the code is not changed.
+//
+// Copies of the condition and the body are inserted before the JUMP back, each copy still leaves the loop
+// through its own copy of the condition, so the number of iterations does not have to be known:
+//      LABEL head                      LABEL head
+//      <condition> JEQZ exit           <condition> JEQZ exit
+//      <body>                  ->      <body>
+//      JUMP head                       <condition copy> JEQZ exit
+//      LABEL exit                      <body copy>
+//                                      JUMP head
+//                                      LABEL exit
+// Loops rotated by BlockLayout do not jump back unconditionally anymore and are not unrolled.
+// At most UNROLL_INSTRUCTION_LIMIT instructions are added per loop.
+class LoopUnroller : public OptimizationPass {
+private:
+    // Checks whether the loop contains no other loop and can only be entered through its header
+    static bool is_innermost_loop(const std::vector<Instruction>& instructions, size_t header, size_t back_edge) {
+        auto label_positions = collect_label_positions(instructions);
+        for (size_t i = 0; i < instructions.size(); i++) {
+            if (!is_branch_instruction(instructions[i].get_type())) {
+                continue;
+            }
+            size_t target = label_positions.at(instructions[i].get_operand().as_int);
+            bool is_inside = i > header && i < back_edge;
+            bool targets_inside = target > header && target < back_edge;
+            if (is_inside && target < i && target != header) {
+                return false;
+            }
+            if (!is_inside && targets_inside) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool unroll_loop(CodeGenerator& code_generator, std::vector<Instruction>& instructions, size_t header, size_t back_edge) const {
+        const Profile *profile = code_generator.get_profile();
+        size_t loop_label = code_generator.get_label_origin((size_t) instructions[header].get_operand().as_int);
+        if (!profile->has_loop(loop_label) || !is_innermost_loop(instructions, header, back_edge)) {
+            return false;
+        }
+
+        double trip_count = profile->get_average_trip_count(loop_label);
+        std::vector<Instruction> body(instructions.begin() + header + 1, instructions.begin() + back_edge);
+        size_t body_size = count_instructions(body);
+        size_t factor = UNROLL_MAX_FACTOR;
+        while (factor > 1 && ((factor - 1) * body_size > UNROLL_INSTRUCTION_LIMIT || trip_count < UNROLL_TRIP_COUNT_PER_COPY * factor)) {
+            factor -= 1;
+        }
+        if (factor < 2) {
+            return false;
+        }
+
+        std::vector<Instruction> output(instructions.begin(), instructions.begin() + back_edge);
+        for (size_t copy = 1; copy < factor; copy++) {
+            std::unordered_map<int64_t, int64_t> label_map;
+            for (const auto& instruction : body) {
+                if (instruction.get_type() == InstructionType::LABEL) {
+                    int64_t label = instruction.get_operand().as_int;
+                    label_map[label] = (int64_t) code_generator.generate_label_copy((size_t) label);
+                }
+            }
+            for (Instruction instruction : body) {
+                InstructionType type = instruction.get_type();
+                auto mapped_label = label_map.find(instruction.get_operand().as_int);
+                if ((type == InstructionType::LABEL || is_branch_instruction(type)) && mapped_label != label_map.end()) {
+                    instruction.set_operand(Word { .as_int = mapped_label->second });
+                }
+                output.push_back(instruction);
+            }
+        }
+        output.insert(output.end(), instructions.begin() + back_edge, instructions.end());
+        instructions = std::move(output);
+        return true;
+    }
+
+public:
+    LoopUnroller() {}
+
+    virtual const char *get_name() const override {
+        return "unroll";
+    }
+
+    virtual void run(CodeGenerator& code_generator) override {
+        if (code_generator.get_profile() == nullptr) {
+            return;
+        }
+
+        for (auto& function : code_generator.get_functions()) {
+            auto& instructions = function.get_instructions();
+            std::unordered_set<int64_t> visited_loops;
+            bool changed = true;
+            while (changed) {
+                changed = false;
+                for (const auto& [header, back_edge] : find_loops(instructions)) {
+                    int64_t label = instructions[header].get_operand().as_int;
+                    if (visited_loops.contains(label)) {
+                        continue;
+                    }
+                    visited_loops.insert(label);
+                    if (this->unroll_loop(code_generator, instructions, header, back_edge)) {
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    ~LoopUnroller() {}
+};
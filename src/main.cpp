@@ -5,7 +5,29 @@
 #include <vector>
 #include <cassert>
 #include <unordered_map>
+#include <map>
+#include <set>
+#include <unordered_set>
+#include <functional>
 #include <cstring>
+#include <algorithm>
+#include <tuple>
+#include <chrono>
+#include <iomanip>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <string_view>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 void indent_layer(std::ostream& output_stream, size_t layer) {
     for (size_t i = 0; i < layer; i++) {
@@ -15,26 +37,63 @@ void indent_layer(std::ostream& output_stream, size_t layer) {
 
 
 #include "virtual_machine.cpp"
+#include "bytecode_file.cpp"
+#include "compilation_cache.cpp"
+#include "parallel_tasks.cpp"
+#include "source_scanner.cpp"
 #include "tokenizer.cpp"
 #include "type.cpp"
+#include "ast_arena.cpp"
 #include "type_annotation.cpp"
 #include "type_checker.cpp"
 #include "code_generator.cpp"
+#include "optimizer.cpp"
+#include "profile.cpp"
+#include "function_inliner.cpp"
+#include "memoizer.cpp"
+#include "constant_evaluator.cpp"
+#include "strength_reducer.cpp"
+#include "value_numbering.cpp"
+#include "dead_code_eliminator.cpp"
+#include "block_layout.cpp"
+#include "loop_unroller.cpp"
+#include "pass_manager.cpp"
+#include "c_translator.cpp"
+#include "assembly_emitter.cpp"
+#include "tiering_manager.cpp"
 #include "expression.cpp"
 #include "statement.cpp"
+#include "range_analysis.cpp"
 #include "global_definition.cpp"
 #include "parser.cpp"
 
-int main(int argc, const char **argv) {
-    if (argc < 2) {
-        std::cerr << "ERROR: Not enough arguments" << std::endl;
-        std::cerr << "USAGE: " << argv[0] << " [input.ni]" << std::endl;
-        std::exit(1);
+void print_usage(const char *program_name, const PassManager& pass_manager) {
+    std::cerr << "USAGE: " << program_name << " [options] [input.ni | input.nic]" << std::endl;
+    std::cerr << "OPTIONS:" << std::endl;
+    std::cerr << "    -O0, -O1, -O2              optimization level (default: -O" << DEFAULT_OPTIMIZATION_LEVEL << ")" << std::endl;
+    std::cerr << "    --enable-pass=<name>       enable a single optimization" << std::endl;
+    std::cerr << "    --disable-pass=<name>      disable a single optimization" << std::endl;
+    std::cerr << "    --pass-statistics          print the time and instruction counts of every pass" << std::endl;
+    std::cerr << "    --compile-only             write the compiled program instead of running it" << std::endl;
+    std::cerr << "    --emit-c                   translate the program to a C source file instead of running it" << std::endl;
+    std::cerr << "    --emit-asm                 translate the program to x86-64 assembly instead of running it" << std::endl;
+    std::cerr << "    -o <output>                path of the compiled program, the C source or the assembly file" << std::endl;
+    std::cerr << "                               (default: input path with .nic, .c or .s extension)" << std::endl;
+    std::cerr << "    --no-cache                 do not use the compilation cache" << std::endl;
+    std::cerr << "    --tiered                   start without optimizations and optimize hot functions while running" << std::endl;
+    std::cerr << "    --profile-out=<profile>    run the program and record how often its functions, branches and loops are executed" << std::endl;
+    std::cerr << "    --profile-in=<profile>     optimize the program for the recorded profile" << std::endl;
+    std::cerr << "OPTIMIZATIONS:" << std::endl;
+    for (const auto& name : pass_manager.get_names()) {
+        std::cerr << "    " << name << std::endl;
     }
+}
 
-    Tokenizer tokenizer(argv[1]);
-    auto tokens = tokenizer.collect_tokens();
-    Parser parser(std::move(tokens));
+// Runs the front end and the code generator on the source file, no optimization pass is run yet.
+// The profile (if there is one) has to outlive the code generator.
+std::unique_ptr<CodeGenerator> emit_code(const char *input_path, const PassManager& pass_manager, const Profile *profile) {
+    Tokenizer tokenizer(input_path);
+    Parser parser(tokenizer);
 
     auto global_definitions = parser.parse_file();
     
@@ -43,19 +102,277 @@ int main(int argc, const char **argv) {
         //std::cout << *global_definition;
     }
 
+    std::vector<std::function<void()>> type_checks;
     for (auto& global_definition : global_definitions) {
-        global_definition->type_check();
-        //std::cout << *global_definition;
+        type_checks.push_back([global_definition]() { global_definition->type_check(); });
     }
+    TypeChecker::get().run_type_checks(std::move(type_checks));
 
-    CodeGenerator code_generator(TypeChecker::get().get_function_count());
-    for (auto& global_definition : global_definitions) {
-        global_definition->emit(code_generator);
-        //std::cout << *global_definition;
+    // Once they are type checked the definitions are independent of each other, so every definition is emitted by
+    // its own code generator. The generators are appended in order of definition, which gives the same program no
+    // matter how the definitions were spread over the threads.
+    size_t function_count = TypeChecker::get().get_function_count();
+    std::vector<std::unique_ptr<CodeGenerator>> definition_code_generators(global_definitions.size());
+    ParallelTasks::get().run(global_definitions.size(), [&](size_t index) {
+        auto definition_code_generator = std::make_unique<CodeGenerator>(function_count);
+        pass_manager.configure(*definition_code_generator);
+        definition_code_generator->set_profile(profile);
+        global_definitions[index]->emit(*definition_code_generator);
+        definition_code_generators[index] = std::move(definition_code_generator);
+    });
+
+    auto code_generator = std::make_unique<CodeGenerator>(function_count);
+    pass_manager.configure(*code_generator);
+    code_generator->set_profile(profile);
+    for (auto& definition_code_generator : definition_code_generators) {
+        code_generator->append(*definition_code_generator);
+    }
+
+    // The syntax tree is not needed anymore once the code is emitted
+    AstArena::get().clear();
+    return code_generator;
+}
+
+// Runs the front end, the code generator and the optimization passes on the source file, the labels are not resolved yet
+std::unique_ptr<CodeGenerator> generate_code(const char *input_path, PassManager& pass_manager, const Profile *profile) {
+    auto code_generator = emit_code(input_path, pass_manager, profile);
+    pass_manager.run(*code_generator);
+    return code_generator;
+}
+
+std::pair<std::vector<Instruction>, std::vector<char>> compile(const char *input_path, PassManager& pass_manager, const Profile *profile) {
+    auto code_generator = generate_code(input_path, pass_manager, profile);
+    code_generator->finalize();
+    return { code_generator->get_program(), code_generator->get_static_data() };
+}
+
+// Replaces the .ni extension of the input path (if there is one) by the given extension
+std::string get_output_path(const char *input_path, const char *output_path, const std::string& extension) {
+    if (output_path != nullptr) {
+        return output_path;
+    }
+    std::string path = input_path;
+    if (path.ends_with(".ni")) {
+        path.resize(path.size() - 3);
+    }
+    return path + extension;
+}
+
+int main(int argc, const char **argv) {
+    PassManager pass_manager;
+    const char *input_path = nullptr;
+    const char *output_path = nullptr;
+    const char *profile_in_path = nullptr;
+    const char *profile_out_path = nullptr;
+    bool is_compile_only = false;
+    bool is_emit_c = false;
+    bool is_emit_assembly = false;
+    bool use_cache = true;
+    bool is_tiered = false;
+    int optimization_level = DEFAULT_OPTIMIZATION_LEVEL;
+    // Single optimizations override the optimization level, no matter where they are given
+    std::vector<std::pair<std::string, bool>> pass_overrides;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        std::string enable_prefix = "--enable-pass=";
+        std::string disable_prefix = "--disable-pass=";
+        std::string profile_in_prefix = "--profile-in=";
+        std::string profile_out_prefix = "--profile-out=";
+
+        if (argument.size() == 3 && argument.starts_with("-O") && argument[2] >= '0' && argument[2] <= '0' + MAX_OPTIMIZATION_LEVEL) {
+            optimization_level = argument[2] - '0';
+        } else if (argument.starts_with(enable_prefix)) {
+            pass_overrides.push_back({ argument.substr(enable_prefix.size()), true });
+        } else if (argument.starts_with(disable_prefix)) {
+            pass_overrides.push_back({ argument.substr(disable_prefix.size()), false });
+        } else if (argument.starts_with(profile_in_prefix)) {
+            profile_in_path = argv[i] + profile_in_prefix.size();
+        } else if (argument.starts_with(profile_out_prefix)) {
+            profile_out_path = argv[i] + profile_out_prefix.size();
+        } else if (argument == "--pass-statistics") {
+            // The passes do not run for cached programs
+            pass_manager.set_print_statistics(true);
+            use_cache = false;
+        } else if (argument == "--no-cache") {
+            use_cache = false;
+        } else if (argument == "--tiered") {
+            is_tiered = true;
+        } else if (argument == "--compile-only") {
+            is_compile_only = true;
+        } else if (argument == "--emit-c") {
+            is_emit_c = true;
+        } else if (argument == "--emit-asm") {
+            is_emit_assembly = true;
+        } else if (argument == "-o") {
+            if (i + 1 >= argc) {
+                std::cerr << "ERROR: Missing path after '-o'" << std::endl;
+                print_usage(argv[0], pass_manager);
+                std::exit(1);
+            }
+            i += 1;
+            output_path = argv[i];
+        } else if (argument.starts_with("-")) {
+            std::cerr << "ERROR: Unknown option '" << argument << "'" << std::endl;
+            print_usage(argv[0], pass_manager);
+            std::exit(1);
+        } else if (input_path == nullptr) {
+            input_path = argv[i];
+        } else {
+            std::cerr << "ERROR: Too many arguments" << std::endl;
+            print_usage(argv[0], pass_manager);
+            std::exit(1);
+        }
+    }
+
+    if (input_path == nullptr) {
+        std::cerr << "ERROR: Not enough arguments" << std::endl;
+        print_usage(argv[0], pass_manager);
+        std::exit(1);
+    }
+
+    bool is_translated = is_emit_c || is_emit_assembly;
+    if ((int) is_compile_only + (int) is_emit_c + (int) is_emit_assembly > 1) {
+        std::cerr << "ERROR: Only one of '--compile-only', '--emit-c' and '--emit-asm' can be used" << std::endl;
+        print_usage(argv[0], pass_manager);
+        std::exit(1);
+    }
+
+    if (output_path != nullptr && !is_compile_only && !is_translated) {
+        std::cerr << "ERROR: '-o' can only be used together with '--compile-only', '--emit-c' or '--emit-asm'" << std::endl;
+        print_usage(argv[0], pass_manager);
+        std::exit(1);
+    }
+
+    if (profile_out_path != nullptr && (is_compile_only || is_translated)) {
+        std::cerr << "ERROR: '--profile-out' runs the program and can not be used together with '--compile-only', '--emit-c' or '--emit-asm'" << std::endl;
+        print_usage(argv[0], pass_manager);
+        std::exit(1);
+    }
+
+    if (is_tiered && (is_compile_only || is_translated || profile_out_path != nullptr)) {
+        std::cerr << "ERROR: '--tiered' can not be used together with '--compile-only', '--emit-c', '--emit-asm' or '--profile-out'" << std::endl;
+        print_usage(argv[0], pass_manager);
+        std::exit(1);
+    }
+
+    // Precompiled programs are executed directly from the mapped file, they can not be profiled
+    if (profile_out_path != nullptr && is_bytecode_file(input_path)) {
+        std::cerr << "ERROR: '--profile-out' needs the source of the program" << std::endl;
+        std::exit(1);
+    }
+    if ((is_compile_only || is_translated) && is_bytecode_file(input_path)) {
+        const char *option = is_compile_only ? "--compile-only" : (is_emit_c ? "--emit-c" : "--emit-asm");
+        std::cerr << "ERROR: '" << option << "' needs the source of the program, '" << input_path << "' is already compiled" << std::endl;
+        std::exit(1);
+    }
+    if (!is_compile_only && !is_translated && is_bytecode_file(input_path)) {
+        BytecodeFile bytecode_file(input_path);
+        std::string error_message;
+        if (!bytecode_file.map(error_message)) {
+            BYTECODE_ERROR(input_path, error_message);
+        }
+        VirtualMachine virtual_machine(bytecode_file.get_instructions(), bytecode_file.get_instruction_count(), bytecode_file.get_static_data());
+        virtual_machine.execute();
+        return 0;
+    }
+
+    pass_manager.set_optimization_level(optimization_level);
+    for (const auto& [name, is_enabled] : pass_overrides) {
+        if (!pass_manager.set_enabled(name, is_enabled)) {
+            std::cerr << "ERROR: Unknown optimization '" << name << "'" << std::endl;
+            print_usage(argv[0], pass_manager);
+            std::exit(1);
+        }
+    }
+
+    // Profiles belong to the source and the enabled optimizations they were recorded with
+    std::string_view source = FileTable::get().get_source(FileTable::get().add_file(input_path));
+    uint64_t program_hash = Profile::get_program_hash(source, pass_manager.get_configuration());
+    Profile profile;
+    bool has_profile = profile_in_path != nullptr && profile.read(profile_in_path, program_hash);
+    const Profile *used_profile = has_profile ? &profile : nullptr;
+
+    // The profile is recorded for the instructions of the compiled program, so the program is always compiled
+    if (profile_out_path != nullptr) {
+        auto code_generator = generate_code(input_path, pass_manager, used_profile);
+        code_generator->finalize();
+
+        std::vector<uint64_t> execution_counts;
+        std::vector<uint64_t> taken_counts;
+        VirtualMachine virtual_machine(code_generator->get_program(), code_generator->get_static_data());
+        virtual_machine.execute_profiled(execution_counts, taken_counts);
+
+        if (!Profile::collect(*code_generator, execution_counts, taken_counts).write(profile_out_path, program_hash)) {
+            PROFILE_ERROR(profile_out_path, "Could not write file.");
+        }
+        return 0;
+    }
+
+    // The optimized program is never complete, so nothing is cached
+    if (is_tiered) {
+        auto code_generator = emit_code(input_path, pass_manager, used_profile);
+        TieringManager tiering_manager(pass_manager, *code_generator);
+        code_generator->finalize();
+        tiering_manager.execute(*code_generator);
+        return 0;
+    }
+
+    // The translated program is compiled by the system toolchain, so nothing is cached
+    if (is_translated) {
+        auto code_generator = generate_code(input_path, pass_manager, used_profile);
+        std::string translated_path = get_output_path(input_path, output_path, is_emit_c ? ".c" : ".s");
+        std::ofstream output_stream(translated_path);
+        if (is_emit_c) {
+            CTranslator(*code_generator).translate(output_stream);
+        } else {
+            AssemblyEmitter(*code_generator).emit(output_stream);
+        }
+        output_stream.close();
+        if (output_stream.fail()) {
+            std::cerr << translated_path << ": ERROR: Could not write file." << std::endl;
+            std::exit(1);
+        }
+        return 0;
+    }
+
+    // Compiled programs are cached by the content of the source, a missing or broken entry is compiled again
+    CompilationCache compilation_cache;
+    std::string cache_key;
+    std::string cache_entry_path;
+    if (use_cache && !is_compile_only && compilation_cache.get_is_available()) {
+        std::string configuration = pass_manager.get_configuration();
+        if (has_profile) {
+            configuration += std::string(1, '\0') + read_file_as_string(profile_in_path);
+        }
+        cache_key = CompilationCache::get_key(source, configuration);
+        cache_entry_path = compilation_cache.get_entry_path(cache_key);
+
+        BytecodeFile cached_file(cache_entry_path);
+        std::string error_message;
+        if (cached_file.map(error_message, &cache_key)) {
+            compilation_cache.mark_used(cache_entry_path);
+            VirtualMachine virtual_machine(cached_file.get_instructions(), cached_file.get_instruction_count(), cached_file.get_static_data());
+            virtual_machine.execute();
+            return 0;
+        }
+    }
+
+    auto [program, static_data] = compile(input_path, pass_manager, used_profile);
+
+    if (is_compile_only) {
+        std::string bytecode_path = get_output_path(input_path, output_path, ".nic");
+        if (!write_bytecode_file(bytecode_path, program, static_data)) {
+            BYTECODE_ERROR(bytecode_path, "Could not write file.");
+        }
+        return 0;
+    }
+
+    if (cache_entry_path.size() > 0) {
+        compilation_cache.store(cache_entry_path, cache_key, program, static_data);
     }
-    code_generator.finalize();
 
-    VirtualMachine virtual_machine(std::move(code_generator.get_program()), std::move(code_generator.get_static_data()));
+    VirtualMachine virtual_machine(std::move(program), std::move(static_data));
     virtual_machine.execute();
 
     return 0;
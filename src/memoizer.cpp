@@ -0,0 +1,35 @@
+
+// Memoizes pure functions that call themselves more than once, like the naive recursive fibonacci.
+// Such functions usually compute the same results over and over again, which the cache of the virtual
+// machine avoids (see FunctionCode::memoize). Like with '@memo', only functions that return a primitive value
+// and take primitive arguments can be memoized.
+class Memoizer : public OptimizationPass {
+public:
+    Memoizer() {}
+
+    virtual const char *get_name() const override {
+        return "memoize";
+    }
+
+    virtual void run(CodeGenerator& code_generator) override {
+        auto pure_functions = find_pure_functions(code_generator);
+        for (auto& function : code_generator.get_functions()) {
+            if (function.is_memoized() || !function.is_memoizable() || !pure_functions.contains(function.get_label())) {
+                continue;
+            }
+
+            size_t recursive_call_count = 0;
+            for (const auto& instruction : function.get_instructions()) {
+                if (instruction.get_type() == InstructionType::CALL && (size_t) instruction.get_operand().as_int == function.get_label()) {
+                    recursive_call_count += 1;
+                }
+            }
+
+            if (recursive_call_count > 1) {
+                function.memoize();
+            }
+        }
+    }
+
+    ~Memoizer() {}
+};
@@ -0,0 +1,427 @@
+
+// Optimization passes work on the instructions of the individual functions
+// after code generation and before the labels are resolved by CodeGenerator::finalize.
+class OptimizationPass {
+public:
+    virtual const char *get_name() const = 0;
+    virtual void run(CodeGenerator& code_generator) = 0;
+
+    virtual ~OptimizationPass() {}
+};
+
+// Maps the label of every function to its index in the function list of the code generator
+std::unordered_map<size_t, size_t> collect_function_indices(const std::vector<FunctionCode>& functions) {
+    std::unordered_map<size_t, size_t> function_indices;
+    for (size_t i = 0; i < functions.size(); i++) {
+        function_indices[functions[i].get_label()] = i;
+    }
+    return function_indices;
+}
+
+// Labels of all (non native) functions that are called by the given function
+std::vector<size_t> collect_called_functions(const FunctionCode& function) {
+    std::vector<size_t> called_functions;
+    for (const auto& instruction : function.get_instructions()) {
+        if (instruction.get_type() == InstructionType::CALL) {
+            size_t label = (size_t)instruction.get_operand().as_int;
+            if (std::find(called_functions.begin(), called_functions.end(), label) == called_functions.end()) {
+                called_functions.push_back(label);
+            }
+        }
+    }
+    return called_functions;
+}
+
+// Checks whether the function with the label 'from' can (transitively) call the function with the label 'to'
+bool can_reach_function(const std::vector<FunctionCode>& functions, const std::unordered_map<size_t, size_t>& function_indices, size_t from, size_t to) {
+    std::vector<size_t> work_list { from };
+    std::unordered_map<size_t, bool> visited;
+
+    while (work_list.size() > 0) {
+        size_t label = work_list.back();
+        work_list.pop_back();
+
+        for (size_t called : collect_called_functions(functions[function_indices.at(label)])) {
+            if (called == to) {
+                return true;
+            }
+            if (!visited[called]) {
+                visited[called] = true;
+                work_list.push_back(called);
+            }
+        }
+    }
+
+    return false;
+}
+
+// Collects the functions that can be reached from the function at 'index', callees are ordered before their callers
+void collect_post_order(const std::vector<FunctionCode>& functions, const std::unordered_map<size_t, size_t>& function_indices, size_t index, std::vector<bool>& visited, std::vector<size_t>& order) {
+    visited[index] = true;
+    for (size_t called : collect_called_functions(functions[index])) {
+        size_t called_index = function_indices.at(called);
+        if (!visited[called_index]) {
+            collect_post_order(functions, function_indices, called_index, visited, order);
+        }
+    }
+    order.push_back(index);
+}
+
+// Removes the functions that are not (transitively) called by the main function
+void remove_uncalled_functions(CodeGenerator& code_generator) {
+    if (code_generator.get_keeps_uncalled_functions()) {
+        return;
+    }
+    auto& functions = code_generator.get_functions();
+    auto function_indices = collect_function_indices(functions);
+    size_t main_label = code_generator.get_main_label();
+
+    std::vector<bool> visited(functions.size(), false);
+    std::vector<size_t> order;
+    collect_post_order(functions, function_indices, function_indices.at(main_label), visited, order);
+
+    std::vector<FunctionCode> called_functions;
+    for (size_t i = 0; i < functions.size(); i++) {
+        if (visited[i]) {
+            called_functions.push_back(std::move(functions[i]));
+        }
+    }
+    functions = std::move(called_functions);
+}
+
+// Checks whether the instruction at 'index' neither touches memory nor can trap
+bool is_pure_instruction(const std::vector<Instruction>& instructions, size_t index) {
+    switch (instructions[index].get_type()) {
+        case InstructionType::NATIVE:
+        case InstructionType::HALLOC:
+        case InstructionType::SPTR:
+        case InstructionType::READW:
+        case InstructionType::WRITEW:
+        case InstructionType::READB:
+        case InstructionType::WRITEB:
+        case InstructionType::ELOADW:
+        case InstructionType::ESTOREW:
+        case InstructionType::ELOADB:
+        case InstructionType::ESTOREB:
+        case InstructionType::PADD:
+        case InstructionType::HALT:
+            return false;
+
+        // Divisions trap if the divisor is zero (or -1 for the smallest integer)
+        case InstructionType::IDIV:
+        case InstructionType::IMOD:
+            {
+                if (index == 0 || instructions[index-1].get_type() != InstructionType::PUSH) {
+                    return false;
+                }
+                int64_t divisor = instructions[index-1].get_operand().as_int;
+                return divisor != 0 && divisor != -1;
+            }
+
+        default:
+            return true;
+    }
+}
+
+// Labels of the pure functions: functions that only compute with their arguments. They do not touch memory,
+// do not call natives and only call pure functions, so calls with equal arguments have equal results.
+std::unordered_set<size_t> find_pure_functions(CodeGenerator& code_generator) {
+    const auto& functions = code_generator.get_functions();
+    std::unordered_set<size_t> pure_functions;
+    for (const auto& function : functions) {
+        const auto& instructions = function.get_instructions();
+        bool is_pure = function.get_label() != code_generator.get_main_label();
+        for (size_t i = 0; i < instructions.size() && is_pure; i++) {
+            is_pure = is_pure_instruction(instructions, i);
+        }
+        if (is_pure) {
+            pure_functions.insert(function.get_label());
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto& function : functions) {
+            if (!pure_functions.contains(function.get_label())) {
+                continue;
+            }
+            for (size_t called : collect_called_functions(function)) {
+                if (!pure_functions.contains(called)) {
+                    pure_functions.erase(function.get_label());
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    return pure_functions;
+}
+
+// Removes jumps to a label that directly follows the jump
+void remove_redundant_jumps(std::vector<Instruction>& instructions) {
+    std::vector<Instruction> output;
+    output.reserve(instructions.size());
+    for (size_t i = 0; i < instructions.size(); i++) {
+        const Instruction& instruction = instructions[i];
+        if (instruction.get_type() == InstructionType::JUMP && i + 1 < instructions.size()) {
+            const Instruction& next = instructions[i+1];
+            if (next.get_type() == InstructionType::LABEL && next.get_operand().as_int == instruction.get_operand().as_int) {
+                continue;
+            }
+        }
+        output.push_back(instruction);
+    }
+    instructions = std::move(output);
+}
+
+// Maps every label of the instructions to the index of its LABEL instruction
+std::unordered_map<int64_t, size_t> collect_label_positions(const std::vector<Instruction>& instructions) {
+    std::unordered_map<int64_t, size_t> label_positions;
+    for (size_t i = 0; i < instructions.size(); i++) {
+        if (instructions[i].get_type() == InstructionType::LABEL) {
+            label_positions[instructions[i].get_operand().as_int] = i;
+        }
+    }
+    return label_positions;
+}
+
+// Loops as pairs of the index of the loop header label and the index of the JUMP back to it.
+// A loop is closed by its last backward JUMP, earlier ones are continue statements.
+std::vector<std::pair<size_t, size_t>> find_loops(const std::vector<Instruction>& instructions) {
+    auto label_positions = collect_label_positions(instructions);
+    std::unordered_map<size_t, size_t> back_edges;
+    for (size_t i = 0; i < instructions.size(); i++) {
+        if (instructions[i].get_type() == InstructionType::JUMP) {
+            size_t header = label_positions.at(instructions[i].get_operand().as_int);
+            if (header < i) {
+                back_edges[header] = i;
+            }
+        }
+    }
+
+    std::vector<std::pair<size_t, size_t>> loops(back_edges.begin(), back_edges.end());
+    std::sort(loops.begin(), loops.end());
+    return loops;
+}
+
+size_t count_instructions(const std::vector<Instruction>& instructions) {
+    size_t count = 0;
+    for (const auto& instruction : instructions) {
+        if (instruction.get_type() != InstructionType::LABEL) {
+            count += 1;
+        }
+    }
+    return count;
+}
+
+// Instructions [begin, end) of a function that are only entered at 'begin' and only left at the last instruction
+class BasicBlock {
+private:
+    size_t begin;
+    size_t end;
+    std::vector<size_t> successors;
+public:
+    BasicBlock(size_t begin, size_t end)
+        : begin(begin), end(end), successors()
+    {}
+
+    size_t get_begin() const {
+        return this->begin;
+    }
+
+    size_t get_end() const {
+        return this->end;
+    }
+
+    const std::vector<size_t>& get_successors() const {
+        return this->successors;
+    }
+
+    void add_successor(size_t successor) {
+        this->successors.push_back(successor);
+    }
+
+    ~BasicBlock() {}
+};
+
+bool ends_basic_block(InstructionType type) {
+    return is_branch_instruction(type) || type == InstructionType::RET || type == InstructionType::HALT;
+}
+
+// Splits the instructions of a function into basic blocks, the first block is the entry of the function
+std::vector<BasicBlock> build_basic_blocks(const std::vector<Instruction>& instructions) {
+    std::vector<BasicBlock> blocks;
+    std::unordered_map<int64_t, size_t> label_blocks;
+
+    size_t begin = 0;
+    for (size_t i = 0; i < instructions.size(); i++) {
+        InstructionType type = instructions[i].get_type();
+        if (type == InstructionType::LABEL && i > begin) {
+            blocks.push_back(BasicBlock(begin, i));
+            begin = i;
+        }
+        if (type == InstructionType::LABEL) {
+            label_blocks[instructions[i].get_operand().as_int] = blocks.size();
+        }
+        if (ends_basic_block(type)) {
+            blocks.push_back(BasicBlock(begin, i + 1));
+            begin = i + 1;
+        }
+    }
+    if (begin < instructions.size()) {
+        blocks.push_back(BasicBlock(begin, instructions.size()));
+    }
+
+    for (size_t i = 0; i < blocks.size(); i++) {
+        const Instruction& last = instructions[blocks[i].get_end() - 1];
+        InstructionType type = last.get_type();
+        if (is_branch_instruction(type)) {
+            blocks[i].add_successor(label_blocks.at(last.get_operand().as_int));
+        }
+        bool falls_through = type != InstructionType::JUMP && type != InstructionType::RET && type != InstructionType::HALT;
+        if (falls_through && i + 1 < blocks.size()) {
+            blocks[i].add_successor(i + 1);
+        }
+    }
+
+    return blocks;
+}
+
+// Number of values popped from and pushed on the operand stack by the instruction
+std::pair<int64_t, int64_t> get_operand_stack_effect(const std::vector<FunctionCode>& functions, const std::unordered_map<size_t, size_t>& function_indices, const Instruction& instruction) {
+    switch (instruction.get_type()) {
+        case InstructionType::PUSH:
+        case InstructionType::SPTR:
+        case InstructionType::VLOAD:
+            return { 0, 1 };
+        case InstructionType::DUP:
+            return { 1, 2 };
+        case InstructionType::POP:
+        case InstructionType::VWRITE:
+        case InstructionType::JEQZ:
+            return { 1, 0 };
+        case InstructionType::HALLOC:
+        case InstructionType::READW:
+        case InstructionType::READB:
+        case InstructionType::IBNEG:
+        case InstructionType::FNEG:
+        case InstructionType::INEG:
+        case InstructionType::LNEG:
+        case InstructionType::I2C:
+        case InstructionType::I2F:
+        case InstructionType::F2I:
+            return { 1, 1 };
+        case InstructionType::PADD:
+        case InstructionType::ELOADW:
+        case InstructionType::ELOADB:
+        case InstructionType::IADD:
+        case InstructionType::ISUB:
+        case InstructionType::IMUL:
+        case InstructionType::IDIV:
+        case InstructionType::IMOD:
+        case InstructionType::ISHL:
+        case InstructionType::ISHR:
+        case InstructionType::IAND:
+        case InstructionType::IOR:
+        case InstructionType::IXOR:
+        case InstructionType::FADD:
+        case InstructionType::FSUB:
+        case InstructionType::FMUL:
+        case InstructionType::FDIV:
+            return { 2, 1 };
+        case InstructionType::WRITEW:
+        case InstructionType::WRITEB:
+        case InstructionType::JNEQ:
+        case InstructionType::JEQ:
+        case InstructionType::JILT:
+        case InstructionType::JILE:
+        case InstructionType::JIGT:
+        case InstructionType::JIGE:
+        case InstructionType::JFLT:
+        case InstructionType::JFLE:
+        case InstructionType::JFGT:
+        case InstructionType::JFGE:
+            return { 2, 0 };
+        case InstructionType::ESTOREW:
+        case InstructionType::ESTOREB:
+            return { 3, 1 };
+        case InstructionType::CALL:
+            {
+                const FunctionCode& callee = functions[function_indices.at((size_t) instruction.get_operand().as_int)];
+                return { (int64_t) callee.get_argument_count(), callee.get_has_return_value() ? 1 : 0 };
+            }
+        case InstructionType::NATIVE:
+            {
+                int64_t native_id = instruction.get_operand().as_int;
+                return { 1, native_id == NATIVE_PRINT || native_id == NATIVE_PRINTLN ? 0 : 1 };
+            }
+        case InstructionType::RET:
+        case InstructionType::HALT:
+        case InstructionType::LABEL:
+        case InstructionType::JUMP:
+        case InstructionType::MENTER:
+        case InstructionType::MSTORE:
+            return { 0, 0 };
+    }
+    assert(false && "unreachable");
+    return { 0, 0 };
+}
+
+// Depth of the operand stack before every instruction of the function, -1 for unreachable instructions.
+// The depth only depends on the instruction and not on the path that reached it.
+std::vector<int64_t> compute_operand_stack_depths(const std::vector<FunctionCode>& functions, const std::unordered_map<size_t, size_t>& function_indices, const FunctionCode& function) {
+    const auto& instructions = function.get_instructions();
+    auto label_positions = collect_label_positions(instructions);
+
+    std::vector<int64_t> depths(instructions.size(), -1);
+    std::vector<size_t> worklist;
+
+    auto visit = [&](size_t index, int64_t depth) {
+        if (index >= instructions.size()) {
+            return;
+        }
+        if (depths[index] < 0) {
+            depths[index] = depth;
+            worklist.push_back(index);
+        }
+        assert(depths[index] == depth && "operand stack depth differs between paths");
+    };
+
+    visit(0, (int64_t) function.get_argument_count());
+    while (worklist.size() > 0) {
+        size_t index = worklist.back();
+        worklist.pop_back();
+
+        const Instruction& instruction = instructions[index];
+        auto [pop_count, push_count] = get_operand_stack_effect(functions, function_indices, instruction);
+        assert(depths[index] >= pop_count);
+        int64_t depth = depths[index] - pop_count + push_count;
+
+        InstructionType type = instruction.get_type();
+        if (type == InstructionType::RET || type == InstructionType::HALT) {
+            continue;
+        }
+        if (is_branch_instruction(type)) {
+            visit(label_positions.at(instruction.get_operand().as_int), depth);
+        }
+        if (type != InstructionType::JUMP) {
+            visit(index + 1, depth);
+        }
+    }
+    return depths;
+}
+
+// Number of operand stack slots used by the function, depths are the ones computed by compute_operand_stack_depths
+int64_t get_max_operand_stack_depth(const std::vector<FunctionCode>& functions, const std::unordered_map<size_t, size_t>& function_indices, const FunctionCode& function, const std::vector<int64_t>& depths) {
+    const auto& instructions = function.get_instructions();
+    int64_t max_depth = (int64_t) function.get_argument_count();
+    for (size_t i = 0; i < instructions.size(); i++) {
+        if (depths[i] >= 0) {
+            auto [pop_count, push_count] = get_operand_stack_effect(functions, function_indices, instructions[i]);
+            max_depth = std::max(max_depth, depths[i] - pop_count + push_count);
+        }
+    }
+    return max_depth;
+}
@@ -0,0 +1,90 @@
+
+#define NO_TASK SIZE_MAX
+
+// Runs independent tasks, like the type checks or the code generation of the functions of a program, on up to one
+// thread per core.
+//
+// Tasks are started in order of their index. An error in a task is only reported once all tasks before it have
+// finished, so the reported error is the first one of the program, just as if the tasks had run one after the other.
+// Code that reports an error calls begin_error before printing it and exit_after_error afterwards.
+class ParallelTasks {
+private:
+    static ParallelTasks instance;
+    static thread_local size_t current_task;
+
+    std::mutex mutex;
+    std::condition_variable task_finished;
+    std::vector<bool> finished_tasks;
+    // All tasks before this index have finished
+    size_t finished_prefix;
+
+    ParallelTasks() : mutex(), task_finished(), finished_tasks(), finished_prefix(0) {}
+
+    void finish_task(size_t index) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->finished_tasks[index] = true;
+        while (this->finished_prefix < this->finished_tasks.size() && this->finished_tasks[this->finished_prefix]) {
+            this->finished_prefix += 1;
+        }
+        this->task_finished.notify_all();
+    }
+
+public:
+    ParallelTasks(ParallelTasks& other) = delete;
+
+    static ParallelTasks& get() {
+        return instance;
+    }
+
+    // Calls 'body' for every index in [0, count)
+    void run(size_t count, const std::function<void(size_t)>& body) {
+        this->finished_tasks.assign(count, false);
+        this->finished_prefix = 0;
+
+        size_t thread_count = std::min((size_t) std::max(std::thread::hardware_concurrency(), 1u), count);
+        std::atomic<size_t> next_index(0);
+        auto work = [&]() {
+            for (size_t index = next_index++; index < count; index = next_index++) {
+                current_task = index;
+                body(index);
+                this->finish_task(index);
+            }
+            current_task = NO_TASK;
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < thread_count; i++) {
+            threads.emplace_back(work);
+        }
+        work();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Waits until every task before the current one has finished, since they might report an earlier error. The
+    // mutex stays locked until the program exits, which stops all other tasks from reporting their errors.
+    void begin_error() {
+        if (current_task == NO_TASK) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->task_finished.wait(lock, [this]() { return this->finished_prefix >= current_task; });
+        lock.release();
+    }
+
+    [[noreturn]] void exit_after_error() {
+        if (current_task == NO_TASK) {
+            std::exit(1);
+        }
+        // The other threads are still running, so the destructors of static objects must not run
+        std::cout.flush();
+        std::cerr.flush();
+        std::_Exit(1);
+    }
+
+    ~ParallelTasks() {}
+};
+
+ParallelTasks ParallelTasks::instance;
+thread_local size_t ParallelTasks::current_task = NO_TASK;
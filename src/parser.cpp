@@ -7,20 +7,18 @@
 
 class Parser {
 private:
-    std::vector<Token> tokens;
-    size_t token_pointer;
+    Tokenizer& tokenizer;
+    // Type arguments of the type parameters of the generic function that is currently parsed
+    std::unordered_map<std::string, std::shared_ptr<Type>> type_arguments;
     
-    Token get_current_token() const {
-        assert(tokens.size() > 0);
-        if (this->token_pointer >= this->tokens.size()) {
-            return this->tokens[this->tokens.size() - 1];
-        }
-        return this->tokens[this->token_pointer];
+    // Valid until the next token is consumed
+    const Token& get_current_token() {
+        return this->tokenizer.peek_token();
     }
 
     Token consume_token() {
         Token output_token = this->get_current_token();
-        this->token_pointer += 1;
+        this->tokenizer.advance_token();
         return output_token;
     }
     
@@ -74,74 +72,139 @@ private:
     }
 
 public:
-    Parser(std::vector<Token> tokens)
-        : tokens(std::move(tokens)), token_pointer(0)
+    Parser(Tokenizer& tokenizer)
+        : tokenizer(tokenizer), type_arguments()
     {}
 
 
-    std::unique_ptr<Expression> parse_expression() {
+    Expression *parse_expression() {
         return this->parse_binary_expression();
     }
 
-    std::vector<std::unique_ptr<GlobalDefinition>> parse_file() {
-        std::vector<std::unique_ptr<GlobalDefinition>> global_definitions;
+    std::vector<GlobalDefinition *> parse_file() {
+        std::vector<GlobalDefinition *> global_definitions;
         while (this->get_current_token().get_type() != TokenType::END_OF_FILE) {
             global_definitions.push_back(this->parse_global_definition());
         }
         return std::move(global_definitions);
     }
 
-    std::unique_ptr<GlobalDefinition> parse_global_definition() {
+    // Parses a function definition starting at the 'fun' keyword, memoized functions are annotated with '@memo'
+    GlobalDefinition *parse_function_definition(const Location& start_location, bool is_memoized) {
+        Location function_location = this->get_current_token().get_location();
+        std::vector<Token> type_parameters;
+        auto function_definition = this->parse_function(start_location, is_memoized, {}, type_parameters);
+        if (type_parameters.size() == 0) {
+            return function_definition;
+        }
+
+        // Every instance of a generic function is parsed again from the source, starting at the 'fun' keyword
+        auto parse_instance = [start_location, is_memoized, function_location](const std::vector<std::shared_ptr<Type>>& type_arguments) {
+            Tokenizer tokenizer(function_location.get_file_id(), function_location.get_offset());
+            Parser parser(tokenizer);
+            std::vector<Token> type_parameters;
+            return parser.parse_function(start_location, is_memoized, type_arguments, type_parameters);
+        };
+        return AstArena::get().create<GenericFunctionDefinition>(start_location, function_definition, std::move(type_parameters), parse_instance);
+    }
+
+    // Parses the function starting at the 'fun' keyword, its type parameters are bound to the given type arguments
+    // or to TypeParameterTypes if there are none
+    FunctionDefinition *parse_function(const Location& start_location, bool is_memoized, const std::vector<std::shared_ptr<Type>>& type_arguments, std::vector<Token>& type_parameters) {
+        (void) this->expect_token(TokenType::FUN_KEYWORD);
+        Token name = this->expect_token(TokenType::NAME);
+
+        if (this->get_current_token().get_type() == TokenType::LESS) {
+            (void) this->consume_token();
+            for (;;) {
+                Token type_parameter = this->expect_token(TokenType::NAME);
+                for (const auto& other_type_parameter : type_parameters) {
+                    if (other_type_parameter.get_text() == type_parameter.get_text()) {
+                        PARSE_ERROR(type_parameter.get_location(), "Duplicate type parameter '" << type_parameter.get_text() << "'.");
+                    }
+                }
+
+                // The signature of the generic function itself uses the type parameters as types
+                size_t index = type_parameters.size();
+                if (type_arguments.size() > 0) {
+                    this->type_arguments[std::string(type_parameter.get_text())] = type_arguments[index];
+                } else {
+                    this->type_arguments[std::string(type_parameter.get_text())] = TypeParameterType::get(std::string(type_parameter.get_text()), index);
+                }
+                type_parameters.push_back(type_parameter);
+
+                if (this->get_current_token().get_type() == TokenType::COMMA) {
+                    (void) this->consume_token();
+                } else {
+                    break;
+                }
+            }
+            (void) this->expect_token(TokenType::GREATER);
+        }
+
+        (void) this->expect_token(TokenType::OPEN_PARENTHESIS);
+        std::vector<ArgumentDefinition *> arguments;
+        if (this->get_current_token().get_type() != TokenType::CLOSE_PARENTHESIS) {
+            for (;;) {
+                Token argument_name = this->expect_token(TokenType::NAME);
+                (void) this->expect_token(TokenType::COLON);
+                auto argument_type = this->parse_type_annotation();
+                auto argument_definition = AstArena::get().create<ArgumentDefinition>(argument_name, argument_type);
+                arguments.push_back(argument_definition);
+                if (this->get_current_token().get_type() == TokenType::COMMA) {
+                    (void) this->consume_token();
+                } else {
+                    break;
+                }
+            }
+        }
+        (void) this->expect_token(TokenType::CLOSE_PARENTHESIS);
+        (void) this->expect_token(TokenType::COLON);
+        auto return_type = this->parse_type_annotation();
+        Token statement_start_token = this->get_current_token();
+        if (statement_start_token.get_type() != TokenType::OPEN_CURLY_BRACE) {
+            PARSE_ERROR(statement_start_token.get_location(), "Expected block statement as function body.");
+        }
+        auto body = this->parse_statement();
+        this->type_arguments.clear();
+        return AstArena::get().create<FunctionDefinition>(start_location, name, std::move(arguments), return_type, body, is_memoized);
+    }
+
+    GlobalDefinition *parse_global_definition() {
         Token next_token = this->get_current_token();
         switch(next_token.get_type()) {
             case TokenType::FUN_KEYWORD:
+                return this->parse_function_definition(next_token.get_location(), false);
+            case TokenType::AT:
                 {
-                    Token fun_token = this->consume_token();
-                    Token name = this->expect_token(TokenType::NAME);
-                    (void) this->expect_token(TokenType::OPEN_PARENTHESIS);
-                    std::vector<std::unique_ptr<ArgumentDefinition>> arguments;
-                    if (this->get_current_token().get_type() != TokenType::CLOSE_PARENTHESIS) {
-                        for (;;) {
-                            Token argument_name = this->expect_token(TokenType::NAME);
-                            (void) this->expect_token(TokenType::COLON);
-                            auto argument_type = this->parse_type_annotation();
-                            auto argument_definition = std::make_unique<ArgumentDefinition>(argument_name, std::move(argument_type));
-                            arguments.push_back(std::move(argument_definition));
-                            if (this->get_current_token().get_type() == TokenType::COMMA) {
-                                (void) this->consume_token();
-                            } else {
-                                break;
-                            }
-                        }
-                    }
-                    (void) this->expect_token(TokenType::CLOSE_PARENTHESIS);
-                    (void) this->expect_token(TokenType::COLON);
-                    auto return_type = this->parse_type_annotation();
-                    Token statement_start_token = this->get_current_token();
-                    if (statement_start_token.get_type() != TokenType::OPEN_CURLY_BRACE) {
-                        PARSE_ERROR(statement_start_token.get_location(), "Expected block statement as function body.");
+                    Token at_token = this->consume_token();
+                    Token annotation = this->expect_token(TokenType::NAME);
+                    if (annotation.get_text() != "memo") {
+                        PARSE_ERROR(annotation.get_location(), "Unknown annotation '" << annotation.get_text() << "'.");
                     }
-                    auto body = this->parse_statement();
-                    return std::make_unique<FunctionDefinition>(fun_token.get_location(), name, std::move(arguments), std::move(return_type), std::move(body));
+                    return this->parse_function_definition(at_token.get_location(), true);
                 }
             default:
                 PARSE_ERROR(next_token.get_location(), "Unexpected token of type <" << next_token.get_type() << "> at the beginning of global definition.");
         }
     }
 
-    std::unique_ptr<TypeAnnotation> parse_type_annotation() {
+    TypeAnnotation *parse_type_annotation() {
         if (this->get_current_token().get_type() == TokenType::OPEN_SQUARE_BRACKET) {
             Token open_square_bracket_token = this->consume_token();
             auto inner_type = this->parse_type_annotation();
             (void) this->expect_token(TokenType::CLOSE_SQUARE_BRACKET);
-            return std::make_unique<ListTypeAnnotation>(open_square_bracket_token.get_location(), std::move(inner_type));
+            return AstArena::get().create<ListTypeAnnotation>(open_square_bracket_token.get_location(), inner_type);
+        } else if (this->type_arguments.contains(std::string(this->get_current_token().get_text()))) {
+            Token type_parameter_token = this->consume_token();
+            return AstArena::get().create<TypeParameterAnnotation>(type_parameter_token, this->type_arguments.at(std::string(type_parameter_token.get_text())));
         } else {
             Token primitive_type_token = this->consume_token();
-            return std::make_unique<PrimitiveTypeAnnotation>(primitive_type_token);
+            return AstArena::get().create<PrimitiveTypeAnnotation>(primitive_type_token);
         }
     }
 
-    std::unique_ptr<Statement> parse_statement() {
+    Statement *parse_statement() {
         switch (this->get_current_token().get_type()) {
             case TokenType::VAR_KEYWORD:
                 {
@@ -154,25 +217,25 @@ public:
                         (void) this->expect_token(TokenType::EQUAL);
                         auto defining_expression = this->parse_expression();
                         (void) this->expect_token(TokenType::SEMI_COLON);
-                        return std::make_unique<TypedDefinitionStatement>(var_token.get_location(), variable_name, std::move(type_annotation), std::move(defining_expression));
+                        return AstArena::get().create<TypedDefinitionStatement>(var_token.get_location(), variable_name, type_annotation, defining_expression);
                     } else {
                         (void) this->expect_token(TokenType::EQUAL);
                         auto defining_expression = this->parse_expression();
                         (void) this->expect_token(TokenType::SEMI_COLON);
-                        return std::make_unique<DefinitionStatement>(var_token.get_location(), variable_name, std::move(defining_expression));
+                        return AstArena::get().create<DefinitionStatement>(var_token.get_location(), variable_name, defining_expression);
                     }
                 }
 
             case TokenType::OPEN_CURLY_BRACE:
                 {
                     Token open_curly_brace_token = this->consume_token();
-                    std::vector<std::unique_ptr<Statement>> sub_statements;
+                    std::vector<Statement *> sub_statements;
                     while (this->get_current_token().get_type() != TokenType::CLOSE_CURLY_BRACE) {
                         auto statement = this->parse_statement();
-                        sub_statements.push_back(std::move(statement));
+                        sub_statements.push_back(statement);
                     }
                     (void) this->expect_token(TokenType::CLOSE_CURLY_BRACE);
-                    return std::make_unique<BlockStatement>(open_curly_brace_token.get_location(), std::move(sub_statements));
+                    return AstArena::get().create<BlockStatement>(open_curly_brace_token.get_location(), std::move(sub_statements));
                 }
 
             case TokenType::RETURN_KEYWORD:
@@ -180,11 +243,11 @@ public:
                     Token return_keyword = this->consume_token();
                     if (this->get_current_token().get_type() == TokenType::SEMI_COLON) {
                         (void) this->consume_token();
-                        return std::make_unique<VoidReturnStatement>(return_keyword.get_location());
+                        return AstArena::get().create<VoidReturnStatement>(return_keyword.get_location());
                     } else {
                         auto return_value = this->parse_expression();
                         (void)this->expect_token(TokenType::SEMI_COLON);
-                        return std::make_unique<ReturnStatement>(return_keyword.get_location(), std::move(return_value));
+                        return AstArena::get().create<ReturnStatement>(return_keyword.get_location(), return_value);
                     }
                 }
 
@@ -198,9 +261,9 @@ public:
                     if (this->get_current_token().get_type() == TokenType::ELSE_KEYWORD) {
                         (void) this->consume_token();
                         auto else_body = this->parse_statement();
-                        return std::make_unique<ElifStatement>(if_keyword_token.get_location(), std::move(condition), std::move(then_body), std::move(else_body));
+                        return AstArena::get().create<ElifStatement>(if_keyword_token.get_location(), condition, then_body, else_body);
                     } else {
-                        return std::make_unique<IfStatement>(if_keyword_token.get_location(), std::move(condition), std::move(then_body));
+                        return AstArena::get().create<IfStatement>(if_keyword_token.get_location(), condition, then_body);
                     }
                 }
             
@@ -211,35 +274,35 @@ public:
                     auto condition = this->parse_expression();
                     (void) this->expect_token(TokenType::CLOSE_PARENTHESIS);
                     auto body = this->parse_statement();
-                    return std::make_unique<WhileStatement>(while_keyword_token.get_location(), std::move(condition), std::move(body));
+                    return AstArena::get().create<WhileStatement>(while_keyword_token.get_location(), condition, body);
                 }
 
             case TokenType::BREAK_KEYWORD:
                 {
                     Token break_keyword_token = this->consume_token();
                     this->expect_token(TokenType::SEMI_COLON);
-                    return std::make_unique<BreakStatement>(break_keyword_token.get_location());
+                    return AstArena::get().create<BreakStatement>(break_keyword_token.get_location());
                 }
                 
             case TokenType::CONTINUE_KEYWORD:
                 {
                     Token continue_keyword_token = this->consume_token();
                     this->expect_token(TokenType::SEMI_COLON);
-                    return std::make_unique<ContinueStatement>(continue_keyword_token.get_location());
+                    return AstArena::get().create<ContinueStatement>(continue_keyword_token.get_location());
                 }
 
             default:
                 {
                     auto expression = this->parse_expression();
                     this->expect_token(TokenType::SEMI_COLON);
-                    return std::make_unique<ExpressionStatement>(std::move(expression));
+                    return AstArena::get().create<ExpressionStatement>(expression);
                 }
             
         }
     }
 
 private:
-    std::unique_ptr<Expression> parse_binary_expression(int parent_precedence=-1) {
+    Expression *parse_binary_expression(int parent_precedence=-1) {
         auto left = this->parse_unary_expression();
         Token next_operator = this->get_current_token();
         int operator_precedence = this->get_binary_precedence(next_operator.get_type());
@@ -249,14 +312,14 @@ private:
         ) {
             (void)this->consume_token();
             auto right = this->parse_binary_expression(operator_precedence);
-            left = std::make_unique<BinaryExpression>(std::move(left), std::move(right), next_operator);
+            left = AstArena::get().create<BinaryExpression>(left, right, next_operator);
             next_operator = this->get_current_token();
             operator_precedence = this->get_binary_precedence(next_operator.get_type());
         }
         return left;
     }
 
-    std::unique_ptr<Expression> parse_unary_expression() {
+    Expression *parse_unary_expression() {
         Token current_token = this->get_current_token();
         switch (current_token.get_type()) {
             // Unary operators
@@ -267,7 +330,7 @@ private:
                 {
                     Token operator_token = this->consume_token();
                     auto operand = this->parse_unary_expression();
-                    return std::make_unique<UnaryExpression>(operator_token, std::move(operand));
+                    return AstArena::get().create<UnaryExpression>(operator_token, operand);
                 }
 
             case TokenType::HASH_TAG:
@@ -275,7 +338,7 @@ private:
                     Token hash_tag_token = this->consume_token();
                     auto type_annotation = this->parse_type_annotation();
                     auto casted_expression = this->parse_unary_expression();
-                    return std::make_unique<CastExpression>(hash_tag_token.get_location(), std::move(type_annotation), std::move(casted_expression));
+                    return AstArena::get().create<CastExpression>(hash_tag_token.get_location(), type_annotation, casted_expression);
                 }
 
             default:
@@ -283,9 +346,9 @@ private:
         }
     }
 
-    std::unique_ptr<Expression> parse_primary_expression() {
+    Expression *parse_primary_expression() {
         Token current_token = this->get_current_token();
-        std::unique_ptr<Expression> left;
+        Expression *left;
         switch (current_token.get_type()) {
             case TokenType::TRUE_KEYWORD:
             case TokenType::FALSE_KEYWORD:
@@ -293,14 +356,14 @@ private:
             case TokenType::FLOAT_LITERAL:
             case TokenType::STRING_LITERAL:
             case TokenType::CHAR_LITERAL:
-                left = std::make_unique<LiteralExpression>(this->consume_token());
+                left = AstArena::get().create<LiteralExpression>(this->consume_token());
                 break;
             case TokenType::OPEN_PARENTHESIS:
                 {
                     (void)this->consume_token();
                     auto inner_expression = this->parse_expression();
                     this->expect_token(TokenType::CLOSE_PARENTHESIS);
-                    left = std::move(inner_expression);
+                    left = inner_expression;
                     break;
                 }
 
@@ -308,11 +371,11 @@ private:
             case TokenType::OPEN_SQUARE_BRACKET:
                 {
                     Token open_square_bracket_token = this->consume_token();
-                    std::vector<std::unique_ptr<Expression>> element_initializers;
+                    std::vector<Expression *> element_initializers;
                     if (this->get_current_token().get_type() != TokenType::CLOSE_SQUARE_BRACKET) {
                         for (;;) {
                             auto element_initializer = this->parse_expression();
-                            element_initializers.push_back(std::move(element_initializer));
+                            element_initializers.push_back(element_initializer);
                             if (this->get_current_token().get_type() == TokenType::COMMA) {
                                 (void) this->consume_token();
                             } else {
@@ -321,12 +384,12 @@ private:
                         }
                     }
                     (void) this->expect_token(TokenType::CLOSE_SQUARE_BRACKET);
-                    left = std::make_unique<ListLiteralExpression>(open_square_bracket_token.get_location(), std::move(element_initializers));
+                    left = AstArena::get().create<ListLiteralExpression>(open_square_bracket_token.get_location(), std::move(element_initializers));
                     break;
                 }
 
             case TokenType::NAME:
-                left = std::make_unique<VariableExpression>(this->consume_token());
+                left = AstArena::get().create<VariableExpression>(this->consume_token());
                 break;
             default:
                 PARSE_ERROR(current_token.get_location(), "Unexpected token of type <" << current_token.get_type() << "> at the beginning of a primary expression.");
@@ -339,11 +402,11 @@ private:
                 case TokenType::OPEN_PARENTHESIS:
                     {
                         (void)this->consume_token();
-                        std::vector<std::unique_ptr<Expression>> arguments;
+                        std::vector<Expression *> arguments;
                         if (this->get_current_token().get_type() != TokenType::CLOSE_PARENTHESIS) {
                             for (;;) {
                                 auto argument_expression = this->parse_expression();
-                                arguments.push_back(std::move(argument_expression));
+                                arguments.push_back(argument_expression);
                                 if (this->get_current_token().get_type() == TokenType::COMMA) {
                                     (void)this->consume_token();
                                 } else {
@@ -352,7 +415,7 @@ private:
                             }
                         }
                         this->expect_token(TokenType::CLOSE_PARENTHESIS);
-                        left = std::make_unique<CallExpression>(std::move(left), std::move(arguments));
+                        left = AstArena::get().create<CallExpression>(left, std::move(arguments));
                         break;
                     }
 
@@ -361,7 +424,7 @@ private:
                         (void) this->consume_token();
                         auto index = this->parse_expression();
                         (void) this->expect_token(TokenType::CLOSE_SQUARE_BRACKET);
-                        left = std::make_unique<IndexingExpression>(std::move(left), std::move(index));
+                        left = AstArena::get().create<IndexingExpression>(left, index);
                         break;
                     }
 
@@ -369,7 +432,7 @@ private:
                     {
                         (void) this->consume_token();
                         Token member_name = this->expect_token(TokenType::NAME);
-                        left = std::make_unique<MemberAccessExpression>(std::move(left), member_name);
+                        left = AstArena::get().create<MemberAccessExpression>(left, member_name);
                         break;
                     }
 
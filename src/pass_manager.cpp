@@ -0,0 +1,194 @@
+
+#define DEFAULT_OPTIMIZATION_LEVEL 2
+#define MAX_OPTIMIZATION_LEVEL 2
+
+class PassStatistics {
+private:
+    std::string name;
+    double milliseconds;
+    size_t instructions_before;
+    size_t instructions_after;
+public:
+    PassStatistics(const std::string& name, double milliseconds, size_t instructions_before, size_t instructions_after)
+        : name(name), milliseconds(milliseconds), instructions_before(instructions_before), instructions_after(instructions_after)
+    {}
+
+    const std::string& get_name() const {
+        return this->name;
+    }
+
+    double get_milliseconds() const {
+        return this->milliseconds;
+    }
+
+    size_t get_instructions_before() const {
+        return this->instructions_before;
+    }
+
+    size_t get_instructions_after() const {
+        return this->instructions_after;
+    }
+
+    ~PassStatistics() {}
+};
+
+// Decides which optimizations are done and runs the optimization passes between code generation and CodeGenerator::finalize.
+//
+// Every optimization has a name and the lowest optimization level that enables it:
+//      -O0: no optimizations
+//      -O1: optimizations that only simplify the emitted code
+//      -O2: optimizations that may grow the code or allocate additional variables (default)
+// Single optimizations can be enabled or disabled independently of the level. Some passes only change the code
+// if the program was compiled with a profile (see Profile). Optimizations that are done while
+// emitting the code (e.g. loop invariant code motion) are looked up by the code generator, see CodeGenerator::enable_optimization.
+class PassManager {
+private:
+    std::vector<std::unique_ptr<OptimizationPass>> passes;
+    std::vector<std::string> emit_optimizations;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, int> levels;
+    std::unordered_set<std::string> enabled;
+    bool print_statistics;
+
+    void add_pass(std::unique_ptr<OptimizationPass> pass, int level) {
+        this->names.push_back(pass->get_name());
+        this->levels[pass->get_name()] = level;
+        this->passes.push_back(std::move(pass));
+    }
+
+    void add_emit_optimization(const std::string& name, int level) {
+        this->names.push_back(name);
+        this->levels[name] = level;
+        this->emit_optimizations.push_back(name);
+    }
+
+    static size_t count_program_instructions(CodeGenerator& code_generator) {
+        size_t count = 0;
+        for (const auto& function : code_generator.get_functions()) {
+            count += count_instructions(function.get_instructions());
+        }
+        return count;
+    }
+
+    void print(const std::vector<PassStatistics>& statistics) const {
+        std::cerr << std::left << std::setw(28) << "PASS" << std::right << std::setw(12) << "TIME (ms)"
+            << std::setw(10) << "BEFORE" << std::setw(10) << "AFTER" << std::endl;
+
+        double total_milliseconds = 0.0;
+        for (const auto& pass_statistics : statistics) {
+            std::cerr << std::left << std::setw(28) << pass_statistics.get_name() << std::right
+                << std::setw(12) << std::fixed << std::setprecision(3) << pass_statistics.get_milliseconds()
+                << std::setw(10) << pass_statistics.get_instructions_before()
+                << std::setw(10) << pass_statistics.get_instructions_after() << std::endl;
+            total_milliseconds += pass_statistics.get_milliseconds();
+        }
+
+        if (statistics.size() > 0) {
+            std::cerr << std::left << std::setw(28) << "total" << std::right
+                << std::setw(12) << std::fixed << std::setprecision(3) << total_milliseconds
+                << std::setw(10) << statistics.front().get_instructions_before()
+                << std::setw(10) << statistics.back().get_instructions_after() << std::endl;
+        }
+    }
+
+public:
+    PassManager() : passes(), emit_optimizations(), names(), levels(), enabled(), print_statistics(false) {
+        this->add_emit_optimization("range-analysis", 1);
+        this->add_emit_optimization("shift-division", 1);
+        this->add_emit_optimization("bounds-check-elimination", 1);
+        this->add_emit_optimization("licm", 1);
+        this->add_emit_optimization("induction-pointers", 2);
+
+        // The passes are run in this order
+        this->add_pass(std::make_unique<Memoizer>(), 2);
+        this->add_pass(std::make_unique<ConstantCallEvaluator>(), 1);
+        this->add_pass(std::make_unique<FunctionInliner>(), 2);
+        this->add_pass(std::make_unique<StrengthReducer>(), 1);
+        this->add_pass(std::make_unique<CommonSubexpressionEliminator>(), 2);
+        this->add_pass(std::make_unique<DeadCodeEliminator>(), 1);
+        this->add_pass(std::make_unique<BlockLayout>(), 2);
+        this->add_pass(std::make_unique<LoopUnroller>(), 2);
+
+        this->set_optimization_level(DEFAULT_OPTIMIZATION_LEVEL);
+    }
+
+    // Enables exactly the optimizations of the given level
+    void set_optimization_level(int level) {
+        this->enabled.clear();
+        for (const auto& [name, minimum_level] : this->levels) {
+            if (minimum_level <= level) {
+                this->enabled.insert(name);
+            }
+        }
+    }
+
+    // Returns false if there is no optimization with the given name
+    bool set_enabled(const std::string& name, bool is_enabled) {
+        if (!this->levels.contains(name)) {
+            return false;
+        }
+        if (is_enabled) {
+            this->enabled.insert(name);
+        } else {
+            this->enabled.erase(name);
+        }
+        return true;
+    }
+
+    bool is_enabled(const std::string& name) const {
+        return this->enabled.contains(name);
+    }
+
+    void set_print_statistics(bool print_statistics) {
+        this->print_statistics = print_statistics;
+    }
+
+    const std::vector<std::string>& get_names() const {
+        return this->names;
+    }
+
+    // Names of the enabled optimizations, programs compiled with the same configuration are the same
+    std::string get_configuration() const {
+        std::string configuration;
+        for (const auto& name : this->names) {
+            if (this->is_enabled(name)) {
+                configuration += name + ",";
+            }
+        }
+        return configuration;
+    }
+
+    // Has to be called before the code is emitted
+    void configure(CodeGenerator& code_generator) const {
+        for (const auto& name : this->emit_optimizations) {
+            if (this->is_enabled(name)) {
+                code_generator.enable_optimization(name);
+            }
+        }
+    }
+
+    // Runs the enabled passes and prints their statistics to stderr if requested
+    void run(CodeGenerator& code_generator) {
+        std::vector<PassStatistics> statistics;
+        for (auto& pass : this->passes) {
+            if (!this->is_enabled(pass->get_name())) {
+                continue;
+            }
+
+            size_t instructions_before = count_program_instructions(code_generator);
+            auto start = std::chrono::steady_clock::now();
+            pass->run(code_generator);
+            auto end = std::chrono::steady_clock::now();
+            size_t instructions_after = count_program_instructions(code_generator);
+
+            double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+            statistics.push_back(PassStatistics(pass->get_name(), milliseconds, instructions_before, instructions_after));
+        }
+
+        if (this->print_statistics) {
+            this->print(statistics);
+        }
+    }
+
+    ~PassManager() {}
+};
@@ -0,0 +1,200 @@
+
+#define PROFILE_ERROR(path, message) \
+    do { \
+        std::cerr << (path) << ": PROFILE_ERROR: " << message << std::endl; \
+        std::exit(1); \
+    } while(0)
+
+#define PROFILE_VERSION 1
+#define PROFILE_MAGIC "ni-profile"
+
+// Conditional branches are identified by the origin of their target label and their ordinal
+// among the branches of the function that jump to the same label
+typedef std::pair<size_t, size_t> BranchKey;
+
+static bool is_conditional_branch(InstructionType type) {
+    return is_branch_instruction(type) && type != InstructionType::JUMP;
+}
+
+// Maps the index of every conditional branch of the function to its key
+std::map<size_t, BranchKey> collect_branch_keys(const CodeGenerator& code_generator, const FunctionCode& function) {
+    const auto& instructions = function.get_instructions();
+    std::map<size_t, BranchKey> branch_keys;
+    std::unordered_map<int64_t, size_t> ordinals;
+    for (size_t i = 0; i < instructions.size(); i++) {
+        if (is_conditional_branch(instructions[i].get_type())) {
+            int64_t target = instructions[i].get_operand().as_int;
+            branch_keys[i] = { code_generator.get_label_origin((size_t) target), ordinals[target] };
+            ordinals[target] += 1;
+        }
+    }
+    return branch_keys;
+}
+
+// Execution counts of a previous run of the program, recorded with '--profile-out' and used by the optimization
+// passes with '--profile-in':
+//      - how often every function was called, keyed by the label of the function
+//      - how often every conditional branch was taken and not taken, see BranchKey
+//      - how often every loop was entered and how often it jumped back to its header, keyed by the origin of the header label
+//
+// Labels are the same whenever the same source is compiled with the same optimizations, so the profile is only used
+// for the program it was recorded for. Code copied by the passes shares the entries of the original code, the counts
+// of all copies are summed up. The profile only decides where optimizing pays off, it never changes what the program does.
+//
+// The profile is a text file:
+//      ni-profile <version> <program hash>
+//      function <label> <calls>
+//      branch <label> <ordinal> <taken> <not taken>
+//      loop <label> <entries> <iterations>
+class Profile {
+private:
+    std::map<size_t, uint64_t> function_calls;
+    std::map<BranchKey, std::pair<uint64_t, uint64_t>> branch_counts;
+    std::map<size_t, std::pair<uint64_t, uint64_t>> loop_counts;
+public:
+    Profile() : function_calls(), branch_counts(), loop_counts() {}
+
+    // Identifies the program a profile belongs to
+    static uint64_t get_program_hash(std::string_view source, const std::string& configuration) {
+        return hash_fnv1a(std::string(1, '\0') + configuration, hash_fnv1a(source));
+    }
+
+    // The counts are the ones recorded by VirtualMachine::execute_profiled for the finalized program of the code generator
+    static Profile collect(CodeGenerator& code_generator, const std::vector<uint64_t>& execution_counts, const std::vector<uint64_t>& taken_counts) {
+        const auto& functions = code_generator.get_functions();
+        Profile profile;
+        for (size_t index = 0; index < functions.size(); index++) {
+            const FunctionCode& function = functions[index];
+            const auto& instructions = function.get_instructions();
+            size_t location = code_generator.get_function_location(index);
+            profile.function_calls[function.get_label()] += execution_counts[location];
+
+            for (const auto& [i, key] : collect_branch_keys(code_generator, function)) {
+                uint64_t taken = taken_counts[location + i];
+                auto& counts = profile.branch_counts[key];
+                counts.first += taken;
+                counts.second += execution_counts[location + i] - taken;
+            }
+
+            // Every execution of a loop header is either an entry or an iteration that jumped back
+            auto label_positions = collect_label_positions(instructions);
+            std::map<size_t, uint64_t> back_edge_counts;
+            for (size_t i = 0; i < instructions.size(); i++) {
+                InstructionType type = instructions[i].get_type();
+                if (!is_branch_instruction(type)) {
+                    continue;
+                }
+                size_t header = label_positions.at(instructions[i].get_operand().as_int);
+                if (header < i) {
+                    back_edge_counts[header] += type == InstructionType::JUMP ? execution_counts[location + i] : taken_counts[location + i];
+                }
+            }
+            for (const auto& [header, iterations] : back_edge_counts) {
+                size_t label = code_generator.get_label_origin((size_t) instructions[header].get_operand().as_int);
+                auto& counts = profile.loop_counts[label];
+                counts.first += execution_counts[location + header] - iterations;
+                counts.second += iterations;
+            }
+        }
+        return profile;
+    }
+
+    bool has_function(size_t label) const {
+        return this->function_calls.contains(label);
+    }
+
+    uint64_t get_function_calls(size_t label) const {
+        return this->function_calls.at(label);
+    }
+
+    bool has_branch(const BranchKey& key) const {
+        return this->branch_counts.contains(key);
+    }
+
+    // Pair of taken and not taken count
+    const std::pair<uint64_t, uint64_t>& get_branch_counts(const BranchKey& key) const {
+        return this->branch_counts.at(key);
+    }
+
+    bool has_loop(size_t label) const {
+        return this->loop_counts.contains(label);
+    }
+
+    // Average number of jumps back to the header per entry of the loop
+    double get_average_trip_count(size_t label) const {
+        const auto& [entries, iterations] = this->loop_counts.at(label);
+        return entries > 0 ? (double) iterations / (double) entries : (double) iterations;
+    }
+
+    // Returns false if the file could not be written
+    bool write(const std::string& path, uint64_t program_hash) const {
+        std::ofstream output_stream(path);
+        if (!output_stream) {
+            return false;
+        }
+
+        output_stream << PROFILE_MAGIC << " " << PROFILE_VERSION << " " << std::hex << program_hash << std::dec << std::endl;
+
+        for (const auto& [label, calls] : this->function_calls) {
+            output_stream << "function " << label << " " << calls << std::endl;
+        }
+        for (const auto& [key, counts] : this->branch_counts) {
+            output_stream << "branch " << key.first << " " << key.second << " " << counts.first << " " << counts.second << std::endl;
+        }
+        for (const auto& [label, counts] : this->loop_counts) {
+            output_stream << "loop " << label << " " << counts.first << " " << counts.second << std::endl;
+        }
+
+        output_stream.close();
+        return !output_stream.fail();
+    }
+
+    // Returns false (and prints a warning) if the profile was recorded for another program or another configuration
+    bool read(const std::string& path, uint64_t program_hash) {
+        std::ifstream input_stream(path);
+        if (!input_stream) {
+            PROFILE_ERROR(path, "Could not open file.");
+        }
+
+        std::string magic;
+        int version = 0;
+        uint64_t recorded_program_hash = 0;
+        if (!(input_stream >> magic >> version >> std::hex >> recorded_program_hash >> std::dec) || magic != PROFILE_MAGIC) {
+            PROFILE_ERROR(path, "File is not a profile.");
+        }
+        if (version != PROFILE_VERSION) {
+            PROFILE_ERROR(path, "Unsupported version " << version << ", expected version " << PROFILE_VERSION << ".");
+        }
+        if (recorded_program_hash != program_hash) {
+            std::cerr << path << ": WARNING: Profile was recorded for another source or other optimizations, it is ignored." << std::endl;
+            return false;
+        }
+
+        std::string kind;
+        while (input_stream >> kind) {
+            bool is_valid = false;
+            if (kind == "function") {
+                size_t label;
+                uint64_t calls;
+                is_valid = (bool) (input_stream >> label >> calls);
+                this->function_calls[label] = calls;
+            } else if (kind == "branch") {
+                BranchKey key;
+                std::pair<uint64_t, uint64_t> counts;
+                is_valid = (bool) (input_stream >> key.first >> key.second >> counts.first >> counts.second);
+                this->branch_counts[key] = counts;
+            } else if (kind == "loop") {
+                size_t label;
+                std::pair<uint64_t, uint64_t> counts;
+                is_valid = (bool) (input_stream >> label >> counts.first >> counts.second);
+                this->loop_counts[label] = counts;
+            }
+            if (!is_valid) {
+                PROFILE_ERROR(path, "Invalid entry '" << kind << "'.");
+            }
+        }
+        return true;
+    }
+
+    ~Profile() {}
+};
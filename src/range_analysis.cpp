@@ -0,0 +1,112 @@
+
+// Finds the local variables of a function that can never hold a negative integer.
+//
+// The analysis is flow insensitive: every variable starts out as non negative and is dropped as soon as
+// one of its definitions or assignments can not be proven to be non negative. This is repeated until
+// nothing changes. Arguments are never non negative, since their values are not known.
+//
+// Integer arithmetic wraps around, so sums are not non negative in general. The only exception are increments
+// 'i = i + c' by a literal step of at most MAX_NON_NEGATIVE_STEP: starting from a non negative value, i would
+// have to be incremented more than 2^55 times before it wraps around.
+#define MAX_NON_NEGATIVE_STEP 256
+
+class ValueRangeAnalysis {
+private:
+    size_t argument_count;
+    std::vector<std::pair<size_t, const Expression *>> assignments;
+    // Variables of the increments 'i = i + c' with 0 <= c <= MAX_NON_NEGATIVE_STEP, they are not part of the assignments
+    std::unordered_set<size_t> incremented_variables;
+
+    void collect_expression_assignments(const Expression& expression) {
+        auto as_binary_expression = dynamic_cast<const BinaryExpression *>(&expression);
+        if (as_binary_expression != nullptr && as_binary_expression->get_operator_token().get_type() == TokenType::EQUAL) {
+            auto as_variable_expression = dynamic_cast<const VariableExpression *>(as_binary_expression->get_left());
+            if (as_variable_expression != nullptr) {
+                size_t variable = as_variable_expression->get_id();
+                int64_t step;
+                if (as_binary_expression->get_induction_step(variable, step) && step >= 0 && step <= MAX_NON_NEGATIVE_STEP) {
+                    this->incremented_variables.insert(variable);
+                } else {
+                    this->assignments.push_back({ variable, as_binary_expression->get_right() });
+                }
+            }
+        }
+        expression.for_each_sub_expression([this](const Expression& sub_expression) {
+            this->collect_expression_assignments(sub_expression);
+        });
+    }
+
+    void collect_assignments(const Statement& statement) {
+        auto as_definition = dynamic_cast<const DefinitionStatement *>(&statement);
+        auto as_typed_definition = dynamic_cast<const TypedDefinitionStatement *>(&statement);
+        if (as_definition != nullptr) {
+            this->assignments.push_back({ as_definition->get_id(), as_definition->get_defining_expression() });
+        } else if (as_typed_definition != nullptr) {
+            this->assignments.push_back({ as_typed_definition->get_id(), as_typed_definition->get_defining_expression() });
+        }
+
+        statement.for_each_sub_expression([this](const Expression& expression) {
+            this->collect_expression_assignments(expression);
+        });
+        statement.for_each_sub_statement([this](const Statement& sub_statement) {
+            this->collect_assignments(sub_statement);
+        });
+    }
+
+public:
+    ValueRangeAnalysis(size_t argument_count) : argument_count(argument_count), assignments(), incremented_variables() {}
+
+    std::unordered_set<size_t> find_non_negative_variables(const Statement& body) {
+        this->assignments.clear();
+        this->incremented_variables.clear();
+        this->collect_assignments(body);
+
+        std::unordered_set<size_t> non_negative_variables;
+        for (const auto& [variable, _] : this->assignments) {
+            if (variable >= this->argument_count) {
+                non_negative_variables.insert(variable);
+            }
+        }
+
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (const auto& [variable, value] : this->assignments) {
+                if (non_negative_variables.contains(variable) && !value->is_non_negative(non_negative_variables)) {
+                    non_negative_variables.erase(variable);
+                    changed = true;
+                }
+            }
+        }
+
+        return non_negative_variables;
+    }
+
+    // Variables that are only defined or assigned as non negative integer literals and are otherwise only incremented.
+    // Unlike find_non_negative_variables this does not rely on proofs about other expressions, so bounds check
+    // elimination only trusts these variables to never be negative.
+    std::unordered_set<size_t> find_counting_variables(const Statement& body) {
+        this->assignments.clear();
+        this->incremented_variables.clear();
+        this->collect_assignments(body);
+
+        std::unordered_set<size_t> counting_variables;
+        for (const auto& [variable, _] : this->assignments) {
+            if (variable >= this->argument_count) {
+                counting_variables.insert(variable);
+            }
+        }
+
+        for (const auto& [variable, value] : this->assignments) {
+            auto as_literal_expression = dynamic_cast<const LiteralExpression *>(value);
+            int64_t literal_value;
+            if (as_literal_expression == nullptr || !as_literal_expression->get_int_value(literal_value) || literal_value < 0) {
+                counting_variables.erase(variable);
+            }
+        }
+
+        return counting_variables;
+    }
+
+    ~ValueRangeAnalysis() {}
+};
@@ -0,0 +1,178 @@
+// Scans runs of whitespace, comment and name characters for the tokenizer. The source is compared a block of
+// characters at a time, 32 at a time with AVX2 on processors that support it and 16 at a time with SSE2 otherwise. The
+// characters behind the last full block are compared one by one. Without SSE2 every character is compared one by one.
+//
+// The AVX2 functions are compiled with the "avx2" target, so the compiler does not need to be allowed to use AVX2 for
+// the whole program, and are only called if __builtin_cpu_supports reports AVX2 at runtime.
+//
+// Character classes are checked with signed comparisons: adding 128 - low to a character moves the range
+// [low, low + count) to [-128, -128 + count), so a single comparison with -128 + count decides whether the
+// character is inside of the range.
+
+#if defined(__SSE2__)
+
+namespace sse2 {
+
+#define SCAN_WIDTH 16
+#define SCAN_FULL_MASK 0xFFFFu
+
+typedef __m128i ScanVector;
+
+static inline ScanVector scan_load(const char *characters) {
+    return _mm_loadu_si128((const __m128i *) characters);
+}
+
+static inline ScanVector scan_splat(int8_t value) {
+    return _mm_set1_epi8(value);
+}
+
+static inline ScanVector scan_equal(ScanVector left, ScanVector right) {
+    return _mm_cmpeq_epi8(left, right);
+}
+
+static inline ScanVector scan_less(ScanVector left, ScanVector right) {
+    return _mm_cmplt_epi8(left, right);
+}
+
+static inline ScanVector scan_add(ScanVector left, ScanVector right) {
+    return _mm_add_epi8(left, right);
+}
+
+static inline ScanVector scan_or(ScanVector left, ScanVector right) {
+    return _mm_or_si128(left, right);
+}
+
+static inline uint32_t scan_mask(ScanVector vector) {
+    return (uint32_t) _mm_movemask_epi8(vector);
+}
+
+#include "block_scanner.cpp"
+
+#undef SCAN_WIDTH
+#undef SCAN_FULL_MASK
+
+}
+
+// The "avx2" target is a GCC extension
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+
+#define HAS_AVX2_SCANS
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+namespace avx2 {
+
+#define SCAN_WIDTH 32
+#define SCAN_FULL_MASK 0xFFFFFFFFu
+
+typedef __m256i ScanVector;
+
+static inline ScanVector scan_load(const char *characters) {
+    return _mm256_loadu_si256((const __m256i *) characters);
+}
+
+static inline ScanVector scan_splat(int8_t value) {
+    return _mm256_set1_epi8(value);
+}
+
+static inline ScanVector scan_equal(ScanVector left, ScanVector right) {
+    return _mm256_cmpeq_epi8(left, right);
+}
+
+static inline ScanVector scan_less(ScanVector left, ScanVector right) {
+    return _mm256_cmpgt_epi8(right, left);
+}
+
+static inline ScanVector scan_add(ScanVector left, ScanVector right) {
+    return _mm256_add_epi8(left, right);
+}
+
+static inline ScanVector scan_or(ScanVector left, ScanVector right) {
+    return _mm256_or_si256(left, right);
+}
+
+static inline uint32_t scan_mask(ScanVector vector) {
+    return (uint32_t) _mm256_movemask_epi8(vector);
+}
+
+#include "block_scanner.cpp"
+
+#undef SCAN_WIDTH
+#undef SCAN_FULL_MASK
+
+}
+
+#pragma GCC pop_options
+
+static bool is_avx2_supported() {
+    static const bool is_supported = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return is_supported;
+}
+
+#endif
+
+#endif
+
+// Same characters as std::isspace in the "C" locale
+static inline bool is_whitespace_character(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline bool is_name_character(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// Position of the first character at or after 'position' that is not whitespace
+size_t skip_whitespace(std::string_view source, size_t position) {
+#if defined(HAS_AVX2_SCANS)
+    if (is_avx2_supported()) {
+        position = avx2::skip_whitespace_blocks(source, position);
+    } else {
+        position = sse2::skip_whitespace_blocks(source, position);
+    }
+#elif defined(__SSE2__)
+    position = sse2::skip_whitespace_blocks(source, position);
+#endif
+    while (position < source.size() && is_whitespace_character(source[position])) {
+        position += 1;
+    }
+    return position;
+}
+
+// Position of the first character at or after 'position' that can not be part of a name
+size_t skip_name_characters(std::string_view source, size_t position) {
+#if defined(HAS_AVX2_SCANS)
+    if (is_avx2_supported()) {
+        position = avx2::skip_name_character_blocks(source, position);
+    } else {
+        position = sse2::skip_name_character_blocks(source, position);
+    }
+#elif defined(__SSE2__)
+    position = sse2::skip_name_character_blocks(source, position);
+#endif
+    while (position < source.size() && is_name_character(source[position])) {
+        position += 1;
+    }
+    return position;
+}
+
+// Position of the first '\n' or '\0' at or after 'position', used to skip the rest of a comment
+size_t skip_line(std::string_view source, size_t position) {
+#if defined(HAS_AVX2_SCANS)
+    if (is_avx2_supported()) {
+        position = avx2::skip_line_blocks(source, position);
+    } else {
+        position = sse2::skip_line_blocks(source, position);
+    }
+#elif defined(__SSE2__)
+    position = sse2::skip_line_blocks(source, position);
+#endif
+    while (position < source.size() && source[position] != '\n' && source[position] != '\0') {
+        position += 1;
+    }
+    return position;
+}
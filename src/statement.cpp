@@ -11,6 +11,26 @@ public:
     virtual void type_check() = 0; 
     virtual bool is_definite_return() const = 0;
     virtual void emit(CodeGenerator&) const = 0;
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>& callback) const = 0;
+    virtual void for_each_sub_statement(const std::function<void(const Statement&)>& callback) const = 0;
+
+    virtual void collect_side_effects(SideEffects& effects) const {
+        this->for_each_sub_expression([&](const Expression& sub_expression) {
+            sub_expression.collect_side_effects(effects);
+        });
+        this->for_each_sub_statement([&](const Statement& sub_statement) {
+            sub_statement.collect_side_effects(effects);
+        });
+    }
+
+    void collect_invariant_expressions(const SideEffects& loop_effects, std::vector<const Expression *>& output) const {
+        this->for_each_sub_expression([&](const Expression& sub_expression) {
+            sub_expression.collect_invariant_expressions(loop_effects, output);
+        });
+        this->for_each_sub_statement([&](const Statement& sub_statement) {
+            sub_statement.collect_invariant_expressions(loop_effects, output);
+        });
+    }
 
     const Location& get_location() const {
         return this->location;
@@ -26,10 +46,10 @@ std::ostream& operator<<(std::ostream& output_stream, const Statement& statement
 
 class ExpressionStatement : public Statement {
 private:
-    std::unique_ptr<Expression> expression;
+    Expression *expression;
 public:
-    ExpressionStatement(std::unique_ptr<Expression> expression)
-        : Statement(expression->get_location()), expression(std::move(expression))
+    ExpressionStatement(Expression *expression)
+        : Statement(expression->get_location()), expression(expression)
     {}
 
     virtual void append_to_output_stream(std::ostream& output_stream, size_t layer = 0) const override {
@@ -54,18 +74,29 @@ public:
         }
     }
 
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>& callback) const override {
+        callback(*this->expression);
+    }
+
+    virtual void for_each_sub_statement(const std::function<void(const Statement&)>&) const override {}
+
     ~ExpressionStatement() {}
 };
 
 class DefinitionStatement : public Statement {
 private:
     Token variable_name;
-    std::unique_ptr<Expression> defining_expression;
+    size_t name_id;
+    Expression *defining_expression;
     size_t id;
 
 public:
-    DefinitionStatement(const Location& start_location, const Token& variable_name, std::unique_ptr<Expression> defining_expression)
-        : Statement(start_location), variable_name(variable_name), defining_expression(std::move(defining_expression)), id(0)
+    DefinitionStatement(const Location& start_location, const Token& variable_name, Expression *defining_expression)
+        : Statement(start_location),
+          variable_name(variable_name),
+          name_id(TypeChecker::get().get_name_id(variable_name.get_text())),
+          defining_expression(defining_expression),
+          id(0)
     {}
 
     virtual void append_to_output_stream(std::ostream& output_stream, size_t layer = 0) const override {
@@ -75,12 +106,12 @@ public:
     }
 
     virtual void type_check() override {
-        const std::string& name_string = this->variable_name.get_text();
-        if (TypeChecker::get().symbol_exists(name_string)) {
+        std::string_view name_string(this->variable_name.get_text());
+        if (TypeChecker::get().symbol_exists(this->name_id)) {
             TYPE_ERROR("Symbol '" << name_string << "' already exists.");
         }
         this->defining_expression->type_check();
-        this->id = TypeChecker::get().add_variable_symbol(name_string, this->defining_expression->get_type());
+        this->id = TypeChecker::get().add_variable_symbol(this->name_id, this->defining_expression->get_type());
     }
     
     virtual bool is_definite_return() const override {
@@ -90,6 +121,26 @@ public:
     virtual void emit(CodeGenerator& code_generator) const override {
         this->defining_expression->emit(code_generator);
         INT_INST(VWRITE, this->id);
+        code_generator.invalidate_index_bounds(this->id);
+    }
+
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>& callback) const override {
+        callback(*this->defining_expression);
+    }
+
+    virtual void for_each_sub_statement(const std::function<void(const Statement&)>&) const override {}
+
+    virtual void collect_side_effects(SideEffects& effects) const override {
+        effects.add_assigned_variable(this->id);
+        this->defining_expression->collect_side_effects(effects);
+    }
+
+    size_t get_id() const {
+        return this->id;
+    }
+
+    Expression *get_defining_expression() const {
+        return this->defining_expression;
     }
 
     ~DefinitionStatement() {}
@@ -98,15 +149,17 @@ public:
 class TypedDefinitionStatement : public Statement {
 private:
     Token variable_name;
-    std::unique_ptr<TypeAnnotation> type_annotation;
-    std::unique_ptr<Expression> defining_expression;
+    size_t name_id;
+    TypeAnnotation *type_annotation;
+    Expression *defining_expression;
     size_t id;
 public:
-    TypedDefinitionStatement(const Location& start_location, const Token& variable_name, std::unique_ptr<TypeAnnotation> type_annotation, std::unique_ptr<Expression> defining_expression)
+    TypedDefinitionStatement(const Location& start_location, const Token& variable_name, TypeAnnotation *type_annotation, Expression *defining_expression)
         : Statement(start_location),
           variable_name(variable_name),
-          type_annotation(std::move(type_annotation)),
-          defining_expression(std::move(defining_expression)),
+          name_id(TypeChecker::get().get_name_id(variable_name.get_text())),
+          type_annotation(type_annotation),
+          defining_expression(defining_expression),
           id(0)
     {}
 
@@ -117,9 +170,9 @@ public:
     }
 
     virtual void type_check() override {
-        const std::string& name_string = this->variable_name.get_text();
+        std::string_view name_string(this->variable_name.get_text());
 
-        if (TypeChecker::get().symbol_exists(name_string)) {
+        if (TypeChecker::get().symbol_exists(this->name_id)) {
             TYPE_ERROR("Symbol '" << name_string << "' already exists.");
         }
 
@@ -132,7 +185,12 @@ public:
             TYPE_ERROR("Type of defining expression <" << variable_type->to_string() << "> for variable '" << name_string << "' does not fit annotated type <" << annotated_type->to_string() << ">.");
         }
 
-        this->id = TypeChecker::get().add_variable_symbol(name_string, this->defining_expression->get_type());
+        // The annotation gives the element type of an empty list literal, like a type cast does
+        if (variable_type->is_generic()) {
+            this->defining_expression->set_type(annotated_type);
+        }
+
+        this->id = TypeChecker::get().add_variable_symbol(this->name_id, this->defining_expression->get_type());
     }
     
     virtual bool is_definite_return() const override {
@@ -142,6 +200,26 @@ public:
     virtual void emit(CodeGenerator& code_generator) const override {
         this->defining_expression->emit(code_generator);
         INT_INST(VWRITE, this->id);
+        code_generator.invalidate_index_bounds(this->id);
+    }
+
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>& callback) const override {
+        callback(*this->defining_expression);
+    }
+
+    virtual void for_each_sub_statement(const std::function<void(const Statement&)>&) const override {}
+
+    virtual void collect_side_effects(SideEffects& effects) const override {
+        effects.add_assigned_variable(this->id);
+        this->defining_expression->collect_side_effects(effects);
+    }
+
+    size_t get_id() const {
+        return this->id;
+    }
+
+    Expression *get_defining_expression() const {
+        return this->defining_expression;
     }
 
     ~TypedDefinitionStatement() {}
@@ -149,9 +227,9 @@ public:
 
 class BlockStatement : public Statement {
 private:
-    std::vector<std::unique_ptr<Statement>> sub_statements;
+    std::vector<Statement *> sub_statements;
 public:
-    BlockStatement(const Location& start_location, std::vector<std::unique_ptr<Statement>> sub_statements)
+    BlockStatement(const Location& start_location, std::vector<Statement *> sub_statements)
         : Statement(start_location), sub_statements(std::move(sub_statements))
     {}
 
@@ -190,16 +268,24 @@ public:
         }
     }
 
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>&) const override {}
+
+    virtual void for_each_sub_statement(const std::function<void(const Statement&)>& callback) const override {
+        for (const auto& sub_statement : this->sub_statements) {
+            callback(*sub_statement);
+        }
+    }
+
     ~BlockStatement() {}
 };
 
 class IfStatement : public Statement {
 private:
-    std::unique_ptr<Expression> condition;
-    std::unique_ptr<Statement> body;
+    Expression *condition;
+    Statement *body;
 public:
-    IfStatement(const Location& start_location, std::unique_ptr<Expression> condition, std::unique_ptr<Statement> body)
-        : Statement(start_location), condition(std::move(condition)), body(std::move(body))
+    IfStatement(const Location& start_location, Expression *condition, Statement *body)
+        : Statement(start_location), condition(condition), body(body)
     {}
 
     virtual void append_to_output_stream(std::ostream& output_stream, size_t layer = 0) const override {
@@ -217,8 +303,8 @@ public:
             TYPE_ERROR("Condition of if statement must be a boolean, instead got <" << condition_type->to_string() << ">."); 
         }
 
-        auto as_definition_statement = dynamic_cast<DefinitionStatement *>(this->body.get());
-        auto as_typed_definition_statement = dynamic_cast<TypedDefinitionStatement *>(this->body.get());
+        auto as_definition_statement = dynamic_cast<DefinitionStatement *>(this->body);
+        auto as_typed_definition_statement = dynamic_cast<TypedDefinitionStatement *>(this->body);
 
         if (as_definition_statement != nullptr || as_typed_definition_statement != nullptr)  {
             TYPE_ERROR("Body of if statement cannot be a definition");
@@ -236,21 +322,34 @@ public:
         size_t end_label = code_generator.generate_label();
         this->condition->emit_condition(code_generator, end_label, then_label);
         INT_INST(LABEL, then_label);
+
+        auto index_bounds = code_generator.get_index_bounds();
+        add_index_bounds(code_generator, *this->condition);
         this->body->emit(code_generator);
+        code_generator.restrict_index_bounds(index_bounds);
+
         INT_INST(LABEL, end_label);
     }
 
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>& callback) const override {
+        callback(*this->condition);
+    }
+
+    virtual void for_each_sub_statement(const std::function<void(const Statement&)>& callback) const override {
+        callback(*this->body);
+    }
+
     ~IfStatement() {}
 };
 
 class ElifStatement : public Statement {
 private:
-    std::unique_ptr<Expression> condition;
-    std::unique_ptr<Statement> then_body;
-    std::unique_ptr<Statement> else_body;
+    Expression *condition;
+    Statement *then_body;
+    Statement *else_body;
 public:
-    ElifStatement(const Location& start_location, std::unique_ptr<Expression> condition, std::unique_ptr<Statement> then_body, std::unique_ptr<Statement> else_body)
-        : Statement(start_location), condition(std::move(condition)), then_body(std::move(then_body)), else_body(std::move(else_body))
+    ElifStatement(const Location& start_location, Expression *condition, Statement *then_body, Statement *else_body)
+        : Statement(start_location), condition(condition), then_body(then_body), else_body(else_body)
     {}
 
     virtual void append_to_output_stream(std::ostream& output_stream, size_t layer = 0) const override {
@@ -269,15 +368,15 @@ public:
             TYPE_ERROR("Condition of if statement must be a boolean, instead got <" << condition_type->to_string() << ">."); 
         }
 
-        auto as_definition_statement = dynamic_cast<DefinitionStatement *>(this->then_body.get());
-        auto as_typed_definition_statement = dynamic_cast<TypedDefinitionStatement *>(this->then_body.get());
+        auto as_definition_statement = dynamic_cast<DefinitionStatement *>(this->then_body);
+        auto as_typed_definition_statement = dynamic_cast<TypedDefinitionStatement *>(this->then_body);
 
         if (as_definition_statement != nullptr || as_typed_definition_statement != nullptr)  {
             TYPE_ERROR(": TYPE_ERROR: Body of if statement cannot be a definition");
         }
         
-        as_definition_statement = dynamic_cast<DefinitionStatement *>(this->else_body.get());
-        as_typed_definition_statement = dynamic_cast<TypedDefinitionStatement *>(this->else_body.get());
+        as_definition_statement = dynamic_cast<DefinitionStatement *>(this->else_body);
+        as_typed_definition_statement = dynamic_cast<TypedDefinitionStatement *>(this->else_body);
 
         if (as_definition_statement != nullptr || as_typed_definition_statement != nullptr)  {
             TYPE_ERROR("Body of if statement cannot be a definition");
@@ -298,23 +397,37 @@ public:
 
         this->condition->emit_condition(code_generator, else_label, then_label);
         INT_INST(LABEL, then_label);
+
+        auto index_bounds = code_generator.get_index_bounds();
+        add_index_bounds(code_generator, *this->condition);
         this->then_body->emit(code_generator);
+        code_generator.restrict_index_bounds(index_bounds);
+
         INT_INST(JUMP, end_label);
         INT_INST(LABEL, else_label);
         this->else_body->emit(code_generator);
         INT_INST(LABEL, end_label);
     }
 
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>& callback) const override {
+        callback(*this->condition);
+    }
+
+    virtual void for_each_sub_statement(const std::function<void(const Statement&)>& callback) const override {
+        callback(*this->then_body);
+        callback(*this->else_body);
+    }
+
     ~ElifStatement() {}
 };
 
 class WhileStatement : public Statement {
 private:
-    std::unique_ptr<Expression> condition;
-    std::unique_ptr<Statement> body;
+    Expression *condition;
+    Statement *body;
 public:
-    WhileStatement(const Location& start_location, std::unique_ptr<Expression> condition, std::unique_ptr<Statement> body)
-        : Statement(start_location), condition(std::move(condition)), body(std::move(body))
+    WhileStatement(const Location& start_location, Expression *condition, Statement *body)
+        : Statement(start_location), condition(condition), body(body)
     {}
 
     virtual void append_to_output_stream(std::ostream& output_stream, size_t layer = 0) const override {
@@ -344,7 +457,166 @@ public:
         return false; 
     }
     
+    // Evaluates the loop invariant expressions of the loop once before entering it and stores them in
+    // temporary variables, which are loaded instead of evaluating the expressions again inside of the loop.
+    // Returns the hoisted expressions and the variables with hoisted data pointers.
+    std::pair<std::vector<const Expression *>, std::vector<size_t>> emit_preheader(CodeGenerator& code_generator) const {
+        SideEffects loop_effects;
+        this->condition->collect_side_effects(loop_effects);
+        this->body->collect_side_effects(loop_effects);
+
+        std::vector<const Expression *> invariant_expressions;
+        this->condition->collect_invariant_expressions(loop_effects, invariant_expressions);
+        this->body->collect_invariant_expressions(loop_effects, invariant_expressions);
+
+        std::vector<const Expression *> hoisted_expressions;
+        for (const Expression *expression : invariant_expressions) {
+            // Already hoisted out of an enclosing loop
+            if (code_generator.is_hoisted(expression)) {
+                continue;
+            }
+            expression->emit(code_generator);
+            size_t variable = code_generator.allocate_variable();
+            INT_INST(VWRITE, variable);
+            code_generator.add_hoisted_expression(expression, variable);
+            hoisted_expressions.push_back(expression);
+        }
+
+        // The data pointer of a list or string never changes, so indexing a variable that is not assigned
+        // inside of the loop can reuse the data pointer loaded before the loop
+        std::vector<size_t> hoisted_data_pointers;
+        std::function<void(const Expression&)> collect_data_pointers = [&](const Expression& expression) {
+            auto as_indexing_expression = dynamic_cast<const IndexingExpression *>(&expression);
+            if (as_indexing_expression != nullptr) {
+                auto as_variable_expression = dynamic_cast<const VariableExpression *>(as_indexing_expression->get_operand());
+                if (as_variable_expression != nullptr && as_variable_expression->is_loop_invariant(loop_effects)) {
+                    size_t id = as_variable_expression->get_id();
+                    if (!code_generator.has_hoisted_data_pointer(id)) {
+                        as_indexing_expression->emit_data_pointer(code_generator);
+                        size_t variable = code_generator.allocate_variable();
+                        INT_INST(VWRITE, variable);
+                        code_generator.add_hoisted_data_pointer(id, variable);
+                        hoisted_data_pointers.push_back(id);
+                    }
+                }
+            }
+            expression.for_each_sub_expression(collect_data_pointers);
+        };
+        std::function<void(const Statement&)> collect_statement_data_pointers = [&](const Statement& statement) {
+            statement.for_each_sub_expression(collect_data_pointers);
+            statement.for_each_sub_statement(collect_statement_data_pointers);
+        };
+        collect_data_pointers(*this->condition);
+        collect_statement_data_pointers(*this->body);
+
+        return { hoisted_expressions, hoisted_data_pointers };
+    }
+
+    // Basic induction variables are only changed by assignments of the form 'i = i + c' or 'i = i - c' inside of the loop.
+    // For every indexing 'xs[i]' with such an index and an invariant 'xs', a pointer to the element is kept in a
+    // temporary variable, which is advanced by c * element size together with 'i' (see BinaryExpression::emit).
+    // This is only done if the element is accessed more often than the index is updated and the loop condition
+    // guarantees that the index is inside of the bounds, since checked accesses do not use the pointer.
+    // Returns the pairs of object and index variable of the created pointers.
+    std::vector<std::pair<size_t, size_t>> emit_induction_pointers(CodeGenerator& code_generator, const std::vector<std::pair<size_t, size_t>>& condition_bounds) const {
+        SideEffects loop_effects;
+        this->condition->collect_side_effects(loop_effects);
+        this->body->collect_side_effects(loop_effects);
+
+        std::unordered_map<size_t, size_t> update_counts;
+        std::unordered_set<size_t> non_induction_variables;
+        std::map<std::pair<size_t, size_t>, std::pair<const IndexingExpression *, size_t>> accesses;
+
+        std::function<void(const Expression&)> collect_expression = [&](const Expression& expression) {
+            auto as_binary_expression = dynamic_cast<const BinaryExpression *>(&expression);
+            if (as_binary_expression != nullptr && as_binary_expression->get_operator_token().get_type() == TokenType::EQUAL) {
+                auto as_variable_expression = dynamic_cast<const VariableExpression *>(as_binary_expression->get_left());
+                if (as_variable_expression != nullptr) {
+                    size_t id = as_variable_expression->get_id();
+                    int64_t step;
+                    if (as_binary_expression->get_induction_step(id, step)) {
+                        update_counts[id] += 1;
+                    } else {
+                        non_induction_variables.insert(id);
+                    }
+                }
+            }
+
+            auto as_indexing_expression = dynamic_cast<const IndexingExpression *>(&expression);
+            if (as_indexing_expression != nullptr) {
+                auto object = dynamic_cast<const VariableExpression *>(as_indexing_expression->get_operand());
+                auto index = dynamic_cast<const VariableExpression *>(as_indexing_expression->get_index());
+                if (object != nullptr && index != nullptr && object->is_loop_invariant(loop_effects)) {
+                    auto& access = accesses[{ object->get_id(), index->get_id() }];
+                    access.first = as_indexing_expression;
+                    access.second += 1;
+                }
+            }
+
+            expression.for_each_sub_expression(collect_expression);
+        };
+        std::function<void(const Statement&)> collect_statement = [&](const Statement& statement) {
+            statement.for_each_sub_expression(collect_expression);
+            statement.for_each_sub_statement(collect_statement);
+        };
+        collect_expression(*this->condition);
+        collect_statement(*this->body);
+
+        // Variables defined inside of the loop are not induction variables
+        for (size_t id : loop_effects.get_assigned_variables()) {
+            if (!update_counts.contains(id)) {
+                non_induction_variables.insert(id);
+            }
+        }
+
+        std::vector<std::pair<size_t, size_t>> induction_pointers;
+        for (const auto& [variables, access] : accesses) {
+            const auto& [object_variable, index_variable] = variables;
+            const auto& [indexing_expression, access_count] = access;
+            if (non_induction_variables.contains(index_variable) || access_count <= update_counts[index_variable]) {
+                continue;
+            }
+            if (std::find(condition_bounds.begin(), condition_bounds.end(), variables) == condition_bounds.end()) {
+                continue;
+            }
+            // Already created by an enclosing loop
+            if (code_generator.has_induction_pointer(object_variable, index_variable)) {
+                continue;
+            }
+
+            indexing_expression->emit_element_pointer(code_generator);
+            size_t variable = code_generator.allocate_variable();
+            INT_INST(VWRITE, variable);
+            code_generator.add_induction_pointer(object_variable, index_variable, variable, indexing_expression->get_element_size());
+            induction_pointers.push_back(variables);
+        }
+
+        return induction_pointers;
+    }
+
     virtual void emit(CodeGenerator& code_generator) const override {
+        // Index bounds involving variables that are assigned inside of the loop do not hold in every iteration
+        SideEffects loop_effects;
+        this->condition->collect_side_effects(loop_effects);
+        this->body->collect_side_effects(loop_effects);
+        for (size_t id : loop_effects.get_assigned_variables()) {
+            code_generator.invalidate_index_bounds(id);
+        }
+        auto index_bounds = code_generator.get_index_bounds();
+        std::vector<std::pair<size_t, size_t>> condition_bounds;
+        if (code_generator.is_optimization_enabled("bounds-check-elimination")) {
+            condition_bounds = find_index_bounds(*this->condition, code_generator.get_counting_variables());
+        }
+
+        std::vector<const Expression *> hoisted_expressions;
+        std::vector<size_t> hoisted_data_pointers;
+        if (code_generator.is_optimization_enabled("licm")) {
+            std::tie(hoisted_expressions, hoisted_data_pointers) = this->emit_preheader(code_generator);
+        }
+        std::vector<std::pair<size_t, size_t>> induction_pointers;
+        if (code_generator.is_optimization_enabled("induction-pointers")) {
+            induction_pointers = this->emit_induction_pointers(code_generator, condition_bounds);
+        }
 
         size_t previous_break = code_generator.get_break_label();
         size_t previous_continue = code_generator.get_continue_label();
@@ -359,14 +631,36 @@ public:
         INT_INST(LABEL, continue_label);
         this->condition->emit_condition(code_generator, break_label, after_condition_label);
         INT_INST(LABEL, after_condition_label);
+        for (const auto& [object_variable, index_variable] : condition_bounds) {
+            code_generator.add_index_bound(object_variable, index_variable);
+        }
         this->body->emit(code_generator);
+        code_generator.restrict_index_bounds(index_bounds);
         INT_INST(JUMP, continue_label);
         INT_INST(LABEL, break_label);
         
         code_generator.set_break_label(previous_break);
         code_generator.set_continue_label(previous_continue);
+
+        for (const Expression *expression : hoisted_expressions) {
+            code_generator.remove_hoisted_expression(expression);
+        }
+        for (size_t id : hoisted_data_pointers) {
+            code_generator.remove_hoisted_data_pointer(id);
+        }
+        for (const auto& [object_variable, index_variable] : induction_pointers) {
+            code_generator.remove_induction_pointer(object_variable, index_variable);
+        }
     }
     
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>& callback) const override {
+        callback(*this->condition);
+    }
+
+    virtual void for_each_sub_statement(const std::function<void(const Statement&)>& callback) const override {
+        callback(*this->body);
+    }
+
     ~WhileStatement() {}
 };
 
@@ -393,6 +687,10 @@ public:
         INT_INST(JUMP, code_generator.get_break_label());
     }
 
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>&) const override {}
+
+    virtual void for_each_sub_statement(const std::function<void(const Statement&)>&) const override {}
+
     ~BreakStatement() {}
 };
 
@@ -416,18 +714,22 @@ public:
     }
     
     virtual void emit(CodeGenerator& code_generator) const override {
-        INT_INST(JUMP, code_generator.get_break_label());
+        INT_INST(JUMP, code_generator.get_continue_label());
     }
 
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>&) const override {}
+
+    virtual void for_each_sub_statement(const std::function<void(const Statement&)>&) const override {}
+
     ~ContinueStatement() {}
 };
 
 class ReturnStatement : public Statement {
 private:
-    std::unique_ptr<Expression> return_value;
+    Expression *return_value;
 public:
-    ReturnStatement(const Location& start_location, std::unique_ptr<Expression> return_value)
-        : Statement(start_location), return_value(std::move(return_value))
+    ReturnStatement(const Location& start_location, Expression *return_value)
+        : Statement(start_location), return_value(return_value)
     {}
 
     virtual void append_to_output_stream(std::ostream& output_stream, size_t layer = 0) const override {
@@ -455,6 +757,12 @@ public:
         INST(RET);
     }
     
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>& callback) const override {
+        callback(*this->return_value);
+    }
+
+    virtual void for_each_sub_statement(const std::function<void(const Statement&)>&) const override {}
+
     ~ReturnStatement() {}
 };
 
@@ -484,5 +792,9 @@ public:
         INST(RET);
     }
 
+    virtual void for_each_sub_expression(const std::function<void(const Expression&)>&) const override {}
+
+    virtual void for_each_sub_statement(const std::function<void(const Statement&)>&) const override {}
+
     ~VoidReturnStatement() {}
 };
@@ -0,0 +1,83 @@
+
+// Replaces arithmetic with a constant right operand by cheaper instructions:
+//      x * 2^k -> x << k
+//      x * 1, x / 1, x + 0, x - 0, p + 0, x << 0, x >> 0 -> x
+//
+// Signed division by a power of two can not be replaced by a shift without knowing the sign of the
+// dividend, see BinaryExpression::emit for the cases where it is known.
+class StrengthReducer : public OptimizationPass {
+private:
+    static bool is_power_of_two(int64_t value) {
+        return value > 0 && (value & (value - 1)) == 0;
+    }
+
+    static int64_t log2(int64_t value) {
+        int64_t exponent = 0;
+        while (value > 1) {
+            value >>= 1;
+            exponent += 1;
+        }
+        return exponent;
+    }
+
+    static bool is_neutral_operand(InstructionType type, int64_t operand) {
+        switch (type) {
+            case InstructionType::IMUL:
+            case InstructionType::IDIV:
+                return operand == 1;
+            case InstructionType::IADD:
+            case InstructionType::ISUB:
+            case InstructionType::PADD:
+            case InstructionType::ISHL:
+            case InstructionType::ISHR:
+            case InstructionType::IOR:
+            case InstructionType::IXOR:
+                return operand == 0;
+            default:
+                return false;
+        }
+    }
+
+    void reduce(std::vector<Instruction>& instructions) const {
+        std::vector<Instruction> output;
+        output.reserve(instructions.size());
+
+        for (size_t i = 0; i < instructions.size(); i++) {
+            const Instruction& instruction = instructions[i];
+            if (instruction.get_type() == InstructionType::PUSH && i + 1 < instructions.size()) {
+                InstructionType next_type = instructions[i+1].get_type();
+                int64_t constant = instruction.get_operand().as_int;
+
+                if (is_neutral_operand(next_type, constant)) {
+                    i += 1;
+                    continue;
+                }
+
+                if (next_type == InstructionType::IMUL && is_power_of_two(constant)) {
+                    output.push_back(Instruction(InstructionType::PUSH, Word { .as_int = log2(constant) }));
+                    output.push_back(Instruction(InstructionType::ISHL));
+                    i += 1;
+                    continue;
+                }
+            }
+            output.push_back(instruction);
+        }
+
+        instructions = std::move(output);
+    }
+
+public:
+    StrengthReducer() {}
+
+    virtual const char *get_name() const override {
+        return "strength-reduce";
+    }
+
+    virtual void run(CodeGenerator& code_generator) override {
+        for (auto& function : code_generator.get_functions()) {
+            this->reduce(function.get_instructions());
+        }
+    }
+
+    ~StrengthReducer() {}
+};
@@ -0,0 +1,165 @@
+
+#define TIER_UP_THRESHOLD 1000
+#define NO_FUNCTION SIZE_MAX
+
+// Runs a program that starts without optimization passes and optimizes its hot functions on a background thread.
+//
+// Every call and every backward jump of a function counts towards its hotness. A function that reaches
+// TIER_UP_THRESHOLD is sent to the compiler thread, which runs the enabled passes on a copy of the code generator
+// (once, for all functions) and hands the optimized code of the function back. The optimized code is installed by
+// the virtual machine's thread between two instructions: it is appended to the program and all calls of the function
+// are redirected to it. Running calls finish in the code they started in, so the main function (which is never
+// called again) keeps its unoptimized code.
+class TieringManager : public TieringListener {
+private:
+    PassManager& pass_manager;
+    std::unique_ptr<CodeGenerator> optimized_code_generator;
+    bool is_optimized;
+    size_t main_label;
+
+    // Current location of every function and the function of every unoptimized location (NO_FUNCTION for optimized code)
+    std::unordered_map<size_t, size_t> function_locations;
+    std::vector<size_t> location_functions;
+    std::unordered_map<size_t, uint64_t> hotness;
+    std::unordered_set<size_t> requested_functions;
+
+    // Shared with the compiler thread
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<size_t> requests;
+    std::vector<FunctionCode> optimized_functions;
+    std::atomic<bool> has_optimized_functions;
+    bool is_stopping;
+    std::thread compiler_thread;
+
+    void compile_requests() {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        while (true) {
+            this->condition.wait(lock, [this] { return this->is_stopping || this->requests.size() > 0; });
+            if (this->is_stopping) {
+                return;
+            }
+            size_t label = this->requests.back();
+            this->requests.pop_back();
+            lock.unlock();
+
+            if (!this->is_optimized) {
+                this->pass_manager.run(*this->optimized_code_generator);
+                this->is_optimized = true;
+            }
+
+            const auto& functions = this->optimized_code_generator->get_functions();
+            auto function_indices = collect_function_indices(functions);
+            lock.lock();
+            this->optimized_functions.push_back(functions[function_indices.at(label)]);
+            this->has_optimized_functions.store(true, std::memory_order_release);
+        }
+    }
+
+    void count(VirtualMachine& virtual_machine, size_t label) {
+        if (this->has_optimized_functions.load(std::memory_order_acquire)) {
+            this->install(virtual_machine);
+        }
+
+        if (label == NO_FUNCTION || label == this->main_label || this->requested_functions.contains(label)) {
+            return;
+        }
+        this->hotness[label] += 1;
+        if (this->hotness[label] >= TIER_UP_THRESHOLD) {
+            this->requested_functions.insert(label);
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->requests.push_back(label);
+            this->condition.notify_one();
+        }
+    }
+
+    void install(VirtualMachine& virtual_machine) {
+        std::vector<FunctionCode> functions;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            functions = std::move(this->optimized_functions);
+            this->optimized_functions.clear();
+            this->has_optimized_functions.store(false, std::memory_order_relaxed);
+        }
+
+        for (const auto& function : functions) {
+            std::vector<Instruction> code = function.get_instructions();
+            size_t location = virtual_machine.get_program_size();
+
+            auto label_positions = collect_label_positions(code);
+            for (auto& instruction : code) {
+                if (instruction.get_type() == InstructionType::CALL) {
+                    size_t callee_location = this->function_locations.at((size_t) instruction.get_operand().as_int);
+                    instruction.set_operand(Word { .as_int = (int64_t) callee_location });
+                } else if (is_branch_instruction(instruction.get_type())) {
+                    size_t target = location + label_positions.at(instruction.get_operand().as_int);
+                    instruction.set_operand(Word { .as_int = (int64_t) target });
+                }
+            }
+
+            virtual_machine.append_code(code);
+            this->location_functions.resize(virtual_machine.get_program_size(), NO_FUNCTION);
+            virtual_machine.redirect_calls(this->function_locations.at(function.get_label()), location);
+            this->function_locations[function.get_label()] = location;
+        }
+    }
+
+public:
+    // The code generator holds the emitted code of the program before any pass was run
+    TieringManager(PassManager& pass_manager, const CodeGenerator& code_generator)
+        : pass_manager(pass_manager),
+          optimized_code_generator(std::make_unique<CodeGenerator>(code_generator)),
+          is_optimized(false),
+          main_label(code_generator.get_main_label()),
+          function_locations(),
+          location_functions(),
+          hotness(),
+          requested_functions(),
+          mutex(),
+          condition(),
+          requests(),
+          optimized_functions(),
+          has_optimized_functions(false),
+          is_stopping(false),
+          compiler_thread()
+    {
+        this->optimized_code_generator->set_keeps_uncalled_functions(true);
+    }
+
+    // Runs the finalized code of the code generator the manager was created with
+    void execute(CodeGenerator& code_generator) {
+        const auto& functions = code_generator.get_functions();
+        std::vector<Instruction> program = code_generator.get_program();
+        this->location_functions.resize(program.size(), NO_FUNCTION);
+        for (size_t i = 0; i < functions.size(); i++) {
+            size_t location = code_generator.get_function_location(i);
+            this->function_locations[functions[i].get_label()] = location;
+            std::fill_n(this->location_functions.begin() + location, functions[i].get_instructions().size(), functions[i].get_label());
+        }
+
+        this->compiler_thread = std::thread(&TieringManager::compile_requests, this);
+        VirtualMachine virtual_machine(std::move(program), code_generator.get_static_data());
+        virtual_machine.execute_tiered(*this);
+    }
+
+    virtual void on_call(VirtualMachine& virtual_machine, size_t target) override {
+        this->count(virtual_machine, this->location_functions[target]);
+    }
+
+    virtual void on_back_edge(VirtualMachine& virtual_machine, size_t location) override {
+        this->count(virtual_machine, this->location_functions[location]);
+    }
+
+    TieringManager(const TieringManager& other) = delete;
+
+    ~TieringManager() {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->is_stopping = true;
+        }
+        this->condition.notify_one();
+        if (this->compiler_thread.joinable()) {
+            this->compiler_thread.join();
+        }
+    }
+};
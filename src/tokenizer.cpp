@@ -1,39 +1,165 @@
 
-class Location {
+#define IO_ERROR(path, message) \
+    do { \
+        std::cerr << "IOError: " << message << " " << (path) << std::endl; \
+        std::exit(1); \
+    } while (0)
+
+// Source file that is mapped into memory read-only, tokens refer to their text inside of the mapping
+class SourceFile {
 private:
-    size_t row, col;
-    std::string file_name;
+    std::string path;
+    void *mapping;
+    size_t size;
+    // Offset of the first character of every line, built when the first location of the file is printed
+    mutable std::vector<uint32_t> line_starts;
 public:
-    Location(size_t row, size_t col, const std::string& file_name)
-        : row(row), col(col), file_name(file_name)
-    {}
+    SourceFile(const std::string& path)
+        : path(path), mapping(MAP_FAILED), size(0), line_starts()
+    {
+        int file_descriptor = open(path.c_str(), O_RDONLY);
+        struct stat file_status;
+        if (file_descriptor < 0 || fstat(file_descriptor, &file_status) < 0) {
+            IO_ERROR(path, "Failed to load file");
+        }
+
+        // Offsets into the source are stored in 32 bits
+        this->size = (size_t) file_status.st_size;
+        if (this->size > UINT32_MAX) {
+            IO_ERROR(path, "File is too large");
+        }
+
+        // Empty files can not be mapped
+        if (this->size > 0) {
+            this->mapping = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+            if (this->mapping == MAP_FAILED) {
+                IO_ERROR(path, "Failed to map file");
+            }
+        }
+        close(file_descriptor);
+    }
 
-    void advance_line() {
-        this->col = 1;
-        this->row += 1;
+    SourceFile(const SourceFile& other) = delete;
+
+    const std::string& get_path() const {
+        return this->path;
+    }
+
+    std::string_view get_source() const {
+        if (this->mapping == MAP_FAILED) {
+            return std::string_view();
+        }
+        return std::string_view((const char *) this->mapping, this->size);
     }
 
-    void advance_col() {
-        this->col += 1;
+    // Row and column of the character at the offset, both start at 1
+    std::pair<size_t, size_t> get_row_and_col(uint32_t offset) const {
+        if (this->line_starts.empty()) {
+            std::string_view source = this->get_source();
+            this->line_starts.push_back(0);
+            for (size_t i = 0; i < source.size(); i++) {
+                if (source[i] == '\n') {
+                    this->line_starts.push_back((uint32_t) (i + 1));
+                }
+            }
+        }
+
+        auto line = std::upper_bound(this->line_starts.begin(), this->line_starts.end(), offset) - 1;
+        return { (size_t) (line - this->line_starts.begin()) + 1, (size_t) (offset - *line) + 1 };
+    }
+
+    ~SourceFile() {
+        if (this->mapping != MAP_FAILED) {
+            munmap(this->mapping, this->size);
+        }
+    }
+};
+
+// Interned source files of the compilation, locations and tokens refer to a file by its id.
+// The files stay mapped until the compiler exits, so tokens can be kept as long as they are needed.
+class FileTable {
+private:
+    static FileTable instance;
+
+    std::vector<std::unique_ptr<SourceFile>> files;
+    std::unordered_map<std::string, uint32_t> file_ids;
+
+    FileTable() : files(), file_ids() {}
+
+public:
+    FileTable(FileTable& other) = delete;
+
+    static FileTable& get() {
+        return instance;
+    }
+
+    // Maps the file the first time it is added, exits if it can not be read
+    uint32_t add_file(const std::string& path) {
+        auto file_id = this->file_ids.find(path);
+        if (file_id != this->file_ids.end()) {
+            return file_id->second;
+        }
+
+        uint32_t id = (uint32_t) this->files.size();
+        this->files.push_back(std::make_unique<SourceFile>(path));
+        this->file_ids[path] = id;
+        return id;
+    }
+
+    const std::string& get_path(uint32_t id) const {
+        return this->files[id]->get_path();
+    }
+
+    std::string_view get_source(uint32_t id) const {
+        return this->files[id]->get_source();
+    }
+
+    std::pair<size_t, size_t> get_row_and_col(uint32_t id, uint32_t offset) const {
+        return this->files[id]->get_row_and_col(offset);
+    }
+
+    ~FileTable() {}
+};
+
+FileTable FileTable::instance;
+
+// Position in a source file, it is copied into every token and node of the syntax tree so it only stores the
+// offset of the character. Row and column are looked up in the line index of the file when they are printed.
+class Location {
+private:
+    uint32_t offset;
+    uint32_t file_id;
+public:
+    Location(uint32_t offset, uint32_t file_id)
+        : offset(offset), file_id(file_id)
+    {}
+
+    uint32_t get_offset() const {
+        return this->offset;
     }
 
     size_t get_row() const {
-        return this->row;
+        return FileTable::get().get_row_and_col(this->file_id, this->offset).first;
     }
     
     size_t get_col() const {
-        return this->col;
+        return FileTable::get().get_row_and_col(this->file_id, this->offset).second;
     }
     
+    uint32_t get_file_id() const {
+        return this->file_id;
+    }
+
     const std::string& get_file_name() const {
-        return this->file_name;
+        return FileTable::get().get_path(this->file_id);
     }
 
     ~Location() {}
 };
 
 std::ostream& operator<<(std::ostream& output_stream, const Location& location) {
-    output_stream << location.get_file_name() << ":" << location.get_row() << ":" << location.get_col(); 
+    const auto& [row, col] = FileTable::get().get_row_and_col(location.get_file_id(), location.get_offset());
+    output_stream << location.get_file_name() << ":" << row << ":" << col;
     return output_stream;
 }
 
@@ -68,6 +194,7 @@ std::ostream& operator<<(std::ostream& output_stream, const Location& location)
     TOKEN_TYPE_ENTRY(PIPE_PIPE) \
     TOKEN_TYPE_ENTRY(EQUAL) \
     TOKEN_TYPE_ENTRY(HASH_TAG) \
+    TOKEN_TYPE_ENTRY(AT) \
     \
     TOKEN_TYPE_ENTRY(OPEN_PARENTHESIS) \
     TOKEN_TYPE_ENTRY(CLOSE_PARENTHESIS) \
@@ -119,22 +246,23 @@ std::ostream& operator<<(std::ostream& output_stream, const TokenType& token_typ
 
 #undef TOKEN_TYPE_ENTRY
 
+// The text of a token is not copied, it is the range of the given length at its location in the source
 class Token {
 private:
     TokenType type;
-    std::string text;
+    uint32_t length;
     Location location;
 public:
-    Token(TokenType type, const std::string& text, const Location& location)
-        : type(type), text(text), location(location)
+    Token(TokenType type, uint32_t length, const Location& location)
+        : type(type), length(length), location(location)
     {}
 
     TokenType get_type() const {
         return this->type;
     }
 
-    const std::string& get_text() const {
-        return this->text;
+    std::string_view get_text() const {
+        return FileTable::get().get_source(this->location.get_file_id()).substr(this->location.get_offset(), this->length);
     }
 
     const Location& get_location() const {
@@ -154,15 +282,11 @@ std::ostream& operator<<(std::ostream& output_stream, const Token& token) {
 
 
 std::string read_file_as_string(const std::string& file_path) {
-    std::ifstream file_stream(file_path);
+    std::ifstream file_stream(file_path, std::ios::binary);
     if (file_stream.fail()) {
-        std::cerr << "IOError: Failed to load file " << file_path << std::endl;
-        std::exit(1);
+        IO_ERROR(file_path, "Failed to load file");
     }
-    std::stringstream string_buffer;
-    string_buffer << file_stream.rdbuf();
-    file_stream.close();
-    return string_buffer.str();
+    return std::string(std::istreambuf_iterator<char>(file_stream), std::istreambuf_iterator<char>());
 }
 
 #define LEX_ERROR(location, message) \
@@ -171,16 +295,34 @@ std::string read_file_as_string(const std::string& file_path) {
         std::exit(1); \
     } while (0)
 
+#define TOKEN_BUFFER_SIZE 4
+
+// Produces the tokens of a source file on demand. The parser looks at the next TOKEN_BUFFER_SIZE tokens at most,
+// only those are kept in a ring buffer, so the memory used does not depend on the size of the file.
 class Tokenizer {
 private:
-    const std::string source;
-    Location current_location;
+    uint32_t file_id;
+    std::string_view source;
     size_t source_pointer;
-    std::unordered_map<std::string, TokenType> keyword_table;
+    std::unordered_map<std::string_view, TokenType> keyword_table;
+
+    std::vector<Token> token_buffer;
+    size_t buffer_start;
+    size_t buffered_token_count;
 
 public:
     Tokenizer(const std::string& file_path)
-        : source(read_file_as_string(file_path)), current_location(1,1, file_path), source_pointer(0)
+        : Tokenizer(FileTable::get().add_file(file_path), 0)
+    {}
+
+    // Starts tokenizing at the offset of the source of the file
+    Tokenizer(uint32_t file_id, size_t start_pointer)
+        : file_id(file_id),
+          source(FileTable::get().get_source(file_id)),
+          source_pointer(start_pointer),
+          token_buffer(TOKEN_BUFFER_SIZE, Token(TokenType::END_OF_FILE, 0, Location(0, file_id))),
+          buffer_start(0),
+          buffered_token_count(0)
     {
         this->keyword_table = {
             { "true", TokenType::TRUE_KEYWORD },
@@ -204,7 +346,7 @@ public:
 
 private:
     char current_char() const {
-        if (this->source_pointer > this->source.length()) {
+        if (this->source_pointer >= this->source.length()) {
             return '\0';
         }
         
@@ -212,243 +354,215 @@ private:
     }
 
     void advance_char() {
-        if (this->current_char() == '\n') {
-            this->current_location.advance_line();
-        } else {
-            this->current_location.advance_col();
-        }
         this->source_pointer += 1;
     }
 
-    static bool is_name_character(char c) {
-        return std::isalnum(c) || std::isdigit(c) || c == '_';  
+    Location get_location(size_t pointer) const {
+        return Location((uint32_t) pointer, this->file_id);
+    }
+
+    // Token for the source from start_pointer up to the current character
+    Token make_token(TokenType type, size_t start_pointer) const {
+        return Token(type, (uint32_t) (this->source_pointer - start_pointer), this->get_location(start_pointer));
+    }
+
+    Token single_char_token(TokenType type) {
+        size_t start_pointer = this->source_pointer;
+        this->advance_char();
+        return this->make_token(type, start_pointer);
     }
 
     Token next_token() {
-        while (std::isspace(this->current_char())) {
-            this->advance_char();
-        }
+        this->source_pointer = skip_whitespace(this->source, this->source_pointer);
         
         switch (this->current_char()) {
             case '+':
                 {
-                    Token plus_token = Token(TokenType::PLUS, "+", this->current_location);
-                    this->advance_char();
-                    return plus_token;
+                    return this->single_char_token(TokenType::PLUS);
                 }
             
             case '-':
                 {
-                    Token minus_token = Token(TokenType::MINUS, "-", this->current_location);
-                    this->advance_char();
-                    return minus_token;
+                    return this->single_char_token(TokenType::MINUS);
                 }
             
             case '*':
                 {
-                    Token star_token = Token(TokenType::STAR, "*", this->current_location);
-                    this->advance_char();
-                    return star_token;
+                    return this->single_char_token(TokenType::STAR);
                 }
             
             case '/':
                 {
-                    Location start_location = this->current_location;
+                    size_t start_pointer = this->source_pointer;
                     this->advance_char();
                     if (this->current_char() == '/') {
-                        while (this->current_char() != '\n' && this->current_char() != '\0') {
-                            this->advance_char();
-                        }
+                        this->source_pointer = skip_line(this->source, this->source_pointer);
                         return next_token();
                     } else {
-                        return Token(TokenType::SLASH, "/", start_location);
+                        return this->make_token(TokenType::SLASH, start_pointer);
                     }
                 }
             
             case '!': 
                 {
-                    Location token_location = this->current_location;
+                    size_t start_pointer = this->source_pointer;
                     this->advance_char();
                     if (this->current_char() == '=') {
                         this->advance_char();
-                        return Token(TokenType::BANG_EQUAL, "!=", token_location);
+                        return this->make_token(TokenType::BANG_EQUAL, start_pointer);
                     } else {
-                        return Token(TokenType::BANG, "!", token_location);
+                        return this->make_token(TokenType::BANG, start_pointer);
                     }
                 }
             
             case '~':
                 {
-                    Token tilde_token = Token(TokenType::TILDE, "~", this->current_location);
-                    this->advance_char();
-                    return tilde_token;
+                    return this->single_char_token(TokenType::TILDE);
                 }
             
             case '%':
                 {
-                    Token percent_token = Token(TokenType::PERCENT, "%", this->current_location);
-                    this->advance_char();
-                    return percent_token;
+                    return this->single_char_token(TokenType::PERCENT);
                 }
             
             case '<': 
                 {
-                    Location token_location = this->current_location;
+                    size_t start_pointer = this->source_pointer;
                     this->advance_char();
                     if (this->current_char() == '<') {
                         this->advance_char();
-                        return Token(TokenType::LESS_LESS, "<<", token_location);
+                        return this->make_token(TokenType::LESS_LESS, start_pointer);
                     } else if (this->current_char() == '=') {
                         this->advance_char();
-                        return Token(TokenType::LESS_EQUAL, "<=", token_location);
+                        return this->make_token(TokenType::LESS_EQUAL, start_pointer);
                     } else {
-                        return Token(TokenType::LESS, "<", token_location);
+                        return this->make_token(TokenType::LESS, start_pointer);
                     }
                 }
             
             case '>':
                 {
-                    Location token_location = this->current_location;
+                    size_t start_pointer = this->source_pointer;
                     this->advance_char();
                     if (this->current_char() == '>') {
                         this->advance_char();
-                        return Token(TokenType::GREATER_GREATER, ">>", token_location);
+                        return this->make_token(TokenType::GREATER_GREATER, start_pointer);
                     } else if (this->current_char() == '=') {
                         this->advance_char();
-                        return Token(TokenType::GREATER_EQUAL, ">=", token_location);
+                        return this->make_token(TokenType::GREATER_EQUAL, start_pointer);
                     } else {
-                        return Token(TokenType::GREATER, ">", token_location);
+                        return this->make_token(TokenType::GREATER, start_pointer);
                     }
                 }
             
             case '=':
                 {
-                    Location token_location = this->current_location;
+                    size_t start_pointer = this->source_pointer;
                     this->advance_char();
                     if (this->current_char() == '=') {
                         this->advance_char();
-                        return Token(TokenType::EQUAL_EQUAL, "==", token_location);
+                        return this->make_token(TokenType::EQUAL_EQUAL, start_pointer);
                     } else {
-                        return Token(TokenType::EQUAL, "=", token_location);
+                        return this->make_token(TokenType::EQUAL, start_pointer);
                     }
                 }
             
             case '&':
                 {
-                    Location token_location = this->current_location;
+                    size_t start_pointer = this->source_pointer;
                     this->advance_char();
                     if (this->current_char() == '&') {
                         this->advance_char();
-                        return Token(TokenType::AND_AND, "&&", token_location);
+                        return this->make_token(TokenType::AND_AND, start_pointer);
                     } else {
-                        return Token(TokenType::AND, "&", token_location);
+                        return this->make_token(TokenType::AND, start_pointer);
                     }
                 }
             
             case '|':
                 {
-                    Location token_location = this->current_location;
+                    size_t start_pointer = this->source_pointer;
                     this->advance_char();
                     if (this->current_char() == '|') {
                         this->advance_char();
-                        return Token(TokenType::PIPE_PIPE, "||", token_location);
+                        return this->make_token(TokenType::PIPE_PIPE, start_pointer);
                     } else {
-                        return Token(TokenType::PIPE, "|", token_location);
+                        return this->make_token(TokenType::PIPE, start_pointer);
                     }
                 }
             
             case '#':
                 {
-                    Location token_location = this->current_location;
-                    this->advance_char();
-                    return Token(TokenType::HASH_TAG, "#", token_location);
+                    return this->single_char_token(TokenType::HASH_TAG);
+                }
+
+            case '@':
+                {
+                    return this->single_char_token(TokenType::AT);
                 }
             
             case '^':
                 {
-                    Location token_location = this->current_location;
-                    this->advance_char();
-                    return Token(TokenType::HAT, "^", token_location);
+                    return this->single_char_token(TokenType::HAT);
                 }
             
             case ',':
                 {
-                    Token comma_token = Token(TokenType::COMMA, ",", this->current_location);
-                    this->advance_char();
-                    return comma_token;
+                    return this->single_char_token(TokenType::COMMA);
                 }
             
             case ';':
                 {
-                    Token semi_colon_token = Token(TokenType::SEMI_COLON, ";", this->current_location);
-                    this->advance_char();
-                    return semi_colon_token;
+                    return this->single_char_token(TokenType::SEMI_COLON);
                 }
             
             case ':':
                 {
-                    Token colon_token = Token(TokenType::COLON, ":", this->current_location);
-                    this->advance_char();
-                    return colon_token;
+                    return this->single_char_token(TokenType::COLON);
                 }
             
             case '.':
                 {
-                    Token dot_token = Token(TokenType::DOT, ".", this->current_location);
-                    this->advance_char();
-                    return dot_token;
+                    return this->single_char_token(TokenType::DOT);
                 }
             
             case '(':
                 {
-                    Token open_parenthesis_token = Token(TokenType::OPEN_PARENTHESIS, "(", this->current_location);
-                    this->advance_char();
-                    return open_parenthesis_token;
+                    return this->single_char_token(TokenType::OPEN_PARENTHESIS);
                 }
             
             case ')':
                 {
-                    Token close_parenthesis_token = Token(TokenType::CLOSE_PARENTHESIS, "(", this->current_location);
-                    this->advance_char();
-                    return close_parenthesis_token;
+                    return this->single_char_token(TokenType::CLOSE_PARENTHESIS);
                 }
             
             case '{':
                 {
-                    Token open_curly_brace_token = Token(TokenType::OPEN_CURLY_BRACE, "{", this->current_location);
-                    this->advance_char();
-                    return open_curly_brace_token;
+                    return this->single_char_token(TokenType::OPEN_CURLY_BRACE);
                 }
             
             case '}':
                 {
-                    Token close_curly_brace_token = Token(TokenType::CLOSE_CURLY_BRACE, "}", this->current_location);
-                    this->advance_char();
-                    return close_curly_brace_token;
+                    return this->single_char_token(TokenType::CLOSE_CURLY_BRACE);
                 }
             
             case '[':
                 {
-                    Token open_square_bracket_token = Token(TokenType::OPEN_SQUARE_BRACKET, "[", this->current_location);
-                    this->advance_char();
-                    return open_square_bracket_token;
+                    return this->single_char_token(TokenType::OPEN_SQUARE_BRACKET);
                 }
             
             case ']':
                 {
-                    Token close_square_bracket_token = Token(TokenType::CLOSE_SQUARE_BRACKET, "]", this->current_location);
-                    this->advance_char();
-                    return close_square_bracket_token;
+                    return this->single_char_token(TokenType::CLOSE_SQUARE_BRACKET);
                 }
 
             case '\0':
                 {
-                    return Token(TokenType::END_OF_FILE, "", this->current_location);
+                    return this->make_token(TokenType::END_OF_FILE, this->source_pointer);
                 }
 
             case '"':
                 {
-                    Location start_location = this->current_location;
                     size_t start_pointer = this->source_pointer;
                     char last_char = this->current_char();
                     this->advance_char();
@@ -458,18 +572,15 @@ private:
                     }
                     
                     if (this->current_char() != '"') {
-                        LEX_ERROR(start_location, "Unterminated string literal.");
+                        LEX_ERROR(this->get_location(start_pointer), "Unterminated string literal.");
                     }
 
                     this->advance_char();
-                    size_t end_pointer = this->source_pointer;
-                    std::string string_literal_string = source.substr(start_pointer, end_pointer - start_pointer);
-                    return Token(TokenType::STRING_LITERAL, string_literal_string, start_location);
+                    return this->make_token(TokenType::STRING_LITERAL, start_pointer);
                 }
             
             case '\'':
                 {
-                    Location start_location = this->current_location;
                     size_t start_pointer = this->source_pointer;
                     char last_char = this->current_char();
                     this->advance_char();
@@ -479,21 +590,18 @@ private:
                     }
                     
                     if (this->current_char() != '\'') {
-                        LEX_ERROR(start_location, "Unterminated char literal.");
+                        LEX_ERROR(this->get_location(start_pointer), "Unterminated char literal.");
                     }
 
                     this->advance_char();
-                    size_t end_pointer = this->source_pointer;
-                    std::string char_literal_string = source.substr(start_pointer, end_pointer - start_pointer);
-                    return Token(TokenType::CHAR_LITERAL, char_literal_string, start_location);
+                    return this->make_token(TokenType::CHAR_LITERAL, start_pointer);
                 }
             
             default:
                 {
                     if (std::isdigit(this->current_char())) {
                         size_t start_pointer = this->source_pointer;
-                        Location start_location = this->current_location;
-                        
+                            
                         while (std::isdigit(this->current_char())) {
                             this->advance_char();
                         }
@@ -507,51 +615,49 @@ private:
                             }
 
                             if (decimal_count == 0) {
-                                LEX_ERROR(start_location, "Float literal is expected to have at least one decimal.");
+                                LEX_ERROR(this->get_location(start_pointer), "Float literal is expected to have at least one decimal.");
                             }
 
-                            size_t end_pointer = this->source_pointer;
-                            std::string float_literal_string = this->source.substr(start_pointer, end_pointer-start_pointer);
-                            return Token(TokenType::FLOAT_LITERAL, float_literal_string, start_location);
+                            return this->make_token(TokenType::FLOAT_LITERAL, start_pointer);
                         } else {
-                            size_t end_pointer = this->source_pointer;
-                            std::string int_literal_string = this->source.substr(start_pointer, end_pointer-start_pointer);
-                            return Token(TokenType::INT_LITERAL, int_literal_string, start_location);
+                            return this->make_token(TokenType::INT_LITERAL, start_pointer);
                         }
                     } else if (is_name_character(this->current_char())) {
                         size_t start_pointer = this->source_pointer;
-                        Location start_location = this->current_location;
-                        
-                        while (is_name_character(this->current_char())) {
-                            this->advance_char();
-                        }
+                            
+                        this->source_pointer = skip_name_characters(this->source, this->source_pointer);
                         
-                        size_t end_pointer = this->source_pointer;
-                        std::string name_string = this->source.substr(start_pointer, end_pointer-start_pointer);
-                        if (this->keyword_table.contains(name_string)) {
-                            return Token(this->keyword_table[name_string], name_string, start_location);
+                        std::string_view name_string = this->source.substr(start_pointer, this->source_pointer - start_pointer);
+                        auto keyword = this->keyword_table.find(name_string);
+                        if (keyword != this->keyword_table.end()) {
+                            return this->make_token(keyword->second, start_pointer);
                         } else {
-                            return Token(TokenType::NAME, name_string, start_location);
+                            return this->make_token(TokenType::NAME, start_pointer);
                         }
                     } else {
-                        LEX_ERROR(this->current_location, "Unexpected character '" << this->current_char() << "'.");
+                        LEX_ERROR(this->get_location(this->source_pointer), "Unexpected character '" << this->current_char() << "'.");
                     }
                 }
         }
     }
 
 public:
-    std::vector<Token> collect_tokens() {
-        std::vector<Token> token_vector;
-        
-        for(;;) {
-            Token next = this->next_token();
-            token_vector.push_back(next);
-            if (next.get_type() == TokenType::END_OF_FILE)
-                break;
-        } 
-
-        return token_vector;
+    // Token 'lookahead' tokens after the current one, the reference is valid until the tokenizer advances past it.
+    // Once the end of the file is reached END_OF_FILE tokens are returned.
+    const Token& peek_token(size_t lookahead = 0) {
+        assert(lookahead < TOKEN_BUFFER_SIZE);
+        while (this->buffered_token_count <= lookahead) {
+            size_t index = (this->buffer_start + this->buffered_token_count) % TOKEN_BUFFER_SIZE;
+            this->token_buffer[index] = this->next_token();
+            this->buffered_token_count += 1;
+        }
+        return this->token_buffer[(this->buffer_start + lookahead) % TOKEN_BUFFER_SIZE];
+    }
+
+    void advance_token() {
+        (void) this->peek_token();
+        this->buffer_start = (this->buffer_start + 1) % TOKEN_BUFFER_SIZE;
+        this->buffered_token_count -= 1;
     }
 
     ~Tokenizer() {}
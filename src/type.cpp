@@ -1,8 +1,9 @@
 
 #define TYPE_ERROR(message) \
     do { \
+        ParallelTasks::get().begin_error(); \
         std::cerr << this->get_location() << ": TYPE_ERROR: " << message << std::endl; \
-        std::exit(1); \
+        ParallelTasks::get().exit_after_error(); \
     } while(0)
 
 class Type;
@@ -24,7 +25,7 @@ public:
     {}
 
     FieldAccess get_access() const { return this->access; }
-    std::shared_ptr<Type> get_type() const { return this->type; }
+    const std::shared_ptr<Type>& get_type() const { return this->type; }
     size_t get_alignment() const { return this->alignment; }
 };
 
@@ -36,24 +37,41 @@ public:
     PRIMITIVE_ENTRY(FLOAT) \
     PRIMITIVE_ENTRY(BOOL) \
 
+// Types are interned: every distinct type exists only once and has a small id, so two types are equal exactly
+// if their ids are. List types and type parameters are created with ListType::get and TypeParameterType::get.
 class Type {
     friend class PrimitiveType;
     friend class ListType;
     friend class GenericType;
+    friend class TypeParameterType;
+private:
+    static size_t type_count;
+    // Guards type_count and the tables of ListType and TypeParameterType, since functions are type checked and emitted on several threads
+    static std::mutex table_mutex;
 protected:
     enum class TypeType {
         LIST,
         PRIMITIVE,
         GENERIC,
+        PARAMETER,
         INTERNAL,
         NO_TYPE
     };
 
     TypeType type_type;
-    std::unordered_map<std::string, std::unique_ptr<Field>> fields;
+    size_t id;
+    // Every field gets a fixed slot when the type is created. Member accesses look the name up once while they are
+    // type checked and use the slot from then on. Field names are string literals.
+    std::vector<std::unique_ptr<Field>> fields;
+    std::unordered_map<std::string_view, size_t> field_slots;
+
+    // Checks whether a value of the other type can be used where this type is expected, the types are never equal
+    virtual bool fits_other_type(const Type& other) const = 0;
 
 public:
-    Type(TypeType type_type) : type_type(type_type) {}
+    Type(TypeType type_type) : type_type(type_type), id(type_count++), fields(), field_slots() {}
+
+    Type(const Type& other) = delete;
 
 #define PRIMITIVE_ENTRY(x) static std::shared_ptr<Type> x;
     PRIMITIVE_LIST
@@ -62,23 +80,39 @@ public:
     static std::shared_ptr<Type> NO;
     static std::shared_ptr<Type> GENERIC;
 
+    size_t get_id() const {
+        return this->id;
+    }
+
+    // Checks whether a value of the other type can be used where this type is expected
+    bool fits(const std::shared_ptr<Type>& other) const {
+        return this->id == other->id || this->fits_other_type(*other);
+    }
+
     virtual std::string to_string() const = 0;
-    virtual bool fits(std::shared_ptr<Type> other) const = 0;
     virtual bool is_generic() const = 0;
     virtual bool is_object() const = 0;
     virtual size_t get_size() const = 0;
     virtual size_t get_layout_index() const = 0;
 
-    bool has_field(const std::string& field_name) const {
-        return this->fields.contains(field_name);
+    // Returns false if the type has no field with this name
+    bool find_field_slot(std::string_view field_name, size_t& slot) const {
+        auto field_slot = this->field_slots.find(field_name);
+        if (field_slot == this->field_slots.end()) {
+            return false;
+        }
+        slot = field_slot->second;
+        return true;
     }
 
-    const std::unique_ptr<Field>& get_field(const std::string& field_name) const {
-        return this->fields.at(field_name);
+    const std::unique_ptr<Field>& get_field(size_t slot) const {
+        return this->fields[slot];
     }
 
-    void add_field(const std::string& field_name, FieldAccess access, std::shared_ptr<Type> type, size_t current_alignment) {
-        this->fields[field_name] = std::make_unique<Field>(access, type, current_alignment);
+    void add_field(std::string_view field_name, FieldAccess access, std::shared_ptr<Type> type, size_t current_alignment) {
+        assert(!this->field_slots.contains(field_name));
+        this->field_slots[field_name] = this->fields.size();
+        this->fields.push_back(std::make_unique<Field>(access, type, current_alignment));
         //if (type->is_object()) {
         //    current_alignment += sizeof(Word);
         //} else {
@@ -86,8 +120,8 @@ public:
         //}
     }
 
-    void add_index_field(const std::string& index_field_name, FieldAccess access, std::shared_ptr<Type> type) {
-        this->fields["@index"] = std::make_unique<Field>(access, type, this->fields[index_field_name]->get_alignment());
+    void add_index_field(std::string_view index_field_name, FieldAccess access, std::shared_ptr<Type> type) {
+        this->add_field("@index", access, type, this->fields[this->field_slots.at(index_field_name)]->get_alignment());
     }
 
     //std::shared_ptr<ObjectLayout> get_layout() const {
@@ -105,6 +139,9 @@ public:
     virtual ~Type() {}
 };
 
+size_t Type::type_count = 0;
+std::mutex Type::table_mutex;
+
 
 // Predefined object layouts
 // -> P = Primitive
@@ -119,7 +156,7 @@ public:
         assert(false && "unreachable");
     }
 
-    virtual bool fits(std::shared_ptr<Type>) const override {
+    virtual bool fits_other_type(const Type&) const override {
         assert(false && "unreachable");
     }
 
@@ -155,7 +192,7 @@ public:
         return "INTERNAL";
     }
 
-    virtual bool fits(std::shared_ptr<Type>) const override {
+    virtual bool fits_other_type(const Type&) const override {
         assert(false && "unreachable");
     }
 
@@ -180,7 +217,9 @@ class ListType : public Type {
 private:
     std::shared_ptr<Type> inner_type;
     static std::shared_ptr<Type> internal_array_type;
-public:
+    // List types by the id of their inner type
+    static std::unordered_map<size_t, std::shared_ptr<Type>> list_types;
+
     ListType(std::shared_ptr<Type> inner_type)
         : Type(Type::TypeType::LIST), inner_type(inner_type)
     {
@@ -193,22 +232,32 @@ public:
         this->add_index_field("data", FieldAccess::READ_WRITE, inner_type);
     }
 
+    virtual bool fits_other_type(const Type& other) const override {
+        if (other.type_type == Type::TypeType::GENERIC) return true;
+        if (other.type_type == Type::TypeType::LIST) {
+            return this->inner_type->fits(static_cast<const ListType&>(other).inner_type);
+        } else {
+            return false;
+        }
+    }
+
+public:
+    static const std::shared_ptr<Type>& get(const std::shared_ptr<Type>& inner_type) {
+        std::lock_guard<std::mutex> lock(Type::table_mutex);
+        auto& list_type = list_types[inner_type->get_id()];
+        if (list_type == nullptr) {
+            list_type = std::shared_ptr<Type>(new ListType(inner_type));
+        }
+        return list_type;
+    }
+
     virtual std::string to_string() const override {
         return "[" + inner_type->to_string() + "]";
     }
 
-    std::shared_ptr<Type> get_inner_type() const {
+    const std::shared_ptr<Type>& get_inner_type() const {
         return this->inner_type;
     }
-    
-    virtual bool fits(std::shared_ptr<Type> other) const override {
-        if (other->type_type == Type::TypeType::GENERIC) return true;
-        if (other->type_type == Type::TypeType::LIST) {
-            return this->inner_type->fits(dynamic_cast<ListType*>(other.get())->inner_type);
-        } else {
-            return false;
-        }
-    }
 
     virtual bool is_generic() const override {
         return this->inner_type->is_generic();
@@ -230,6 +279,7 @@ public:
 };
 
 std::shared_ptr<Type> ListType::internal_array_type = std::make_shared<InternalType>(0, true);
+std::unordered_map<size_t, std::shared_ptr<Type>> ListType::list_types;
 
 
 #define PRIMITIVE_ENTRY(x) x,
@@ -274,13 +324,9 @@ public:
         return output.str();
     }
     
-    virtual bool fits(std::shared_ptr<Type> other) const override {
-        if (other->type_type == Type::TypeType::GENERIC && this->primitive_type != Primitive::VOID) return true;
-        if (other->type_type == Type::TypeType::PRIMITIVE) {
-            return this->primitive_type == dynamic_cast<PrimitiveType*>(other.get())->primitive_type;
-        } else {
-            return false;
-        }
+    virtual bool fits_other_type(const Type& other) const override {
+        // Primitive types are only created once, so other primitive types never fit
+        return other.type_type == Type::TypeType::GENERIC && this->primitive_type != Primitive::VOID;
     }
 
     virtual bool is_generic() const override {
@@ -343,9 +389,9 @@ public:
         return "GENERIC";
     }
 
-    virtual bool fits(std::shared_ptr<Type> other_type) const override {
-        if (other_type->type_type == Type::TypeType::PRIMITIVE) {
-            auto other_primitive_type = dynamic_cast<PrimitiveType*>(other_type.get())->primitive_type;
+    virtual bool fits_other_type(const Type& other_type) const override {
+        if (other_type.type_type == Type::TypeType::PRIMITIVE) {
+            auto other_primitive_type = static_cast<const PrimitiveType&>(other_type).primitive_type;
             if (other_primitive_type == Primitive::VOID) {
                 return false;
             }
@@ -372,6 +418,115 @@ public:
     ~GenericType() {}
 };
 
+// Type parameter of a generic function like 'T' in 'fun swap<T>(xs: [T], i: int, j: int): void'.
+// It only appears in the signature of the generic function, every instance of the function is
+// type checked with concrete types (see GenericFunctionDefinition).
+class TypeParameterType : public Type {
+private:
+    std::string name;
+    size_t index;
+    static std::map<std::pair<std::string, size_t>, std::shared_ptr<Type>> type_parameter_types;
+
+    TypeParameterType(const std::string& name, size_t index)
+        : Type(Type::TypeType::PARAMETER), name(name), index(index)
+    {}
+
+    virtual bool fits_other_type(const Type& other) const override {
+        if (other.type_type == Type::TypeType::PARAMETER) {
+            return this->index == static_cast<const TypeParameterType&>(other).index;
+        }
+        return other.type_type == Type::TypeType::GENERIC;
+    }
+
+public:
+    static const std::shared_ptr<Type>& get(const std::string& name, size_t index) {
+        std::lock_guard<std::mutex> lock(Type::table_mutex);
+        auto& type_parameter_type = type_parameter_types[{ name, index }];
+        if (type_parameter_type == nullptr) {
+            type_parameter_type = std::shared_ptr<Type>(new TypeParameterType(name, index));
+        }
+        return type_parameter_type;
+    }
+
+    virtual std::string to_string() const override {
+        return this->name;
+    }
+
+    virtual bool is_generic() const override {
+        return true;
+    }
+
+    virtual bool is_object() const override {
+        assert(false && "unreachable");
+    }
+
+    virtual size_t get_size() const override {
+        assert(false && "unreachable");
+    }
+
+    virtual size_t get_layout_index() const override {
+        assert(false && "unreachable");
+    }
+
+    size_t get_index() const {
+        return this->index;
+    }
+
+    ~TypeParameterType() {}
+};
+
+std::map<std::pair<std::string, size_t>, std::shared_ptr<Type>> TypeParameterType::type_parameter_types;
+
+// Binds the type parameters inside of parameter_type so that given_type fits it, returns false if that is not possible.
+// Unbound type arguments are nullptr.
+bool infer_type_arguments(std::shared_ptr<Type> parameter_type, std::shared_ptr<Type> given_type, std::vector<std::shared_ptr<Type>>& type_arguments) {
+    auto as_type_parameter = dynamic_cast<TypeParameterType*>(parameter_type.get());
+    if (as_type_parameter != nullptr) {
+        auto& type_argument = type_arguments[as_type_parameter->get_index()];
+        if (given_type->fits(Type::VOID)) {
+            return false;
+        }
+        if (type_argument == nullptr) {
+            type_argument = given_type;
+            return true;
+        }
+        if (!given_type->fits(type_argument) || !type_argument->fits(given_type)) {
+            return false;
+        }
+        // '[]' only tells that the argument is a list
+        if (type_argument->is_generic()) {
+            type_argument = given_type;
+        }
+        return true;
+    }
+
+    auto as_list_type = dynamic_cast<ListType*>(parameter_type.get());
+    if (as_list_type != nullptr) {
+        auto given_as_list_type = dynamic_cast<ListType*>(given_type.get());
+        if (given_as_list_type == nullptr) {
+            return false;
+        }
+        return infer_type_arguments(as_list_type->get_inner_type(), given_as_list_type->get_inner_type(), type_arguments);
+    }
+
+    return given_type->fits(parameter_type);
+}
+
+// Replaces the type parameters inside of the type by their type arguments
+std::shared_ptr<Type> substitute_type_arguments(std::shared_ptr<Type> type, const std::vector<std::shared_ptr<Type>>& type_arguments) {
+    auto as_type_parameter = dynamic_cast<TypeParameterType*>(type.get());
+    if (as_type_parameter != nullptr) {
+        return type_arguments[as_type_parameter->get_index()];
+    }
+
+    auto as_list_type = dynamic_cast<ListType*>(type.get());
+    if (as_list_type != nullptr) {
+        return ListType::get(substitute_type_arguments(as_list_type->get_inner_type(), type_arguments));
+    }
+
+    return type;
+}
+
 #define PRIMITIVE_ENTRY(x) std::shared_ptr<Type> Type:: x = std::make_shared<PrimitiveType>(Primitive:: x);
 PRIMITIVE_LIST
 #undef PRIMITIVE_ENTRY
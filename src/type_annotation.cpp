@@ -24,7 +24,7 @@ public:
     {}
 
     virtual std::string to_string() const override {
-        return this->name_token.get_text();
+        return std::string(this->name_token.get_text());
     }
 
     virtual std::shared_ptr<Type> to_type() const override {
@@ -45,12 +45,33 @@ public:
     ~PrimitiveTypeAnnotation() {}
 };
 
+// Type parameter of a generic function, the parser binds it to the type argument of the parsed instance
+class TypeParameterAnnotation : public TypeAnnotation {
+private:
+    Token name_token;
+    std::shared_ptr<Type> type_argument;
+public:
+    TypeParameterAnnotation(const Token& name_token, std::shared_ptr<Type> type_argument)
+        : TypeAnnotation(name_token.get_location()), name_token(name_token), type_argument(type_argument)
+    {}
+
+    virtual std::string to_string() const override {
+        return std::string(this->name_token.get_text());
+    }
+
+    virtual std::shared_ptr<Type> to_type() const override {
+        return this->type_argument;
+    }
+
+    ~TypeParameterAnnotation() {}
+};
+
 class ListTypeAnnotation : public TypeAnnotation {
 private:
-    std::unique_ptr<TypeAnnotation> inner_type;
+    TypeAnnotation *inner_type;
 public:
-    ListTypeAnnotation(const Location& start_location, std::unique_ptr<TypeAnnotation> inner_type)
-        : TypeAnnotation(start_location), inner_type(std::move(inner_type))
+    ListTypeAnnotation(const Location& start_location, TypeAnnotation *inner_type)
+        : TypeAnnotation(start_location), inner_type(inner_type)
     {}
 
     virtual std::string to_string() const override {
@@ -64,7 +85,7 @@ public:
             TYPE_ERROR("List cannot have content type void.");
         }
 
-        return std::make_shared<ListType>(this->inner_type->to_type());
+        return ListType::get(this->inner_type->to_type());
     }
 
     ~ListTypeAnnotation() {}
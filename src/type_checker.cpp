@@ -1,9 +1,38 @@
+// Operators are looked up by the token type and the ids of the operand types (see Type). The first lookup of a
+// combination scans the operator list, the result is remembered, so every further expression with the same
+// operator and operand types costs a single hash table lookup. Types are interned, so the result never changes.
+#define OPERATOR_KEY(token_type, left_id, right_id) \
+    ((((uint64_t) (token_type)) << 56) | (((uint64_t) (left_id)) << 28) | ((uint64_t) (right_id)))
+#define OPERATOR_KEY_MAX_TYPE_ID (((size_t) 1) << 28)
+
 class BinaryOperator {
 private:
     TokenType operator_token_type;
     std::shared_ptr<Type> left_type, right_type;
     std::shared_ptr<Type> return_type;
+    // Instruction that computes the operator, for comparisons the branch that is taken if the comparison is false.
+    // Logical operators have no instruction, they are emitted as branches.
+    InstructionType instruction;
+    bool has_instruction_flag;
+
+    // Every thread that type checks functions has its own memo
+    static thread_local std::unordered_map<uint64_t, const BinaryOperator *> resolved_operators;
 public:
+    BinaryOperator(
+            TokenType operator_token_type,
+            std::shared_ptr<Type> left_type,
+            std::shared_ptr<Type> right_type,
+            std::shared_ptr<Type> return_type,
+            InstructionType instruction)
+        :
+            operator_token_type(operator_token_type),
+            left_type(left_type),
+            right_type(right_type),
+            return_type(return_type),
+            instruction(instruction),
+            has_instruction_flag(true)
+    {}
+
     BinaryOperator(
             TokenType operator_token_type,
             std::shared_ptr<Type> left_type,
@@ -13,117 +42,193 @@ public:
             operator_token_type(operator_token_type),
             left_type(left_type),
             right_type(right_type),
-            return_type(return_type)
+            return_type(return_type),
+            instruction(InstructionType::HALT),
+            has_instruction_flag(false)
     {}
 
-    bool fits_criteria(TokenType operator_token_type, std::shared_ptr<Type> left_type, std::shared_ptr<Type> right_type) const {
+    bool fits_criteria(TokenType operator_token_type, const std::shared_ptr<Type>& left_type, const std::shared_ptr<Type>& right_type) const {
         return this->operator_token_type == operator_token_type && left_type->fits(this->left_type) && right_type->fits(this->right_type);
     }
 
-    std::shared_ptr<Type> get_return_type() const {
+    const std::shared_ptr<Type>& get_return_type() const {
         return this->return_type;
     }
 
+    bool has_instruction() const {
+        return this->has_instruction_flag;
+    }
+
+    InstructionType get_instruction() const {
+        assert(this->has_instruction_flag);
+        return this->instruction;
+    }
+
+    // Returns nullptr if the operator is not defined for the operand types
+    static const BinaryOperator *resolve(TokenType operator_token_type, const std::shared_ptr<Type>& left_type, const std::shared_ptr<Type>& right_type);
+
     static BinaryOperator OPERATORS[];
     ~BinaryOperator() {}
 };
 
-#define ARITHMETIC_OPERATORS(T) \
-    BinaryOperator(TokenType::PLUS,  T, T, T), \
-    BinaryOperator(TokenType::STAR,  T, T, T), \
-    BinaryOperator(TokenType::MINUS, T, T, T), \
-    BinaryOperator(TokenType::SLASH, T, T, T)
+#define ARITHMETIC_OPERATORS(T, P) \
+    BinaryOperator(TokenType::PLUS,  T, T, T, InstructionType:: P ## ADD), \
+    BinaryOperator(TokenType::STAR,  T, T, T, InstructionType:: P ## MUL), \
+    BinaryOperator(TokenType::MINUS, T, T, T, InstructionType:: P ## SUB), \
+    BinaryOperator(TokenType::SLASH, T, T, T, InstructionType:: P ## DIV)
 
 #define BIN_OPERATORS(T) \
-    BinaryOperator(TokenType::LESS_LESS, T, T, T), \
-    BinaryOperator(TokenType::GREATER_GREATER, T, T, T), \
-    BinaryOperator(TokenType::AND, T, T, T), \
-    BinaryOperator(TokenType::HAT, T, T, T), \
-    BinaryOperator(TokenType::PIPE, T, T, T) 
-
-#define ORDERING_OPERATORS(T) \
-    BinaryOperator(TokenType::LESS, T, T, Type::BOOL), \
-    BinaryOperator(TokenType::LESS_EQUAL, T, T, Type::BOOL), \
-    BinaryOperator(TokenType::GREATER, T, T, Type::BOOL), \
-    BinaryOperator(TokenType::GREATER_EQUAL, T, T, Type::BOOL)
+    BinaryOperator(TokenType::LESS_LESS, T, T, T, InstructionType::ISHL), \
+    BinaryOperator(TokenType::GREATER_GREATER, T, T, T, InstructionType::ISHR), \
+    BinaryOperator(TokenType::AND, T, T, T, InstructionType::IAND), \
+    BinaryOperator(TokenType::HAT, T, T, T, InstructionType::IXOR), \
+    BinaryOperator(TokenType::PIPE, T, T, T, InstructionType::IOR)
+
+#define ORDERING_OPERATORS(T, P) \
+    BinaryOperator(TokenType::LESS, T, T, Type::BOOL, InstructionType:: J ## P ## GE), \
+    BinaryOperator(TokenType::LESS_EQUAL, T, T, Type::BOOL, InstructionType:: J ## P ## GT), \
+    BinaryOperator(TokenType::GREATER, T, T, Type::BOOL, InstructionType:: J ## P ## LE), \
+    BinaryOperator(TokenType::GREATER_EQUAL, T, T, Type::BOOL, InstructionType:: J ## P ## LT)
 
 #define LOGICAL_OPERATORS(T) \
     BinaryOperator(TokenType::AND_AND, T, T, Type::BOOL), \
     BinaryOperator(TokenType::PIPE_PIPE, T, T, Type::BOOL)
 
 BinaryOperator BinaryOperator::OPERATORS[] = {
-    ARITHMETIC_OPERATORS(Type::INT),
+    ARITHMETIC_OPERATORS(Type::INT, I),
     BIN_OPERATORS(Type::INT),
-    ORDERING_OPERATORS(Type::INT),
+    ORDERING_OPERATORS(Type::INT, I),
 
-    BinaryOperator(TokenType::PERCENT, Type::INT, Type::INT, Type::INT),
+    BinaryOperator(TokenType::PERCENT, Type::INT, Type::INT, Type::INT, InstructionType::IMOD),
 
-    ARITHMETIC_OPERATORS(Type::FLOAT),
-    ORDERING_OPERATORS(Type::FLOAT),
+    ARITHMETIC_OPERATORS(Type::FLOAT, F),
+    ORDERING_OPERATORS(Type::FLOAT, F),
 
-    BinaryOperator(TokenType::EQUAL_EQUAL, Type::GENERIC, Type::GENERIC, Type::BOOL),
-    BinaryOperator(TokenType::BANG_EQUAL, Type::GENERIC, Type::GENERIC, Type::BOOL),
+    BinaryOperator(TokenType::EQUAL_EQUAL, Type::GENERIC, Type::GENERIC, Type::BOOL, InstructionType::JNEQ),
+    BinaryOperator(TokenType::BANG_EQUAL, Type::GENERIC, Type::GENERIC, Type::BOOL, InstructionType::JEQ),
 
     LOGICAL_OPERATORS(Type::BOOL),
 };
 
 constexpr size_t BINARY_OPERATOR_COUNT = (sizeof(BinaryOperator::OPERATORS) / sizeof(BinaryOperator));
 
+thread_local std::unordered_map<uint64_t, const BinaryOperator *> BinaryOperator::resolved_operators;
+
+const BinaryOperator *BinaryOperator::resolve(TokenType operator_token_type, const std::shared_ptr<Type>& left_type, const std::shared_ptr<Type>& right_type) {
+    assert(left_type->get_id() < OPERATOR_KEY_MAX_TYPE_ID && right_type->get_id() < OPERATOR_KEY_MAX_TYPE_ID);
+    uint64_t key = OPERATOR_KEY(operator_token_type, left_type->get_id(), right_type->get_id());
+    auto resolved_operator = resolved_operators.find(key);
+    if (resolved_operator != resolved_operators.end()) {
+        return resolved_operator->second;
+    }
+
+    const BinaryOperator *binary_operator = nullptr;
+    for (size_t i = 0; i < BINARY_OPERATOR_COUNT; i++) {
+        if (OPERATORS[i].fits_criteria(operator_token_type, left_type, right_type)) {
+            binary_operator = &OPERATORS[i];
+            break;
+        }
+    }
+    resolved_operators[key] = binary_operator;
+    return binary_operator;
+}
+
 class UnaryOperator {
 private:
     TokenType operator_token_type;
     std::shared_ptr<Type> operand_type;
     std::shared_ptr<Type> return_type;
+    // Instruction that computes the operator, '+' changes nothing and '!' is emitted as branches
+    InstructionType instruction;
+    bool has_instruction_flag;
+
+    // Every thread that type checks functions has its own memo
+    static thread_local std::unordered_map<uint64_t, const UnaryOperator *> resolved_operators;
 public:
+    UnaryOperator(TokenType operator_token_type, std::shared_ptr<Type> operand_type, std::shared_ptr<Type> return_type, InstructionType instruction)
+        : operator_token_type(operator_token_type), operand_type(operand_type), return_type(return_type), instruction(instruction), has_instruction_flag(true)
+    {}
+
     UnaryOperator(TokenType operator_token_type, std::shared_ptr<Type> operand_type, std::shared_ptr<Type> return_type)
-        : operator_token_type(operator_token_type), operand_type(operand_type), return_type(return_type)
+        : operator_token_type(operator_token_type), operand_type(operand_type), return_type(return_type), instruction(InstructionType::HALT), has_instruction_flag(false)
     {}
 
-    bool fits_criteria(TokenType operator_token_type, std::shared_ptr<Type> operand_type) const {
+    bool fits_criteria(TokenType operator_token_type, const std::shared_ptr<Type>& operand_type) const {
         return operator_token_type == this->operator_token_type && operand_type->fits(this->operand_type);
     }
 
-    std::shared_ptr<Type> get_return_type() const {
+    const std::shared_ptr<Type>& get_return_type() const {
         return this->return_type;
     }
 
+    bool has_instruction() const {
+        return this->has_instruction_flag;
+    }
+
+    InstructionType get_instruction() const {
+        assert(this->has_instruction_flag);
+        return this->instruction;
+    }
+
+    // Returns nullptr if the operator is not defined for the operand type
+    static const UnaryOperator *resolve(TokenType operator_token_type, const std::shared_ptr<Type>& operand_type);
+
     static UnaryOperator OPERATORS[];
     ~UnaryOperator() {}
 };
 
-#define UNARY_ARITHMETIC(T) \
+#define UNARY_ARITHMETIC(T, P) \
     UnaryOperator(TokenType::PLUS, T, T), \
-    UnaryOperator(TokenType::MINUS, T, T)
+    UnaryOperator(TokenType::MINUS, T, T, InstructionType:: P ## NEG)
 
 UnaryOperator UnaryOperator::OPERATORS[] = {
-    UnaryOperator(TokenType::TILDE, Type::INT, Type::INT),
+    UnaryOperator(TokenType::TILDE, Type::INT, Type::INT, InstructionType::IBNEG),
 
-    UNARY_ARITHMETIC(Type::INT),
-    UNARY_ARITHMETIC(Type::FLOAT),
+    UNARY_ARITHMETIC(Type::INT, I),
+    UNARY_ARITHMETIC(Type::FLOAT, F),
 
     UnaryOperator(TokenType::BANG, Type::BOOL, Type::BOOL),
 };
 
 constexpr size_t UNARY_OPERATOR_COUNT = (sizeof(UnaryOperator::OPERATORS) / sizeof(UnaryOperator));
 
+thread_local std::unordered_map<uint64_t, const UnaryOperator *> UnaryOperator::resolved_operators;
+
+const UnaryOperator *UnaryOperator::resolve(TokenType operator_token_type, const std::shared_ptr<Type>& operand_type) {
+    assert(operand_type->get_id() < OPERATOR_KEY_MAX_TYPE_ID);
+    uint64_t key = OPERATOR_KEY(operator_token_type, operand_type->get_id(), 0);
+    auto resolved_operator = resolved_operators.find(key);
+    if (resolved_operator != resolved_operators.end()) {
+        return resolved_operator->second;
+    }
+
+    const UnaryOperator *unary_operator = nullptr;
+    for (size_t i = 0; i < UNARY_OPERATOR_COUNT; i++) {
+        if (OPERATORS[i].fits_criteria(operator_token_type, operand_type)) {
+            unary_operator = &OPERATORS[i];
+            break;
+        }
+    }
+    resolved_operators[key] = unary_operator;
+    return unary_operator;
+}
+
 enum class SymbolType {
     VARIABLE,
-    FUNCTION
+    FUNCTION,
+    GENERIC_FUNCTION
 };
 
 class Symbol {
 private:
-    size_t layer;
     SymbolType symbol_type;
 public:
-    Symbol(size_t layer, SymbolType symbol_type) : layer(layer), symbol_type(symbol_type) {}
+    Symbol(SymbolType symbol_type) : symbol_type(symbol_type) {}
 
     SymbolType get_symbol_type() const {
         return this->symbol_type;
     }
 
-    size_t get_layer() const { return this->layer; }
-
     virtual ~Symbol() {}
 };
 
@@ -132,9 +237,9 @@ private:
     std::shared_ptr<Type> type;
     size_t id;
 public:
-    VariableSymbol(size_t layer, std::shared_ptr<Type> type, size_t id) : Symbol(layer, SymbolType::VARIABLE), type(type), id(id) {}
+    VariableSymbol(std::shared_ptr<Type> type, size_t id) : Symbol(SymbolType::VARIABLE), type(type), id(id) {}
 
-    std::shared_ptr<Type> get_type() const {
+    const std::shared_ptr<Type>& get_type() const {
         return this->type;
     }
 
@@ -153,8 +258,8 @@ private:
     size_t id;
     bool is_native;
 public:
-    FunctionSymbol(size_t layer, std::shared_ptr<Type> return_type, std::vector<std::shared_ptr<Type>> argument_types, size_t id, bool is_native)
-        : Symbol(layer, SymbolType::FUNCTION), return_type(return_type), argument_types(std::move(argument_types)), id(id), is_native(is_native)
+    FunctionSymbol(std::shared_ptr<Type> return_type, std::vector<std::shared_ptr<Type>> argument_types, size_t id, bool is_native)
+        : Symbol(SymbolType::FUNCTION), return_type(return_type), argument_types(std::move(argument_types)), id(id), is_native(is_native)
     {}
 
     // TODO: Have seperate error messages
@@ -188,25 +293,104 @@ public:
     ~FunctionSymbol() {}
 };
 
+// Symbol of a generic function, calls are resolved to the instance for the inferred type arguments
+class GenericFunctionSymbol : public Symbol {
+private:
+    std::vector<std::string> type_parameters;
+    std::shared_ptr<Type> return_type;
+    std::vector<std::shared_ptr<Type>> argument_types;
+    std::function<size_t(const std::vector<std::shared_ptr<Type>>&)> instantiate;
+public:
+    GenericFunctionSymbol(
+            std::vector<std::string> type_parameters,
+            std::shared_ptr<Type> return_type,
+            std::vector<std::shared_ptr<Type>> argument_types,
+            std::function<size_t(const std::vector<std::shared_ptr<Type>>&)> instantiate)
+        :
+            Symbol(SymbolType::GENERIC_FUNCTION),
+            type_parameters(std::move(type_parameters)),
+            return_type(return_type),
+            argument_types(std::move(argument_types)),
+            instantiate(std::move(instantiate))
+    {}
+
+    // Returns false if the given types do not fit the arguments, type parameters that can not be inferred stay nullptr
+    bool infer_type_arguments(const std::vector<std::shared_ptr<Type>>& given_types, std::vector<std::shared_ptr<Type>>& type_arguments) const {
+        if (given_types.size() != this->argument_types.size()) {
+            return false;
+        }
+
+        type_arguments.assign(this->type_parameters.size(), nullptr);
+        for (size_t i = 0; i < given_types.size(); i++) {
+            if (!::infer_type_arguments(this->argument_types[i], given_types[i], type_arguments)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    const std::vector<std::string>& get_type_parameters() const {
+        return this->type_parameters;
+    }
+
+    std::shared_ptr<Type> get_return_type(const std::vector<std::shared_ptr<Type>>& type_arguments) const {
+        return substitute_type_arguments(this->return_type, type_arguments);
+    }
+
+    // Returns the id of the function instance for the given type arguments
+    size_t get_instance_id(const std::vector<std::shared_ptr<Type>>& type_arguments) const {
+        return this->instantiate(type_arguments);
+    }
+
+    ~GenericFunctionSymbol() {}
+};
+
+class ListLiteralExpression;
+
+// Call of a generic function whose instance is created once the calling function is type checked
+struct InstanceRequest {
+    const GenericFunctionSymbol *symbol;
+    std::vector<std::shared_ptr<Type>> type_arguments;
+    size_t *function_id;
+};
+
+// State of the function that is type checked on the current thread, see TypeChecker::run_type_checks
+struct TypeCheckContext {
+    // Symbols of the open scopes, indexed by name id like the global symbol table
+    std::vector<std::unique_ptr<Symbol>> symbol_table;
+    // Undo log of the open scopes: the names defined in them in order of definition, and where each scope starts in it
+    std::vector<size_t> defined_names;
+    std::vector<size_t> scope_starts;
+    size_t while_statement_layer = 0;
+    std::shared_ptr<Type> current_return_type = Type::NO;
+    size_t variable_count = 0;
+    size_t max_variable_count = 0;
+    // List literals of the current function whose element type is not known yet, see ListLiteralExpression::check_element_type
+    std::vector<const ListLiteralExpression *> generic_list_literals;
+    std::vector<InstanceRequest> instance_requests;
+};
+
 class TypeChecker {
 private:
     // TODO: Decide whether variable shadowing should be a thing
-    std::unordered_map<std::string, std::unique_ptr<Symbol>> symbol_table;
-    size_t current_layer;
-    size_t while_statement_layer = 0;
-    std::shared_ptr<Type> current_return_type;
-    size_t variable_count;
+    // Names are interned once when they are parsed, the symbol of a name is found by indexing the symbol table with
+    // the id of the name. The keys are views into the source files (or string literals), which stay alive until the
+    // program ends.
+    std::unordered_map<std::string_view, size_t> name_ids;
+    // Global symbols, they are only defined while no function is type checked
+    std::vector<std::unique_ptr<Symbol>> symbol_table;
     size_t function_count;
+    std::vector<std::function<void()>> deferred_type_checks;
 
     static TypeChecker instance;
+    static thread_local TypeCheckContext context;
     
     TypeChecker() :
-        symbol_table(), 
-        current_layer(0), 
-        while_statement_layer(0), 
-        current_return_type(Type::NO), 
-        variable_count(0),
-        function_count(0)
+        name_ids(),
+        symbol_table(),
+        function_count(0),
+        deferred_type_checks()
     {
         this->add_native_function_symbol("print", Type::VOID, std::vector<std::shared_ptr<Type>> { Type::STRING }, NATIVE_PRINT);
         this->add_native_function_symbol("print_line", Type::VOID, std::vector<std::shared_ptr<Type>> { Type::STRING }, NATIVE_PRINTLN);
@@ -215,6 +399,20 @@ private:
 
     TypeChecker(TypeChecker& other) = delete;
 
+    // Symbols defined in a scope belong to the function that is type checked, all others are global
+    void define_symbol(size_t name_id, std::unique_ptr<Symbol> symbol) {
+        assert(!this->symbol_exists(name_id) && "Symbols can not be shadowed");
+        if (context.scope_starts.empty()) {
+            this->symbol_table[name_id] = std::move(symbol);
+            return;
+        }
+        if (context.symbol_table.size() <= name_id) {
+            context.symbol_table.resize(this->symbol_table.size());
+        }
+        context.symbol_table[name_id] = std::move(symbol);
+        context.defined_names.push_back(name_id);
+    }
+
 public:
     static std::pair<std::shared_ptr<Type>, std::shared_ptr<Type>> ALLOWED_TYPE_CASTS[];
 
@@ -222,89 +420,172 @@ public:
         return instance;
     }
 
+    // Id of the name, every identifier is looked up once while it is parsed and from then on only by its id
+    size_t get_name_id(std::string_view name) {
+        auto [name_entry, is_new] = this->name_ids.try_emplace(name, this->symbol_table.size());
+        if (is_new) {
+            this->symbol_table.push_back(nullptr);
+        }
+        return name_entry->second;
+    }
+
     std::shared_ptr<Type> get_current_return_type() const {
-        return this->current_return_type;
+        return context.current_return_type;
     }
     
 
     void set_current_return_type(std::shared_ptr<Type> return_type) {
-        this->current_return_type = return_type;
+        context.current_return_type = return_type;
     }
 
-    bool symbol_exists(const std::string& name) {
-        return this->symbol_table.contains(name);
+    bool symbol_exists(size_t name_id) const {
+        return this->symbol_table[name_id] != nullptr || (name_id < context.symbol_table.size() && context.symbol_table[name_id] != nullptr);
     } 
 
-    const std::unique_ptr<Symbol>& get_symbol(const std::string& name) {
-        assert(this->symbol_exists(name) && "Symbol must exist to call this function");
-        return this->symbol_table[name];
+    const std::unique_ptr<Symbol>& get_symbol(size_t name_id) const {
+        assert(this->symbol_exists(name_id) && "Symbol must exist to call this function");
+        if (this->symbol_table[name_id] != nullptr) {
+            return this->symbol_table[name_id];
+        }
+        return context.symbol_table[name_id];
     }
 
-    size_t add_variable_symbol(const std::string& name, std::shared_ptr<Type> variable_type) {
-        this->symbol_table[name] = std::make_unique<VariableSymbol>(this->current_layer, variable_type, this->variable_count);
-        size_t id = this->variable_count;
-        this->variable_count += 1;
+    size_t add_variable_symbol(size_t name_id, std::shared_ptr<Type> variable_type) {
+        this->define_symbol(name_id, std::make_unique<VariableSymbol>(variable_type, context.variable_count));
+        size_t id = context.variable_count;
+        context.variable_count += 1;
+        context.max_variable_count = std::max(context.max_variable_count, context.variable_count);
         return id;
     }
 
+    // Highest number of variables that were alive at the same time since the last reset
+    size_t get_max_variable_count() const {
+        return context.max_variable_count;
+    }
+
+    void reset_max_variable_count() {
+        context.max_variable_count = context.variable_count;
+    }
+
     size_t get_function_count() const {
         return this->function_count;
     }
     
-    size_t add_function_symbol(const std::string& name, std::shared_ptr<Type> return_type, std::vector<std::shared_ptr<Type>> argument_types) {
+    size_t add_function_symbol(size_t name_id, std::shared_ptr<Type> return_type, std::vector<std::shared_ptr<Type>> argument_types) {
+        size_t id = this->function_count;
+        this->define_symbol(name_id, std::make_unique<FunctionSymbol>(return_type, std::move(argument_types), id, false));
+        this->function_count += 1;
+        return id;
+    }
+
+    void add_generic_function_symbol(
+            size_t name_id,
+            std::vector<std::string> type_parameters,
+            std::shared_ptr<Type> return_type,
+            std::vector<std::shared_ptr<Type>> argument_types,
+            std::function<size_t(const std::vector<std::shared_ptr<Type>>&)> instantiate)
+    {
+        this->define_symbol(name_id, std::make_unique<GenericFunctionSymbol>(std::move(type_parameters), return_type, std::move(argument_types), std::move(instantiate)));
+    }
+
+    // Functions that can only be called through another symbol, like instances of generic functions
+    size_t add_function_without_symbol() {
         size_t id = this->function_count;
-        this->symbol_table[name] = std::make_unique<FunctionSymbol>(this->current_layer, return_type, std::move(argument_types), id, false);
         this->function_count += 1;
         return id;
     }
 
-    void add_native_function_symbol(const std::string& name, std::shared_ptr<Type> return_type, std::vector<std::shared_ptr<Type>> argument_types, size_t id) {
-        this->symbol_table[name] = std::make_unique<FunctionSymbol>(this->current_layer, return_type, std::move(argument_types), id, true);
+    // Creating an instance parses and registers a new function, which can not be done while other functions are
+    // type checked. The id of the instance is written to 'function_id' once the type checks have finished.
+    void request_instance(const GenericFunctionSymbol *symbol, std::vector<std::shared_ptr<Type>> type_arguments, size_t *function_id) {
+        context.instance_requests.push_back({ symbol, std::move(type_arguments), function_id });
+    }
+
+    // Type checks that can not be done in the middle of another function, e.g. of newly created instances of generic functions
+    void defer_type_check(std::function<void()> type_check) {
+        this->deferred_type_checks.push_back(std::move(type_check));
+    }
+
+    // Runs the type checks of independent functions on several threads, and then the type checks they deferred.
+    // The requested instances are created after every round in the order of the type checks and of the calls in
+    // them, which gives every function the same id as if all type checks had run one after the other.
+    void run_type_checks(std::vector<std::function<void()>> type_checks) {
+        while (!type_checks.empty()) {
+            std::vector<std::vector<InstanceRequest>> instance_requests(type_checks.size());
+            ParallelTasks::get().run(type_checks.size(), [&](size_t index) {
+                type_checks[index]();
+                instance_requests[index] = std::move(context.instance_requests);
+                context.instance_requests.clear();
+            });
+
+            for (const auto& requests : instance_requests) {
+                for (const auto& request : requests) {
+                    *request.function_id = request.symbol->get_instance_id(request.type_arguments);
+                }
+            }
+
+            type_checks = std::move(this->deferred_type_checks);
+            this->deferred_type_checks.clear();
+        }
+    }
+
+    void add_native_function_symbol(std::string_view name, std::shared_ptr<Type> return_type, std::vector<std::shared_ptr<Type>> argument_types, size_t id) {
+        this->define_symbol(this->get_name_id(name), std::make_unique<FunctionSymbol>(return_type, std::move(argument_types), id, true));
+    }
+
+    // The element type of an empty list literal is set by a type cast or annotation around it, so it is only
+    // known once the whole function is type checked
+    void add_generic_list_literal(const ListLiteralExpression *list_literal) {
+        context.generic_list_literals.push_back(list_literal);
+    }
+
+    std::vector<const ListLiteralExpression *> take_generic_list_literals() {
+        std::vector<const ListLiteralExpression *> list_literals = std::move(context.generic_list_literals);
+        context.generic_list_literals.clear();
+        return list_literals;
     }
 
     void push_while_statement() {
-        this->while_statement_layer += 1;
+        context.while_statement_layer += 1;
     }
 
     bool is_in_while_statement() {
-        return this->while_statement_layer > 0;
+        return context.while_statement_layer > 0;
     }
     
     void pop_while_statement() {
-        assert(this->while_statement_layer > 0);
-        this->while_statement_layer -= 1;
+        assert(context.while_statement_layer > 0);
+        context.while_statement_layer -= 1;
     }
 
     void push_scope() {
-        this->current_layer += 1;
+        context.scope_starts.push_back(context.defined_names.size());
     }
 
+    // Only visits the symbols of the popped scope
     void pop_scope() {
-        assert(this->current_layer > 0);
-        std::vector<std::string> to_remove;
+        assert(context.scope_starts.size() > 0);
+        size_t scope_start = context.scope_starts.back();
         size_t removed_variables = 0;
 
-        for (const auto& symbol_entry : this->symbol_table) {
-            if (symbol_entry.second->get_layer() == this->current_layer) {
-                if (symbol_entry.second->get_symbol_type() == SymbolType::VARIABLE) {
-                    removed_variables += 1;
-                }
-                to_remove.push_back(symbol_entry.first);
+        for (size_t i = scope_start; i < context.defined_names.size(); i++) {
+            auto& symbol = context.symbol_table[context.defined_names[i]];
+            if (symbol->get_symbol_type() == SymbolType::VARIABLE) {
+                removed_variables += 1;
             }
-        }
-        
-        for (const auto& popped_symbol : to_remove) {
-            this->symbol_table.erase(popped_symbol);
+            symbol.reset();
         }
 
-        this->variable_count -= removed_variables;
-        this->current_layer -= 1;
+        context.defined_names.resize(scope_start);
+        context.scope_starts.pop_back();
+        context.variable_count -= removed_variables;
     }
 
     ~TypeChecker() {}
 };
 
 TypeChecker TypeChecker::instance;
+thread_local TypeCheckContext TypeChecker::context;
 
 
 // SOURCE, DEST
@@ -314,8 +595,8 @@ std::pair<std::shared_ptr<Type>, std::shared_ptr<Type>> TypeChecker::ALLOWED_TYP
     { Type::INT, Type::FLOAT },
     { Type::CHAR, Type::INT },
     { Type::CHAR, Type::STRING },
-    { Type::STRING, std::make_shared<ListType>(Type::CHAR) },
-    { std::make_shared<ListType>(Type::CHAR), Type::STRING },
+    { Type::STRING, ListType::get(Type::CHAR) },
+    { ListType::get(Type::CHAR), Type::STRING },
     { Type::FLOAT, Type::INT },
     { Type::FLOAT, Type::STRING },
     { Type::BOOL, Type::STRING },
@@ -0,0 +1,313 @@
+
+// Value on the simulated operand stack: its value number and the instructions [begin, end] that computed it
+class StackValue {
+private:
+    size_t value_number;
+    size_t begin;
+    size_t end;
+    bool is_replaceable;
+public:
+    StackValue(size_t value_number, size_t begin, size_t end, bool is_replaceable)
+        : value_number(value_number), begin(begin), end(end), is_replaceable(is_replaceable)
+    {}
+
+    size_t get_value_number() const {
+        return this->value_number;
+    }
+
+    size_t get_begin() const {
+        return this->begin;
+    }
+
+    size_t get_end() const {
+        return this->end;
+    }
+
+    // The computing instructions have no effect except for pushing the value, so they can be replaced by a load
+    bool get_is_replaceable() const {
+        return this->is_replaceable;
+    }
+
+    ~StackValue() {}
+};
+
+// Finds pure computations inside of a basic block that evaluate to the same value and computes them only once.
+//
+// The operand stack is simulated and every computed value gets a value number, which is equal for values
+// computed by the same instruction from the same operands. Loads of variables and memory are numbered by the
+// version of the variable or memory, which changes with every write. The first computation of a repeated value
+// is stored in a new variable and the later computations are replaced by loads of that variable.
+class CommonSubexpressionEliminator : public OptimizationPass {
+private:
+    // Number of operands of instructions that only compute a value (-1 for all other instructions).
+    // Division and bounds checked loads may trap, but a repeated computation can still reuse the first one.
+    static int value_operand_count(InstructionType type) {
+        switch (type) {
+            case InstructionType::PUSH:
+            case InstructionType::VLOAD:
+            case InstructionType::SPTR:
+                return 0;
+
+            case InstructionType::READW:
+            case InstructionType::READB:
+            case InstructionType::IBNEG:
+            case InstructionType::FNEG:
+            case InstructionType::INEG:
+            case InstructionType::LNEG:
+            case InstructionType::I2C:
+            case InstructionType::I2F:
+            case InstructionType::F2I:
+                return 1;
+
+            case InstructionType::ELOADW:
+            case InstructionType::ELOADB:
+            case InstructionType::PADD:
+            case InstructionType::IADD:
+            case InstructionType::ISUB:
+            case InstructionType::IMUL:
+            case InstructionType::IDIV:
+            case InstructionType::IMOD:
+            case InstructionType::ISHL:
+            case InstructionType::ISHR:
+            case InstructionType::IAND:
+            case InstructionType::IOR:
+            case InstructionType::IXOR:
+            case InstructionType::FADD:
+            case InstructionType::FSUB:
+            case InstructionType::FMUL:
+            case InstructionType::FDIV:
+                return 2;
+
+            default:
+                return -1;
+        }
+    }
+
+    static bool reads_memory(InstructionType type) {
+        return type == InstructionType::READW || type == InstructionType::READB || type == InstructionType::ELOADW || type == InstructionType::ELOADB;
+    }
+
+    static bool writes_memory(InstructionType type) {
+        switch (type) {
+            case InstructionType::WRITEW:
+            case InstructionType::WRITEB:
+            case InstructionType::ESTOREW:
+            case InstructionType::ESTOREB:
+            case InstructionType::CALL:
+            case InstructionType::NATIVE:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // Number of values popped and pushed by the instructions that do not only compute a value
+    static std::pair<size_t, size_t> get_stack_effect(InstructionType type) {
+        switch (type) {
+            case InstructionType::DUP:
+                return { 1, 2 };
+            case InstructionType::POP:
+            case InstructionType::VWRITE:
+            case InstructionType::JEQZ:
+                return { 1, 0 };
+            case InstructionType::HALLOC:
+                return { 1, 1 };
+            case InstructionType::WRITEW:
+            case InstructionType::WRITEB:
+            case InstructionType::JNEQ:
+            case InstructionType::JEQ:
+            case InstructionType::JILT:
+            case InstructionType::JILE:
+            case InstructionType::JIGT:
+            case InstructionType::JIGE:
+            case InstructionType::JFLT:
+            case InstructionType::JFLE:
+            case InstructionType::JFGT:
+            case InstructionType::JFGE:
+                return { 2, 0 };
+            case InstructionType::ESTOREW:
+            case InstructionType::ESTOREB:
+                return { 3, 1 };
+            default:
+                return { 0, 0 };
+        }
+    }
+
+    // Collects the ranges of instructions that compute the same value more than once inside of the given block
+    void number_values(const std::vector<Instruction>& instructions, const BasicBlock& block, std::vector<std::vector<std::pair<size_t, size_t>>>& repeated) const {
+        std::map<std::vector<int64_t>, size_t> value_numbers;
+        std::unordered_map<int64_t, int64_t> variable_versions;
+        int64_t memory_version = 0;
+        size_t value_count = 0;
+
+        std::vector<StackValue> stack;
+        std::unordered_map<size_t, std::vector<std::pair<size_t, size_t>>> computations;
+
+        // Values that were pushed before the block are unknown
+        auto pop = [&]() {
+            if (stack.size() == 0) {
+                return StackValue(value_count++, 0, 0, false);
+            }
+            StackValue value = stack.back();
+            stack.pop_back();
+            return value;
+        };
+        auto push_unique = [&](size_t index) {
+            stack.push_back(StackValue(value_count++, index, index, false));
+        };
+
+        for (size_t i = block.get_begin(); i < block.get_end(); i++) {
+            const Instruction& instruction = instructions[i];
+            InstructionType type = instruction.get_type();
+            int64_t operand = instruction.get_operand().as_int;
+
+            int operand_count = value_operand_count(type);
+            if (operand_count >= 0) {
+                std::vector<StackValue> operands;
+                for (int j = 0; j < operand_count; j++) {
+                    operands.insert(operands.begin(), pop());
+                }
+
+                std::vector<int64_t> key { (int64_t) type, operand };
+                if (type == InstructionType::VLOAD) {
+                    key.push_back(variable_versions[operand]);
+                }
+                if (reads_memory(type)) {
+                    key.push_back(memory_version);
+                }
+
+                // The operands have to be computed directly before the instruction
+                bool is_replaceable = true;
+                size_t next = i;
+                for (size_t j = operands.size(); j-- > 0;) {
+                    key.push_back((int64_t) operands[j].get_value_number());
+                    is_replaceable = is_replaceable && operands[j].get_is_replaceable() && operands[j].get_end() + 1 == next;
+                    next = operands[j].get_begin();
+                }
+
+                if (!value_numbers.contains(key)) {
+                    value_numbers[key] = value_count++;
+                }
+                size_t value_number = value_numbers.at(key);
+                size_t begin = operands.size() > 0 ? operands[0].get_begin() : i;
+                stack.push_back(StackValue(value_number, begin, i, is_replaceable));
+
+                if (is_replaceable && begin < i) {
+                    computations[value_number].push_back({ begin, i });
+                }
+                continue;
+            }
+
+            if (type == InstructionType::VWRITE) {
+                variable_versions[operand] += 1;
+            }
+            if (writes_memory(type)) {
+                memory_version += 1;
+            }
+
+            if (type == InstructionType::CALL || type == InstructionType::NATIVE) {
+                // The number of arguments is not known
+                stack.clear();
+                push_unique(i);
+            } else if (type == InstructionType::DUP) {
+                StackValue value = pop();
+                stack.push_back(StackValue(value.get_value_number(), i, i, false));
+                stack.push_back(StackValue(value.get_value_number(), i, i, false));
+            } else {
+                auto [pop_count, push_count] = get_stack_effect(type);
+                for (size_t j = 0; j < pop_count; j++) {
+                    (void) pop();
+                }
+                for (size_t j = 0; j < push_count; j++) {
+                    push_unique(i);
+                }
+            }
+        }
+
+        for (auto& [_, ranges] : computations) {
+            if (ranges.size() > 1) {
+                repeated.push_back(std::move(ranges));
+            }
+        }
+    }
+
+    // Replaces the most profitable repeated computation of the function, returns false if there is none
+    bool eliminate_repeated_computation(std::vector<Instruction>& instructions, size_t& variable_count) const {
+        std::vector<std::vector<std::pair<size_t, size_t>>> repeated;
+        for (const auto& block : build_basic_blocks(instructions)) {
+            this->number_values(instructions, block, repeated);
+        }
+
+        // Every later computation saves its length - 1 instructions, storing the first one costs 2
+        const std::vector<std::pair<size_t, size_t>> *best = nullptr;
+        int64_t best_savings = 0;
+        for (const auto& ranges : repeated) {
+            int64_t savings = -2;
+            for (size_t i = 1; i < ranges.size(); i++) {
+                savings += (int64_t) (ranges[i].second - ranges[i].first);
+            }
+            if (savings > best_savings) {
+                best_savings = savings;
+                best = &ranges;
+            }
+        }
+        if (best == nullptr) {
+            return false;
+        }
+
+        size_t variable = variable_count;
+        variable_count += 1;
+
+        std::vector<Instruction> output;
+        output.reserve(instructions.size());
+        size_t next_range = 1;
+        for (size_t i = 0; i < instructions.size(); i++) {
+            if (next_range < best->size() && i == (*best)[next_range].first) {
+                output.push_back(Instruction(InstructionType::VLOAD, Word { .as_int = (int64_t) variable }));
+                i = (*best)[next_range].second;
+                next_range += 1;
+                continue;
+            }
+
+            output.push_back(instructions[i]);
+            if (i == (*best)[0].second) {
+                output.push_back(Instruction(InstructionType::DUP));
+                output.push_back(Instruction(InstructionType::VWRITE, Word { .as_int = (int64_t) variable }));
+            }
+        }
+
+        instructions = std::move(output);
+        return true;
+    }
+
+    // 'VWRITE x; VLOAD x' loads the value that is still on the stack, so it is replaced by 'DUP; VWRITE x'.
+    // The store might become dead afterwards (see DeadCodeEliminator).
+    void forward_stores(std::vector<Instruction>& instructions) const {
+        for (size_t i = 0; i + 1 < instructions.size(); i++) {
+            const Instruction& instruction = instructions[i];
+            const Instruction& next = instructions[i+1];
+            if (instruction.get_type() == InstructionType::VWRITE && next.get_type() == InstructionType::VLOAD &&
+                instruction.get_operand().as_int == next.get_operand().as_int) {
+                instructions[i+1] = instruction;
+                instructions[i] = Instruction(InstructionType::DUP);
+            }
+        }
+    }
+
+public:
+    CommonSubexpressionEliminator() {}
+
+    virtual const char *get_name() const override {
+        return "cse";
+    }
+
+    virtual void run(CodeGenerator& code_generator) override {
+        for (auto& function : code_generator.get_functions()) {
+            size_t variable_count = function.get_frame_size();
+            while (this->eliminate_repeated_computation(function.get_instructions(), variable_count)) {}
+            this->forward_stores(function.get_instructions());
+        }
+    }
+
+    ~CommonSubexpressionEliminator() {}
+};
@@ -25,6 +25,19 @@ union Word {
 #define STRING_DATA_OFFSET (STRING_LENGTH_OFFSET + sizeof(Word))
 #define STRING_SIZE (STRING_DATA_OFFSET + sizeof(Word))
 
+// Lists and strings store their length at the same offset, which is used by the checked element instructions
+static_assert(LIST_LENGTH_OFFSET == STRING_LENGTH_OFFSET);
+
+// The operand of the checked element instructions holds the offset of the data pointer inside of the
+// indexed list or string and whether the element is an object in the lowest bit
+#define ELEMENT_ACCESS_OPERAND(data_offset, is_object) ((int64_t) (((data_offset) << 1) | ((is_object) ? 1 : 0)))
+
+#define RUNTIME_ERROR(message) \
+    do { \
+        std::cerr << "RUNTIME_ERROR: " << message << std::endl; \
+        std::exit(1); \
+    } while(0)
+
 
 
 
@@ -43,6 +56,11 @@ union Word {
     INSTRUCTION_ENTRY(PADD) \
     INSTRUCTION_ENTRY(SPTR) \
     \
+    INSTRUCTION_ENTRY(ELOADW) \
+    INSTRUCTION_ENTRY(ESTOREW) \
+    INSTRUCTION_ENTRY(ELOADB) \
+    INSTRUCTION_ENTRY(ESTOREB) \
+    \
     INSTRUCTION_ENTRY(VLOAD) \
     INSTRUCTION_ENTRY(VWRITE) \
     \
@@ -87,6 +105,8 @@ union Word {
     INSTRUCTION_ENTRY(CALL) \
     INSTRUCTION_ENTRY(NATIVE) \
     INSTRUCTION_ENTRY(RET) \
+    INSTRUCTION_ENTRY(MENTER) \
+    INSTRUCTION_ENTRY(MSTORE) \
     \
     INSTRUCTION_ENTRY(I2C) \
     INSTRUCTION_ENTRY(I2F) \
@@ -139,6 +159,34 @@ public:
 std::ostream& operator<<(std::ostream& output_stream, const Instruction& instruction) {
     return output_stream << instruction.get_type() << " " << instruction.get_operand().as_int;
 }
+
+// Instructions whose operand is a label inside of the current function
+bool is_branch_instruction(InstructionType type) {
+    switch(type)  {
+        case InstructionType::JUMP:
+        case InstructionType::JNEQ:
+        case InstructionType::JEQ:
+        case InstructionType::JEQZ:
+
+        case InstructionType::JILT:
+        case InstructionType::JILE:
+        case InstructionType::JIGT:
+        case InstructionType::JIGE:
+
+        case InstructionType::JFLT:
+        case InstructionType::JFLE:
+        case InstructionType::JFGT:
+        case InstructionType::JFGE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Instructions whose operand is the location of another instruction once the labels are resolved
+bool is_jump_instruction(InstructionType type) {
+    return is_branch_instruction(type) || type == InstructionType::CALL;
+}
     
 enum class StackElementType {
     PRIMITIVE,
@@ -179,7 +227,7 @@ enum PredefinedLayouts {
     POINTER_LAYOUT,
     LIST_LAYOUT,
     STRING_LAYOUT,
-    //PREDEFINED_LAYOUT_COUNT
+    PREDEFINED_LAYOUT_COUNT
 };
 
 std::shared_ptr<ObjectLayout> ObjectLayout::predefined_layouts[] = {
@@ -218,6 +266,20 @@ public:
     size_t get_local_var_offset() const { return this->local_var_offset; }
 };
 
+class MemoKeyHash {
+public:
+    size_t operator()(const std::vector<int64_t>& key) const {
+        size_t hash = key.size();
+        for (int64_t word : key) {
+            hash ^= std::hash<int64_t>()(word) + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+        }
+        return hash;
+    }
+};
+
+// Results of a memoized function keyed by the words of its arguments
+typedef std::unordered_map<std::vector<int64_t>, StackElement, MemoKeyHash> MemoCache;
+
 enum NativeFunctions {
     NATIVE_PRINT=0,
     NATIVE_PRINTLN,
@@ -226,7 +288,21 @@ enum NativeFunctions {
     NATIVE_STRING_TO_CHAR_LIST,
     NATIVE_CHAR_LIST_TO_STRING,
     NATIVE_FLOAT_TO_STRING,
-    NATIVE_BOOL_TO_STRING
+    NATIVE_BOOL_TO_STRING,
+    NATIVE_FUNCTION_COUNT
+};
+
+class VirtualMachine;
+
+// Is notified about the calls and backward jumps of VirtualMachine::execute_tiered and may install new code in between
+class TieringListener {
+public:
+    // 'target' is the location of the called function
+    virtual void on_call(VirtualMachine& virtual_machine, size_t target) = 0;
+    // 'location' is the location of the jump
+    virtual void on_back_edge(VirtualMachine& virtual_machine, size_t location) = 0;
+
+    virtual ~TieringListener() {}
 };
 
 class VirtualMachine {
@@ -237,20 +313,38 @@ private:
     std::vector<StackElement> operand_stack;
     std::vector<StackElement> local_vars;
 
-    std::vector<Instruction> program;
-    std::vector<char> static_memory;
+    // The program and the static memory are either owned by the virtual machine or mapped from a bytecode file
+    std::vector<Instruction> owned_program;
+    std::vector<char> owned_static_memory;
+    const Instruction *program;
+    size_t program_size;
+    char *static_memory;
     size_t instruction_pointer;
+
+    // Memoized functions are identified by the location of their MENTER instruction
+    std::unordered_map<size_t, MemoCache> memo_caches;
+    std::vector<std::pair<size_t, std::vector<int64_t>>> pending_memo_keys;
 public:
     VirtualMachine(std::vector<Instruction> program, std::vector<char> static_memory)
-        : allocated_objects(), call_stack(), operand_stack(), local_vars(), program(std::move(program)), static_memory(std::move(static_memory)), instruction_pointer(0)
+        : VirtualMachine(nullptr, 0, nullptr)
     {
-        //for (const auto& instruction : this->program) {
+        this->owned_program = std::move(program);
+        this->owned_static_memory = std::move(static_memory);
+        this->program = this->owned_program.data();
+        this->program_size = this->owned_program.size();
+        this->static_memory = this->owned_static_memory.data();
+        //for (const auto& instruction : this->owned_program) {
         //    std::cout << instruction << std::endl;
         //}
     }
 
+    // The program and the static memory have to outlive the virtual machine
+    VirtualMachine(const Instruction *program, size_t program_size, char *static_memory)
+        : allocated_objects(), call_stack(), operand_stack(), local_vars(), owned_program(), owned_static_memory(), program(program), program_size(program_size), static_memory(static_memory), instruction_pointer(0), memo_caches(), pending_memo_keys()
+    {}
+
     Instruction get_current_instruction() {
-        if (this->instruction_pointer < this->program.size()) {
+        if (this->instruction_pointer < this->program_size) {
             return this->program[instruction_pointer];
         } else {
             return Instruction(InstructionType::HALT);
@@ -260,7 +354,7 @@ public:
     void execute() {
         while (this->get_current_instruction().get_type() != InstructionType::HALT) {
             //std::cout << "==================" << std::endl;
-            //for (size_t i = 0; i < this->program.size(); i++) {
+            //for (size_t i = 0; i < this->program_size; i++) {
             //    std::cout << (i == this->instruction_pointer ? "> " : "  ") << i << ": " << this->program[i] << std::endl;
             //}
             //
@@ -277,6 +371,82 @@ public:
         }
     }
 
+    // Like execute, but counts how often every instruction was executed and how often every jump was taken (see Profile)
+    void execute_profiled(std::vector<uint64_t>& execution_counts, std::vector<uint64_t>& taken_counts) {
+        execution_counts.assign(this->program_size, 0);
+        taken_counts.assign(this->program_size, 0);
+        while (this->get_current_instruction().get_type() != InstructionType::HALT) {
+            size_t location = this->instruction_pointer;
+            execute_instruction();
+            execution_counts[location] += 1;
+            if (this->instruction_pointer != location + 1) {
+                taken_counts[location] += 1;
+            }
+        }
+
+        for (auto& object : this->allocated_objects) {
+            std::free(object.get_data());
+        }
+    }
+
+    // Like execute, but reports every call and every backward jump to the listener
+    void execute_tiered(TieringListener& listener) {
+        while (this->get_current_instruction().get_type() != InstructionType::HALT) {
+            size_t location = this->instruction_pointer;
+            InstructionType type = this->program[location].get_type();
+            execute_instruction();
+            if (type == InstructionType::CALL) {
+                listener.on_call(*this, this->instruction_pointer);
+            } else if (this->instruction_pointer < location && type != InstructionType::RET && type != InstructionType::MENTER) {
+                listener.on_back_edge(*this, location);
+            }
+        }
+
+        for (auto& object : this->allocated_objects) {
+            std::free(object.get_data());
+        }
+    }
+
+    size_t get_program_size() const {
+        return this->program_size;
+    }
+
+    // Appends code to a program owned by the virtual machine, returns the location of its first instruction.
+    // The operands of jumps and calls in the code have to be locations in the extended program.
+    size_t append_code(const std::vector<Instruction>& code) {
+        assert(this->program == this->owned_program.data() && "Mapped programs can not be extended");
+        size_t location = this->owned_program.size();
+        this->owned_program.insert(this->owned_program.end(), code.begin(), code.end());
+        this->program = this->owned_program.data();
+        this->program_size = this->owned_program.size();
+        return location;
+    }
+
+    // Makes all calls of the function at 'from' call the function at 'to' instead, running calls are not affected
+    void redirect_calls(size_t from, size_t to) {
+        assert(this->program == this->owned_program.data() && "Mapped programs can not be changed");
+        for (auto& instruction : this->owned_program) {
+            if (instruction.get_type() == InstructionType::CALL && (size_t) instruction.get_operand().as_int == from) {
+                instruction.set_operand(Word { .as_int = (int64_t) to });
+            }
+        }
+    }
+
+    // Executes at most step_limit instructions, returns whether the program halted
+    bool execute_steps(size_t step_limit) {
+        for (size_t step = 0; step < step_limit; step++) {
+            if (this->get_current_instruction().get_type() == InstructionType::HALT) {
+                return true;
+            }
+            this->execute_instruction();
+        }
+        return this->get_current_instruction().get_type() == InstructionType::HALT;
+    }
+
+    size_t get_stack_size() const {
+        return this->operand_stack.size();
+    }
+
     void push_on_stack(StackElement value) {
         this->operand_stack.push_back(value);
     }
@@ -331,6 +501,18 @@ public:
         return data;
     }
 
+    // Address of the element at the given index of a list or string, exits if the index is out of bounds
+    void *get_element_address(void *object, int64_t index, int64_t operand, size_t element_size) {
+        int64_t length = ((Word*)((char*)object + LIST_LENGTH_OFFSET))->as_int;
+        if (index < 0 || index >= length) {
+            RUNTIME_ERROR("Index " << index << " is out of bounds for length " << length << ".");
+        }
+
+        size_t data_offset = (size_t)(operand >> 1);
+        char *data = (char*)((Word*)((char*)object + data_offset))->as_pointer;
+        return data + index * element_size;
+    }
+
     void execute_instruction() {
         const Instruction& current_instruction = this->get_current_instruction();
         switch (current_instruction.get_type()) {
@@ -408,10 +590,58 @@ public:
                     this->instruction_pointer += 1;
                 }
                 break;
+            case InstructionType::ELOADW:
+                {
+                    int64_t index = this->pop_from_stack().get_content().as_int;
+                    void *object = this->pop_from_stack().get_content().as_pointer;
+                    int64_t operand = current_instruction.get_operand().as_int;
+                    Word value = *(Word*)this->get_element_address(object, index, operand, sizeof(Word));
+                    if ((operand & 1) != 0) { // value that was read is an object
+                        this->push_on_stack(StackElement(StackElementType::OBJECT, value));
+                    } else {
+                        this->push_on_stack(StackElement(StackElementType::PRIMITIVE, value));
+                    }
+                    this->instruction_pointer += 1;
+                }
+                break;
+            case InstructionType::ESTOREW:
+                {
+                    StackElement value = this->pop_from_stack();
+                    int64_t index = this->pop_from_stack().get_content().as_int;
+                    void *object = this->pop_from_stack().get_content().as_pointer;
+                    int64_t operand = current_instruction.get_operand().as_int;
+                    *(Word*)this->get_element_address(object, index, operand, sizeof(Word)) = value.get_content();
+                    this->push_on_stack(value);
+                    this->instruction_pointer += 1;
+                }
+                break;
+
+            case InstructionType::ELOADB:
+                {
+                    int64_t index = this->pop_from_stack().get_content().as_int;
+                    void *object = this->pop_from_stack().get_content().as_pointer;
+                    int64_t operand = current_instruction.get_operand().as_int;
+                    char value = *(char*)this->get_element_address(object, index, operand, sizeof(char));
+                    this->push_on_stack(StackElement(StackElementType::PRIMITIVE, Word { .as_int = (int64_t) value }));
+                    this->instruction_pointer += 1;
+                }
+                break;
+            case InstructionType::ESTOREB:
+                {
+                    char as_byte = (char) (this->pop_from_stack().get_content().as_int & 0xFF);
+                    int64_t index = this->pop_from_stack().get_content().as_int;
+                    void *object = this->pop_from_stack().get_content().as_pointer;
+                    int64_t operand = current_instruction.get_operand().as_int;
+                    *(char*)this->get_element_address(object, index, operand, sizeof(char)) = as_byte;
+                    this->push_on_stack(StackElement(StackElementType::PRIMITIVE, Word { .as_int = (int64_t) as_byte }));
+                    this->instruction_pointer += 1;
+                }
+                break;
+
             case InstructionType::SPTR:
                 {
                     size_t offset = (size_t)current_instruction.get_operand().as_int;
-                    void *address = this->static_memory.data() + offset;
+                    void *address = this->static_memory + offset;
                     this->push_on_stack(StackElement(StackElementType::OBJECT, Word { .as_pointer = address }));
                     this->instruction_pointer += 1;
                 }
@@ -835,6 +1065,40 @@ public:
                 }
                 break;
 
+            // Entry of a memoized function with 'operand' arguments on the stack: returns the cached result
+            // if there is one, otherwise remembers the arguments for the MSTORE before the return
+            case InstructionType::MENTER:
+                {
+                    size_t argument_count = (size_t) current_instruction.get_operand().as_int;
+                    std::vector<int64_t> key;
+                    for (size_t i = this->operand_stack.size() - argument_count; i < this->operand_stack.size(); i++) {
+                        key.push_back(this->operand_stack[i].get_content().as_int);
+                    }
+
+                    MemoCache& cache = this->memo_caches[this->instruction_pointer];
+                    auto cached = cache.find(key);
+                    if (cached != cache.end()) {
+                        this->operand_stack.erase(this->operand_stack.end() - argument_count, this->operand_stack.end());
+                        this->push_on_stack(cached->second);
+
+                        size_t return_address = this->call_stack.back().get_return_address();
+                        this->call_stack.pop_back();
+                        this->instruction_pointer = return_address;
+                    } else {
+                        this->pending_memo_keys.push_back({ this->instruction_pointer, std::move(key) });
+                        this->instruction_pointer += 1;
+                    }
+                }
+                break;
+            case InstructionType::MSTORE:
+                {
+                    auto& [function, key] = this->pending_memo_keys.back();
+                    this->memo_caches[function].insert_or_assign(std::move(key), this->get_stack_top());
+                    this->pending_memo_keys.pop_back();
+                    this->instruction_pointer += 1;
+                }
+                break;
+
             case InstructionType::HALT:
                 break;
             case InstructionType::LABEL:
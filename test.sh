@@ -0,0 +1,113 @@
+#!/bin/sh
+
+# Runs every example and compares what it prints with the .expected file next to it. Examples that compile are also
+# run with --tiered, from a precompiled .nic file, through the compilation cache, with a recorded profile and
+# translated to C and to x86-64 assembly, which all have to print the same.
+
+BIN="./main"
+CC="cc"
+TMP_DIR=$(mktemp -d)
+trap 'rm -rf "$TMP_DIR"' EXIT
+FAILURES=0
+
+fail() {
+    echo "FAILED: $1"
+    FAILURES=$((FAILURES + 1))
+}
+
+# Compares the output of the last run with the expected output of the example $1, a run prints an error exactly if it
+# fails. $2 is the exit status of the run and $3 describes it.
+check() {
+    if ! cmp -s "$TMP_DIR/output" "$1.expected"; then
+        fail "$3"
+        diff "$1.expected" "$TMP_DIR/output"
+    elif grep -q "ERROR:" "$1.expected"; then
+        [ "$2" -ne 0 ] || fail "$3 exited with status 0"
+    else
+        [ "$2" -eq 0 ] || fail "$3 exited with status $2"
+    fi
+}
+
+cache_entry_count() {
+    ls "$TMP_DIR/cache/ni" 2>/dev/null | wc -l
+}
+
+for EXAMPLE in examples/*.ni; do
+    NAME="${EXAMPLE%.ni}"
+    if [ ! -f "$NAME.expected" ]; then
+        fail "$EXAMPLE has no $NAME.expected"
+        continue
+    fi
+
+    for LEVEL in -O0 -O2; do
+        $BIN --no-cache $LEVEL "$EXAMPLE" > "$TMP_DIR/output" 2>&1
+        check "$NAME" $? "$EXAMPLE $LEVEL"
+    done
+
+    # Compile errors are reported with their location in the source, such programs can not be run in any other way
+    if grep -q "^$EXAMPLE:" "$NAME.expected"; then
+        continue
+    fi
+
+    $BIN --no-cache --tiered "$EXAMPLE" > "$TMP_DIR/output" 2>&1
+    check "$NAME" $? "$EXAMPLE --tiered"
+
+    if $BIN --compile-only -o "$TMP_DIR/program.nic" "$EXAMPLE"; then
+        $BIN "$TMP_DIR/program.nic" > "$TMP_DIR/output" 2>&1
+        check "$NAME" $? "$EXAMPLE from .nic"
+
+        # A truncated program has to be rejected instead of executed
+        head -c $(($(wc -c < "$TMP_DIR/program.nic") / 2)) "$TMP_DIR/program.nic" > "$TMP_DIR/truncated.nic"
+        if $BIN "$TMP_DIR/truncated.nic" 2>&1 | grep -q "BYTECODE_ERROR:"; then :; else
+            fail "$EXAMPLE truncated .nic was not rejected"
+        fi
+    else
+        fail "$EXAMPLE --compile-only"
+    fi
+
+    # The first run compiles the program and adds it to the cache, the second one runs the cached program
+    ENTRY_COUNT=$(cache_entry_count)
+    XDG_CACHE_HOME="$TMP_DIR/cache" $BIN "$EXAMPLE" > "$TMP_DIR/output" 2>&1
+    check "$NAME" $? "$EXAMPLE cache miss"
+    [ "$(cache_entry_count)" -eq $((ENTRY_COUNT + 1)) ] || fail "$EXAMPLE was not added to the cache"
+    XDG_CACHE_HOME="$TMP_DIR/cache" $BIN "$EXAMPLE" > "$TMP_DIR/output" 2>&1
+    check "$NAME" $? "$EXAMPLE cache hit"
+    [ "$(cache_entry_count)" -eq $((ENTRY_COUNT + 1)) ] || fail "$EXAMPLE was added to the cache twice"
+
+    # Only programs that finish write a profile
+    if ! grep -q "ERROR:" "$NAME.expected"; then
+        $BIN --no-cache --profile-out="$TMP_DIR/profile" "$EXAMPLE" > "$TMP_DIR/output" 2>&1
+        check "$NAME" $? "$EXAMPLE --profile-out"
+        $BIN --no-cache --profile-in="$TMP_DIR/profile" "$EXAMPLE" > "$TMP_DIR/output" 2>&1
+        check "$NAME" $? "$EXAMPLE --profile-in"
+    fi
+
+    if command -v $CC > /dev/null; then
+        if $BIN --emit-c -o "$TMP_DIR/program.c" "$EXAMPLE" && $CC -O2 -o "$TMP_DIR/program" "$TMP_DIR/program.c"; then
+            "$TMP_DIR/program" > "$TMP_DIR/output" 2>&1
+            check "$NAME" $? "$EXAMPLE --emit-c"
+        else
+            fail "$EXAMPLE --emit-c"
+        fi
+
+        if [ "$(uname -m)" = "x86_64" ]; then
+            if $BIN --emit-asm -o "$TMP_DIR/program.s" "$EXAMPLE" && $CC -o "$TMP_DIR/program" "$TMP_DIR/program.s"; then
+                "$TMP_DIR/program" > "$TMP_DIR/output" 2>&1
+                check "$NAME" $? "$EXAMPLE --emit-asm"
+            else
+                fail "$EXAMPLE --emit-asm"
+            fi
+        fi
+    fi
+done
+
+# A profile only applies to the program it was recorded for
+$BIN --no-cache --profile-out="$TMP_DIR/profile" examples/factorial.ni > /dev/null 2>&1
+$BIN --no-cache --profile-in="$TMP_DIR/profile" examples/fibonacci.ni 2>&1 | grep -q "WARNING: Profile was recorded for another source" ||
+    fail "profile of another program was not ignored"
+
+if [ $FAILURES -ne 0 ]; then
+    echo "$FAILURES checks failed"
+    exit 1
+fi
+echo "All examples passed"